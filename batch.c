@@ -0,0 +1,346 @@
+#define _POSIX_C_SOURCE 200809L // opendir/stat/pthreads/sysconf
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "batch.h"
+
+/* Work stealing
+    Each worker owns a deque of ROM indices. A task is "run this ROM for up to BATCH_TASK_INSTRUCTIONS",
+    unfinished ROMs go back on the bottom of the worker's own deque so it keeps running them
+    (and keeps its engine caches warm), while workers that run dry steal from the top of someone else's.
+    That way a few long running ROMs can't hold up the rest of the pool.
+*/
+
+#define BATCH_TASK_INSTRUCTIONS 100000  // Instructions per task before a ROM is put back in a deque
+#define BATCH_HALT_CHECK 1000           // Instructions between halt checks
+#define BATCH_DEFAULT_SECONDS 10        // Default budget per ROM, in emulated seconds
+
+// One ROM (instance) in the batch
+typedef struct {
+    char *path;
+    uint32_t instance;  // which of the --instances copies of the ROM
+    chip8_t chip8;
+    bool halted;        // stopped early, not just out of budget
+} batch_rom_t;
+
+// Per worker deque of ROM indices, ring buffer with room for every ROM
+typedef struct {
+    pthread_mutex_t lock;
+    uint32_t *items;
+    uint32_t head;      // top, where thieves take from
+    uint32_t count;
+} batch_deque_t;
+
+typedef struct batch_s batch_t;
+
+typedef struct {
+    batch_t *batch;
+    uint32_t id;
+    pthread_t thread;
+    batch_deque_t deque;
+} batch_worker_t;
+
+struct batch_s {
+    config_t config;
+    uint64_t max_instructions;
+    batch_rom_t *roms;
+    uint32_t rom_count;
+    batch_worker_t *workers;
+    uint32_t worker_count;
+};
+
+
+// Add a copy of path to the list
+static bool add_path(path_list_t *list, const char *path){
+    if (list->count == list->capacity){
+        const uint32_t capacity = list->capacity ? list->capacity * 2 : 64;
+        char **paths = realloc(list->paths, capacity * sizeof *paths);
+        if (!paths) return false;
+        list->paths = paths;
+        list->capacity = capacity;
+    }
+    if (!(list->paths[list->count] = strdup(path))) return false;
+    list->count++;
+    return true;
+}
+
+// True if the file name has a CHIP8 ROM extension
+static bool is_rom_file(const char *name){
+    const char *ext = strrchr(name, '.');
+    return ext && (strcmp(ext, ".ch8") == 0 || strcmp(ext, ".c8") == 0 || strcmp(ext, ".sc8") == 0 ||
+                   strcmp(ext, ".xo8") == 0);
+}
+
+// Recursively collect ROM files under dir
+static bool scan_directory(path_list_t *list, const char *dir_path){
+    DIR *dir = opendir(dir_path);
+    if (!dir){
+        fprintf(stderr, "Could not open directory %s\n", dir_path);
+        return false;
+    }
+
+    bool ok = true;
+    struct dirent *entry;
+    while (ok && (entry = readdir(dir))){
+        if (entry->d_name[0] == '.') continue; // ., .. and hidden files (.git)
+
+        char path[4096];
+        if (snprintf(path, sizeof path, "%s/%s", dir_path, entry->d_name) >= (int)sizeof path) continue;
+
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+
+        if (S_ISDIR(st.st_mode)) ok = scan_directory(list, path);
+        else if (S_ISREG(st.st_mode) && is_rom_file(entry->d_name)) ok = add_path(list, path);
+    }
+
+    closedir(dir);
+    return ok;
+}
+
+// Collect ROM paths from a list file, 1 path per line, blank lines and # comments are skipped
+static bool read_list_file(path_list_t *list, const char *file_path){
+    FILE *file = fopen(file_path, "r");
+    if (!file){
+        fprintf(stderr, "ROM list %s is invalid or does not exist\n", file_path);
+        return false;
+    }
+
+    bool ok = true;
+    char line[4096];
+    while (ok && fgets(line, sizeof line, file)){
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+        ok = add_path(list, line);
+    }
+
+    fclose(file);
+    return ok;
+}
+
+static int compare_paths(const void *a, const void *b){
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Collect ROM paths from a directory (recursively) or list file, sorted
+bool collect_roms(const char *path, path_list_t *list){
+    *list = (path_list_t){0};
+
+    struct stat st;
+    if (stat(path, &st) != 0){
+        fprintf(stderr, "ROM path %s is invalid or does not exist\n", path);
+        return false;
+    }
+    if (!(S_ISDIR(st.st_mode) ? scan_directory(list, path) : read_list_file(list, path))){
+        free_paths(list);
+        return false;
+    }
+    if (list->count == 0){
+        fprintf(stderr, "No ROMs found in %s\n", path);
+        free_paths(list);
+        return false;
+    }
+
+    // stable order so results can be diffed between runs
+    qsort(list->paths, list->count, sizeof *list->paths, compare_paths);
+    return true;
+}
+
+// Free a list of ROM paths
+void free_paths(path_list_t *list){
+    for (uint32_t i = 0; i < list->count; i++) free(list->paths[i]);
+    free(list->paths);
+    *list = (path_list_t){0};
+}
+
+
+// Push a ROM index on the bottom of a deque
+static void push_bottom(batch_deque_t *deque, const uint32_t capacity, const uint32_t rom){
+    pthread_mutex_lock(&deque->lock);
+    deque->items[(deque->head + deque->count++) % capacity] = rom;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+// Pop from the bottom (owner) or the top (thief), false if the deque is empty
+static bool pop(batch_deque_t *deque, const uint32_t capacity, const bool from_top, uint32_t *rom){
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count){
+        if (from_top){
+            *rom = deque->items[deque->head];
+            deque->head = (deque->head + 1) % capacity;
+        }else{
+            *rom = deque->items[(deque->head + deque->count - 1) % capacity];
+        }
+        deque->count--;
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// Get the next ROM to run: own deque first, then steal from the others, starting with the next worker along
+static bool next_task(batch_worker_t *worker, uint32_t *rom){
+    batch_t *batch = worker->batch;
+    if (pop(&worker->deque, batch->rom_count, false, rom)) return true;
+
+    for (uint32_t i = 1; i < batch->worker_count; i++){
+        batch_worker_t *victim = &batch->workers[(worker->id + i) % batch->worker_count];
+        if (pop(&victim->deque, batch->rom_count, true, rom)) return true;
+    }
+    return false;
+}
+
+// Run 1 task, true if the ROM is finished (halted or out of budget)
+static bool run_task(batch_t *batch, batch_rom_t *rom, chip8_engine_t *engine){
+    chip8_t *chip8 = &rom->chip8;
+    uint64_t task_left = BATCH_TASK_INSTRUCTIONS;
+
+    while (task_left){
+        if (chip8->cycles >= batch->max_instructions) return true;
+        if (is_halted(chip8)){
+            rom->halted = true;
+            return true;
+        }
+
+        uint64_t run = BATCH_HALT_CHECK;
+        if (run > task_left) run = task_left;
+        if (run > batch->max_instructions - chip8->cycles) run = batch->max_instructions - chip8->cycles;
+
+        run_cycles(chip8, engine, batch->config, run);
+        task_left -= run;
+    }
+    return chip8->cycles >= batch->max_instructions;
+}
+
+// Worker thread: run tasks until there are none left to take. Nothing is queued after the start and a ROM
+//  that isn't finished goes back on the deque of the worker running it, so once every deque is empty the
+//  ROMs still going all belong to workers that will finish them
+static void *worker_main(void *arg){
+    batch_worker_t *worker = arg;
+    batch_t *batch = worker->batch;
+
+    // engine caches belong to whichever ROM ran last, so they are reset when switching ROMs
+    chip8_engine_t *engine = malloc(sizeof *engine);
+    if (!engine){
+        fprintf(stderr, "Out of memory for batch worker %u\n", worker->id);
+        exit(EXIT_FAILURE);
+    }
+    uint32_t last_rom = UINT32_MAX;
+
+    uint32_t rom;
+    while (next_task(worker, &rom)){
+        if (rom != last_rom){
+            init_engine(engine, batch->config.engine);
+            last_rom = rom;
+        }
+
+        if (!run_task(batch, &batch->roms[rom], engine)) push_bottom(&worker->deque, batch->rom_count, rom);
+    }
+
+    free(engine);
+    return NULL;
+}
+
+
+// Run the batch described by config (batch_path, threads, max_instructions), false on setup errors
+bool run_batch(const config_t config){
+    // find the ROMs
+    path_list_t list;
+    if (!collect_roms(config.batch_path, &list)) return false;
+
+    batch_t batch = {
+        .config = config,
+        .max_instructions = config.max_instructions ? config.max_instructions
+                                                    : (uint64_t)config.inst_per_second * BATCH_DEFAULT_SECONDS,
+        .rom_count = list.count * config.instances,
+    };
+    if (config.instances && batch.rom_count / config.instances != list.count){
+        fprintf(stderr, "Too many instances: %u ROMs x %u\n", list.count, config.instances);
+        return false;
+    }
+
+    // workers, 1 per core by default but never more than there are ROMs
+    batch.worker_count = config.threads;
+    if (batch.worker_count == 0){
+        const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        batch.worker_count = cores > 0 ? cores : 1;
+    }
+    if (batch.worker_count > batch.rom_count) batch.worker_count = batch.rom_count;
+
+    batch.roms = calloc(batch.rom_count, sizeof *batch.roms);
+    batch.workers = calloc(batch.worker_count, sizeof *batch.workers);
+    if (!batch.roms || !batch.workers){
+        fprintf(stderr, "Out of memory for %u ROMs\n", batch.rom_count);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < batch.worker_count; i++){
+        batch_worker_t *worker = &batch.workers[i];
+        worker->batch = &batch;
+        worker->id = i;
+        pthread_mutex_init(&worker->deque.lock, NULL);
+        if (!(worker->deque.items = malloc(batch.rom_count * sizeof *worker->deque.items))){
+            fprintf(stderr, "Out of memory for %u ROMs\n", batch.rom_count);
+            return false;
+        }
+    }
+
+    // load every ROM up front, once, and clone it for the other instances; ones that fail to load are reported
+    //  and skipped, the rest are dealt round robin into the worker deques. Every ROM gets the same seed
+    //  (--seed or the time), plus the instance number
+    const uint64_t seed = config.fixed_seed ? config.seed : (uint64_t)time(NULL);
+    uint32_t loaded = 0;
+    for (uint32_t i = 0; i < batch.rom_count; i++){
+        batch_rom_t *rom = &batch.roms[i];
+        rom->path = list.paths[i / config.instances];
+        rom->instance = i % config.instances;
+        if (rom->instance == 0){
+            if (!init_chip8(&rom->chip8, rom->path)) continue;
+            if (config.fixed_quirks) rom->chip8.quirks = config.quirks;
+        }else{
+            const batch_rom_t *first = rom - rom->instance;
+            if (first->chip8.state != RUNNING) continue; // failed to load
+            clone_chip8(&rom->chip8, &first->chip8);
+        }
+        seed_chip8(&rom->chip8, seed + rom->instance);
+        push_bottom(&batch.workers[loaded++ % batch.worker_count].deque, batch.rom_count, i);
+    }
+
+    for (uint32_t i = 0; i < batch.worker_count; i++){
+        if (pthread_create(&batch.workers[i].thread, NULL, worker_main, &batch.workers[i]) != 0){
+            fprintf(stderr, "Could not create batch worker thread %u\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (uint32_t i = 0; i < batch.worker_count; i++) pthread_join(batch.workers[i].thread, NULL);
+
+    // results: display hash, instructions run, why it stopped, instance (with --instances), ROM path
+    for (uint32_t i = 0; i < batch.rom_count; i++){
+        const batch_rom_t *rom = &batch.roms[i];
+        if (rom->chip8.state != RUNNING){
+            printf("%-16s %12s %-7s ", "-", "-", "error");
+        }else{
+            printf("%016llx %12llu %-7s ", (unsigned long long)hash_display(&rom->chip8),
+                   (unsigned long long)rom->chip8.cycles, rom->halted ? "halted" : "budget");
+        }
+        if (config.instances > 1) printf("%6u ", rom->instance);
+        printf("%s\n", rom->path);
+    }
+
+    for (uint32_t i = 0; i < batch.worker_count; i++){
+        pthread_mutex_destroy(&batch.workers[i].deque.lock);
+        free(batch.workers[i].deque.items);
+    }
+    free_paths(&list);
+    free(batch.workers);
+    free(batch.roms);
+    return true;
+}
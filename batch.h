@@ -0,0 +1,30 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/* Headless batch runner
+    Runs every ROM in a directory (recursively) or list file at once, one chip8_t per ROM,
+    spread over a pool of worker threads, and prints a framebuffer hash per ROM
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chip8.h"
+
+// Growable list of ROM paths
+typedef struct {
+    char **paths;
+    uint32_t count;
+    uint32_t capacity;
+} path_list_t;
+
+// Collect .ch8/.c8 ROM paths from a directory (recursively) or a list file (1 path per line, # comments), sorted
+bool collect_roms(const char *path, path_list_t *list);
+
+// Free a list of ROM paths
+void free_paths(path_list_t *list);
+
+// Run the batch described by config (batch_path, threads, max_instructions), false on setup errors
+bool run_batch(const config_t config);
+
+#endif
@@ -0,0 +1,147 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bench.h"
+#include "batch.h"
+
+#define BENCH_DEFAULT_INSTRUCTIONS 10000000  // per ROM per engine
+#define BENCH_SEED 1                         // fixed so every engine sees the same workload
+
+#ifdef CHIP8_THREADED_DISPATCH
+#define BENCH_DISPATCH "threaded"
+#else
+#define BENCH_DISPATCH "switch"
+#endif
+
+static const struct {
+    engine_type_t type;
+    const char *name;
+} engines[] = {
+    {ENGINE_INTERPRETER, "interpreter"},
+    {ENGINE_PREDECODE, "predecode"},
+    {ENGINE_BLOCKS, "blocks"},
+};
+
+// Synthetic ROM: body repeated to fill most of RAM, then a jump back to the start. Body is big endian opcodes
+typedef struct {
+    const char *name;
+    uint16_t body[8];
+    uint8_t length;
+} bench_class_t;
+
+static const bench_class_t classes[] = {
+    {"load",   {0x6012, 0x6134, 0x6256, 0x6378, 0x7401, 0x7502, 0x7603, 0x7704}, 8},   // 6XNN, 7XNN
+    {"alu",    {0x8014, 0x8125, 0x8231, 0x8342, 0x8453, 0x8506, 0x860E, 0x8707}, 8},   // 8XY*
+    {"skip",   {0x3000, 0x4001, 0x5010, 0x9010, 0x3101, 0x4100, 0x5020, 0x9020}, 8},   // 3XNN, 4XNN, 5XY0, 9XY0
+    {"index",  {0xA300, 0xF01E, 0xF129, 0xA400, 0xF21E, 0xF329, 0xA500, 0xF41E}, 8},   // ANNN, FX1E, FX29
+    {"memory", {0xAE00, 0xF033, 0xF355, 0xF365, 0xAF00, 0xF133, 0xF255, 0xF265}, 8},   // FX33, FX55, FX65
+    {"timer",  {0xF015, 0xF107, 0xF218, 0xF307, 0xF015, 0xF107, 0xF218, 0xF307}, 8},   // FX07, FX15, FX18
+    {"random", {0xC0FF, 0xC10F, 0xC2F0, 0xC3AA, 0xC455, 0xC5FF, 0xC60F, 0xC7F0}, 8},   // CXNN
+    {"draw",   {0xA000, 0xD015, 0xA005, 0xD125, 0xA00A, 0xD235, 0x7001, 0x7102}, 8},   // ANNN, DXYN
+};
+
+// Seconds since some fixed point
+static double now_seconds(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Print s as a JSON string, ROM paths can have quotes/backslashes in them
+static void print_json_string(const char *s){
+    putchar('"');
+    for (; *s; s++){
+        if (*s == '"' || *s == '\\') printf("\\%c", *s);
+        else if ((unsigned char)*s < 0x20) printf("\\u%04x", *s);
+        else putchar(*s);
+    }
+    putchar('"');
+}
+
+// Time instructions on a freshly loaded copy of machine with each engine, print 1 JSON line per engine
+static void bench_machine(const config_t config, const chip8_t *machine, const char *type, const char *name,
+                          const uint64_t instructions){
+    static chip8_t chip8;           // static, too big for some thread stacks
+    static chip8_engine_t engine;
+
+    for (uint32_t i = 0; i < sizeof engines / sizeof engines[0]; i++){
+        chip8 = *machine;
+        chip8.stack_ptr = chip8.stack + (machine->stack_ptr - machine->stack);
+        init_engine(&engine, engines[i].type);
+
+        const double start = now_seconds();
+        run_cycles(&chip8, &engine, config, instructions);
+        const double seconds = now_seconds() - start;
+
+        printf("{\"type\":\"%s\",\"name\":", type);
+        print_json_string(name);
+        printf(",\"engine\":\"%s\",\"instructions\":%llu,\"seconds\":%.6f,"
+               "\"mips\":%.2f,\"ns_per_instruction\":%.3f,\"display_hash\":\"%016llx\"}\n",
+               engines[i].name, (unsigned long long)instructions, seconds,
+               seconds > 0 ? instructions / seconds / 1e6 : 0.0, instructions ? seconds * 1e9 / instructions : 0.0,
+               (unsigned long long)hash_display(&chip8));
+        fflush(stdout);
+    }
+}
+
+// Benchmark 1 ROM file
+static bool bench_rom(const config_t config, const char *path, const uint64_t instructions){
+    static chip8_t machine;
+    machine = (chip8_t){0};
+    if (!init_chip8(&machine, path)) return false;
+    if (config.fixed_quirks) machine.quirks = config.quirks;
+    seed_chip8(&machine, BENCH_SEED);
+    bench_machine(config, &machine, "rom", path, instructions);
+    return true;
+}
+
+// Benchmark 1 instruction class
+static void bench_class(const config_t config, const bench_class_t *class, const uint64_t instructions){
+    // body repeated for 256 instructions then a jump back to 0x200: small enough to fit every engine's caches,
+    //  so this times the instructions rather than cache misses. The memory class writes well above it
+    static uint8_t rom[256 * 2 + 2];
+    uint32_t size = 0;
+    while (size + class->length * 2 <= sizeof rom - 2){
+        for (uint8_t i = 0; i < class->length; i++){
+            rom[size++] = class->body[i] >> 8;
+            rom[size++] = class->body[i] & 0xFF;
+        }
+    }
+    rom[size++] = 0x12;
+    rom[size++] = 0x00;
+
+    static chip8_t machine;
+    machine = (chip8_t){0};
+    init_chip8_buffer(&machine, class->name, rom, size);
+    if (config.fixed_quirks) machine.quirks = config.quirks;
+    seed_chip8(&machine, BENCH_SEED);
+    bench_machine(config, &machine, "class", class->name, instructions);
+}
+
+
+// Run the benchmark
+bool run_bench(const config_t options, const char *rom_path){
+    // engines are timed on every instruction, idle loops (e.g BC_test's jump to itself) are not skipped
+    config_t config = options;
+    config.idle_skip = false;
+    const uint64_t instructions = config.max_instructions ? config.max_instructions : BENCH_DEFAULT_INSTRUCTIONS;
+
+    printf("{\"type\":\"config\",\"dispatch\":\"%s\",\"inst_per_second\":%u,\"instructions\":%llu}\n",
+           BENCH_DISPATCH, config.inst_per_second, (unsigned long long)instructions);
+
+    bool ok = true;
+    if (config.batch_path){
+        path_list_t list;
+        if (!collect_roms(config.batch_path, &list)) return false;
+        for (uint32_t i = 0; i < list.count; i++) ok &= bench_rom(config, list.paths[i], instructions);
+        free_paths(&list);
+    }else if (rom_path){
+        ok = bench_rom(config, rom_path, instructions);
+    }
+
+    for (uint32_t i = 0; i < sizeof classes / sizeof classes[0]; i++) bench_class(config, &classes[i], instructions);
+    return ok;
+}
@@ -0,0 +1,16 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/* Headless benchmark
+    Times each execution engine on real ROMs and on synthetic ROMs made of 1 class of instruction,
+    output is 1 JSON object per line so results can be appended to a history file and diffed/plotted
+*/
+
+#include <stdbool.h>
+
+#include "chip8.h"
+
+// Run the benchmark on rom_path (or every ROM in config.batch_path) and the synthetic ROMs, false on errors
+bool run_bench(const config_t config, const char *rom_path);
+
+#endif
@@ -2,7 +2,9 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <time.h>
+#include <stdatomic.h>
 
 
 /* SDL (Simple Direct Media Layer) is a library that abstracts multimedia hardware components 
@@ -11,71 +13,186 @@
 
 #include "SDL.h"
 
+#include "chip8.h"
+#include "shm.h"
+#include "stream.h"
+
 
 // type alias for a struct containing a pointer attribute of type SDL_Window which we call "sdl_t"
 // SDL Container Object
 typedef struct {
       SDL_Window *window;
       SDL_Renderer *renderer;
+      SDL_Texture *frame;       // 128x64 streaming texture, 64x32 frames use its top left (RENDERER_TEXTURE)
+      SDL_Texture *outlines[2]; // window sized pixel outline overlays for 64x32 and 128x64 (RENDERER_TEXTURE)
+      SDL_AudioDeviceID audio;  // beeper output, 0 if there is no audio
 } sdl_t;
 
-// Emulator Config object
+
+// Beeper, a square wave played whenever the sound timer is running. The emulation thread only flips
+//  the playing flag, SDL's audio thread copies samples from a table precomputed at startup; the callback
+//  never allocates, locks or does any maths beyond the copy
+#define AUDIO_RATE 44100        // samples per second
+#define AUDIO_TONE 440          // beep frequency, hz
+#define AUDIO_VOLUME 3000       // square wave amplitude, int16
 typedef struct {
-    uint32_t window_width;      // SDL window width
-    uint32_t window_height;     // SDL window height
-    uint32_t fg_color;          // Foreground Color RGBA8888 (bits)
-    uint32_t bg_color;          // Background Color RGBA8888 (bits)
-    uint32_t scale_factor;      // Amount to scale a CHIP8 pixel by ... e.g 20x will be a 20x larger window
-    bool pixel_outlines;        // Draw pixel outlines yes/no 
-    uint32_t inst_per_second;   // CHIP8 CPU "clock rate"/hz
-} config_t;
-
-//Emulator states
-typedef enum {
-    QUIT = 0,
-    RUNNING,
-    PAUSED,
-} emulator_state_t;
-
-
-// CHIP8 instruction format
-typedef struct{
-    uint16_t opcode;    
-    uint16_t NNN;       // 12-bit address/constant
-    uint8_t NN;         // 8-bit constant
-    uint8_t N;          // 4-bit constant
-    uint8_t X;          // 4-bit register identifier
-    uint8_t Y;          // 4-bit register identifier
-    
-} instruction_t;
+    int16_t wave[AUDIO_RATE / AUDIO_TONE];  // 1 period of the tone
+    uint32_t position;         // audio thread only, next sample of the wave
+    atomic_bool playing;       // set by the emulation thread
+} audio_t;
+
+// SDL audio callback (runs on SDL's audio thread): fill the stream with the tone or silence
+void audio_callback(void *userdata, uint8_t *stream, int length){
+    audio_t *audio = userdata;
+    int16_t *samples = (int16_t *)stream;
+    const uint32_t count = length / sizeof *samples;
+    const uint32_t period = sizeof audio->wave / sizeof audio->wave[0];
+
+    if (!atomic_load_explicit(&audio->playing, memory_order_relaxed)){
+        memset(stream, 0, length);
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++){
+        samples[i] = audio->wave[audio->position];
+        if (++audio->position == period) audio->position = 0;
+    }
+}
+
+// Open the audio device with a config.audio_samples buffer and start it (silent until the sound timer runs),
+//  false if there is no audio; the emulator still runs, just without sound
+bool init_audio(sdl_t *sdl, const config_t config, audio_t *audio){
+    const uint32_t period = sizeof audio->wave / sizeof audio->wave[0];
+    for (uint32_t i = 0; i < period; i++) audio->wave[i] = i < period / 2 ? AUDIO_VOLUME : -AUDIO_VOLUME;
+    audio->position = 0;
+    atomic_init(&audio->playing, false);
+
+    // no allowed changes, SDL converts to whatever the hardware wants so the table is always right
+    const SDL_AudioSpec want = {
+        .freq = AUDIO_RATE,
+        .format = AUDIO_S16SYS,
+        .channels = 1,
+        .samples = config.audio_samples,
+        .callback = audio_callback,
+        .userdata = audio,
+    };
+    SDL_AudioSpec have;
+    sdl->audio = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    if (!sdl->audio){
+        SDL_Log("Could not open audio device, no sound %s\n", SDL_GetError());
+        return false;
+    }
+
+    SDL_PauseAudioDevice(sdl->audio, 0); // start the callback
+    return true;
+}
 
 
-// CHIP8 Machine object
+// Completed frame, what the render thread needs from the machine to present it
 typedef struct {
+    uint64_t display[CHIP8_PLANES][CHIP8_HIRES_HEIGHT][CHIP8_ROW_WORDS]; // copy of chip8.display
+    bool hires;                       // copy of chip8.hires
+    uint64_t dirty_rows;              // rows that differ from the last frame presented, set by the render thread
+} frame_t;
+
+// Lock-free triple buffer between the emulation thread and the render thread. The emulation thread fills
+//  the back frame and swaps it with the middle one, the render thread swaps the middle frame with its front
+//  one when a newer frame is there. Neither side ever waits for the other, a stalled present just means
+//  the emulation thread keeps replacing the middle frame
+#define FRAME_INDEX 3u      // middle & FRAME_INDEX is the frame index
+#define FRAME_FRESH 4u      // middle holds a frame the render thread hasn't taken yet
+typedef struct {
+    frame_t frames[3];
+    atomic_uint middle;     // shared
+    uint32_t back;          // emulation thread only
+    uint32_t front;         // render thread only
+} frame_buffer_t;
+
+// Start empty: frames 0/1/2 are back/middle/front
+void init_frame_buffer(frame_buffer_t *buffer){
+    memset(buffer->frames, 0, sizeof buffer->frames);
+    buffer->back = 0;
+    atomic_init(&buffer->middle, 1);
+    buffer->front = 2;
+}
 
-    emulator_state_t state;
-    uint8_t ram[4096];  //Memory of the machine is 4096 Bytes
-    
-    // approaches to display
-    
-    // uint8_t *display; // display = &ram[0xF00] - &ram[0xFFF]
-    bool display[64*32]; // emulate original chip8 resolution pixels
-
-
-    uint16_t stack[12];        // subroutine stack
-    uint16_t *stack_ptr;       // stack pointer
-    uint8_t V[16];             // data registers V0-VF
-    uint16_t I;                // index register
-    uint16_t PC;               // Program Counter
-    uint8_t delay_timer;       // decrements at 60hz when >0
-    uint8_t sound_timer;       // decrements at 60hz and plays tone when >0
-    bool keypad[16];           // hexadecimal keypad 0x0-0xF
-    const char *rom_name;      // currently running ROM
-    
-    instruction_t inst;        // currently executing instruction
+// Emulation thread: hand the machine's current display to the render thread,
+//  false if the previous frame was never taken (so it will never be shown)
+bool publish_frame(frame_buffer_t *buffer, const chip8_t *chip8){
+    memcpy(buffer->frames[buffer->back].display, chip8->display, sizeof chip8->display);
+    buffer->frames[buffer->back].hires = chip8->hires;
+    const uint32_t previous = atomic_exchange(&buffer->middle, buffer->back | FRAME_FRESH);
+    buffer->back = previous & FRAME_INDEX;
+    return !(previous & FRAME_FRESH);
+}
+
+// Render thread: the newest frame if one was published since the last call, NULL otherwise
+frame_t *take_frame(frame_buffer_t *buffer){
+    if (!(atomic_load(&buffer->middle) & FRAME_FRESH)) return NULL;
+    buffer->front = atomic_exchange(&buffer->middle, buffer->front) & FRAME_INDEX;
+    return &buffer->frames[buffer->front];
+}
+
+
+// Window pixel a CHIP8 pixel edge falls on, for x CHIP8 pixels across a window span pixels wide showing
+//  pixels of them; the same rounding for both renderers so rects and outlines line up
+static inline uint32_t pixel_edge(const uint32_t x, const uint32_t span, const uint32_t pixels){
+    return x * span / pixels;
+}
+
+// Create the pixel outline overlay for 1 resolution, NULL on errors
+SDL_Texture *create_outlines(const sdl_t *sdl, const config_t config, const uint32_t width, const uint32_t height){
+    // Outlines are drawn in the background color on top of every pixel. Over an "off" pixel that is
+    //  invisible, so a single precomputed overlay gives the same picture as outlining only the "on" pixels
+    const uint32_t w = config.window_width * config.scale_factor;
+    const uint32_t h = config.window_height * config.scale_factor;
+    uint32_t *pixels = malloc(w * h * sizeof *pixels);
+    if (!pixels){
+        SDL_Log("Could not allocate pixel outline overlay\n");
+        return NULL;
+    }
 
-} chip8_t;
+    for (uint32_t y = 0; y < h; y++){
+        // CHIP8 pixel this window row is in and whether it is its first/last row
+        const uint32_t row = y * height / h;
+        const bool edge_y = y == pixel_edge(row, h, height) || y + 1 == pixel_edge(row + 1, h, height);
+        for (uint32_t x = 0; x < w; x++){
+            // edge of a scaled CHIP8 pixel, same 1 pixel border SDL_RenderDrawRect would draw
+            const uint32_t column = x * width / w;
+            const bool edge = edge_y || x == pixel_edge(column, w, width) || x + 1 == pixel_edge(column + 1, w, width);
+            pixels[y * w + x] = edge ? config.bg_color : 0x00000000; // fully transparent inside
+        }
+    }
 
+    SDL_Texture *outlines = SDL_CreateTexture(sdl->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, w, h);
+    if (!outlines){
+        SDL_Log("Could not create SDL outline texture %s\n", SDL_GetError());
+        free(pixels);
+        return NULL;
+    }
+    SDL_UpdateTexture(outlines, NULL, pixels, w * sizeof *pixels);
+    SDL_SetTextureBlendMode(outlines, SDL_BLENDMODE_BLEND);
+    free(pixels);
+    return outlines;
+}
+
+// Create the framebuffer texture and the pixel outline overlays for RENDERER_TEXTURE. Everything is made
+//  once for both resolutions, so a ROM switching between 64x32 and 128x64 costs nothing but the redraw
+bool init_textures(sdl_t *sdl, const config_t config){
+    // 1 texel per CHIP8 pixel at 128x64, 64x32 uses the top left quarter; scaled up to the window by SDL_RenderCopy
+    sdl->frame = SDL_CreateTexture(sdl->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING,
+                                   CHIP8_HIRES_WIDTH, CHIP8_HIRES_HEIGHT);
+    if (!sdl->frame){
+        SDL_Log("Could not create SDL frame texture %s\n", SDL_GetError());
+        return false;
+    }
+
+    if (!config.pixel_outlines) return true;
+
+    sdl->outlines[0] = create_outlines(sdl, config, CHIP8_WIDTH, CHIP8_HEIGHT);
+    sdl->outlines[1] = create_outlines(sdl, config, CHIP8_HIRES_WIDTH, CHIP8_HIRES_HEIGHT);
+    return sdl->outlines[0] && sdl->outlines[1];
+}
 
 //initialise SDL
 bool init_sdl(sdl_t *sdl, const config_t config){ // pass in the sdl_t struct as a pointer
@@ -102,117 +219,106 @@ bool init_sdl(sdl_t *sdl, const config_t config){ // pass in the sdl_t struct as
 
 
     // creates the renderer (the thing that can be drawn to)
-    sdl->renderer = SDL_CreateRenderer(sdl->window, -1, SDL_RENDERER_ACCELERATED);
+    sdl->renderer = SDL_CreateRenderer(sdl->window, -1,
+        SDL_RENDERER_ACCELERATED | (config.vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
 
     if (!sdl->renderer){
         SDL_Log("Could not create SDL renderer %s\n", SDL_GetError());
         return false;
     }
 
+    if (config.renderer == RENDERER_TEXTURE && !init_textures(sdl, config)) return false;
+
     return true;
 }
 
-// Setup initial emulator configuration from passed in args
-bool set_config_from_args(config_t *config, const int argc, char **argv){
-    
-    //set defaults
-    *config = (config_t){
-        .window_width = 64,     // CHIP8 original X resolution
-        .window_height = 32,    // CHIP8 original Y resolution
-        .fg_color = 0xFFFFFFFF, // WHITE
-        .bg_color = 0x000000FF, // BLACK
-        .scale_factor = 20,     // Default resolution will be 1280x640
-        .pixel_outlines = true, // Draw pixel outlines by default
-        .inst_per_second = 500, // Number of intructions to emulate in 1 second (clock rate of CPU)
+// Frame pacer, keeps emulated time in step with real time using the high resolution performance counter
+typedef struct {
+    uint64_t freq;             // performance counter ticks per second
+    uint64_t period;           // ticks per host frame (60hz)
+    uint64_t last_time;        // counter value at the start of the previous host frame
+    uint64_t next_deadline;    // counter value the next host frame is due at
+    double pending;            // emulated cycles owed but not run yet (fractional)
+    uint64_t frames;           // host frames paced
+    uint64_t late_frames;      // host frames that finished after their deadline
+    uint64_t dropped_frames;   // emulated frames (60hz timer ticks) never shown, run back to back to catch up
+} pacer_t;
+
+// most emulated frames to catch up on in one go (e.g after the window was dragged), the rest is skipped
+#define PACER_MAX_CATCHUP 8
+
+// Start pacing from now
+void init_pacer(pacer_t *pacer){
+    *pacer = (pacer_t){
+        .freq = SDL_GetPerformanceFrequency(),
+        .last_time = SDL_GetPerformanceCounter(),
     };
+    pacer->period = pacer->freq / 60;
+    pacer->next_deadline = pacer->last_time + pacer->period;
+}
 
-    //override defaults from args
+// Restart timing without catching up, e.g after being paused
+void reset_pacer(pacer_t *pacer){
+    pacer->last_time = SDL_GetPerformanceCounter();
+    pacer->next_deadline = pacer->last_time + pacer->period;
+    pacer->pending = 0;
+}
 
-    for (int i=1; i< argc;i++){
-        (void)argv[i]; //prevent compiler error unused 
-        // ...
+// Start of a host frame, returns how many emulated cycles (instructions) are due for the real time that has passed
+uint64_t pacer_cycles_due(pacer_t *pacer, const config_t config){
+    const uint64_t now = SDL_GetPerformanceCounter();
+    pacer->pending += (double)(now - pacer->last_time) * config.inst_per_second * config.speed / pacer->freq;
+    pacer->last_time = now;
+
+    const double max_cycles = (double)PACER_MAX_CATCHUP * config.inst_per_second / 60;
+    if (pacer->pending > max_cycles){
+        // too far behind to catch up, drop the backlog
+        pacer->dropped_frames += (uint64_t)((pacer->pending - max_cycles) * 60 / config.inst_per_second);
+        pacer->pending = max_cycles;
     }
-    return true;
 
+    const uint64_t due = (uint64_t)pacer->pending;
+    pacer->pending -= due;
+    return due;
+}
+
+// End of a host frame, waits for the next deadline (presenting already waited for vsync if presented)
+void pacer_wait(pacer_t *pacer, const bool vsynced){
+    pacer->frames++;
+    uint64_t now = SDL_GetPerformanceCounter();
+
+    if (now > pacer->next_deadline){
+        // missed the deadline, resync instead of trying to make the time up
+        if (!vsynced) pacer->late_frames++;
+        pacer->next_deadline = now + pacer->period;
+        return;
+    }
+
+    if (!vsynced){
+        // sleep in whole ms while far from the deadline, SDL_Delay can oversleep by ~1ms,
+        //  then spin on the counter for the last bit
+        while (pacer->next_deadline - now > pacer->freq / 500){
+            SDL_Delay((uint32_t)((pacer->next_deadline - now) * 1000 / pacer->freq) - 1);
+            now = SDL_GetPerformanceCounter();
+        }
+        while (SDL_GetPerformanceCounter() < pacer->next_deadline)
+            ;
+    }
+    pacer->next_deadline += pacer->period;
 }
 
 //  Final cleanup
 void final_cleanup(const sdl_t sdl){
+    if (sdl.audio) SDL_CloseAudioDevice(sdl.audio); // stops the callback before the audio state goes away
+    if (sdl.outlines[0]) SDL_DestroyTexture(sdl.outlines[0]);
+    if (sdl.outlines[1]) SDL_DestroyTexture(sdl.outlines[1]);
+    if (sdl.frame) SDL_DestroyTexture(sdl.frame);
     SDL_DestroyRenderer(sdl.renderer);
     SDL_DestroyWindow(sdl.window); // close the window
     SDL_Quit(); //shutdown SDL subsystem
 }
 
 
-// Initialise CHIP8 machine
-bool init_chip8(chip8_t *chip8, const char rom_name[]){
-    const uint32_t entry_point = 0x200; // CHIP8 ROM will be loaded to 0x200
-    const uint8_t font[] = {
-        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-        0x20, 0x60, 0x20, 0x20, 0x70, // 1
-        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-        0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-        0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-        0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-        0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-    };
-
-    // Load font
-    memcpy(&chip8->ram[0], font, sizeof(font));
-
-
-    // Load ROM to chip8 memory
-
-    // Open ROM file
-    FILE *rom = fopen(rom_name, "rb");
-    if (!rom){
-        SDL_Log("ROM File %s is invalid or does not exist\n", rom_name);
-        return false;
-    }
-    
-
-    // get/check rom size 
-    fseek(rom, 0, SEEK_END);
-    const size_t rom_size = ftell(rom);
-    const size_t max_size = sizeof chip8->ram - entry_point;
-    rewind(rom);
-
-    if (rom_size > max_size){
-        SDL_Log("ROM File %s is too big! ROM size: %zu, Max size allowed: %zu \n", rom_name, rom_size, max_size);
-        return false;
-    }
-
-
-    if (fread(&chip8->ram[entry_point], rom_size,1, rom ) !=1) {
-        SDL_Log("Could not read ROM file %s into CHIP8 memory\n", rom_name);
-        return false;
-    }
-
-    fclose(rom);
-    for(uint64_t i = 0; i < sizeof(chip8->ram)/sizeof(uint8_t); i+=2) {
-        printf("%ld: 0x%0X%0X\n",i,chip8->ram[i],chip8->ram[i+1]);
-    } 
-    printf("%ld",rom_size);
-
-    //set chip8 machine defaults
-    chip8->state = RUNNING;     // Default machine state to on/running 
-    chip8->PC = entry_point;    // start pc at ROM entry point
-    chip8->rom_name = rom_name;
-    chip8->stack_ptr = &chip8->stack[0];
-
-    return true; // success
-} 
-
-
 
 // Clear Screen / SDL Window to Background Color
 void clear_screen(const sdl_t sdl, const config_t config){
@@ -224,9 +330,27 @@ void clear_screen(const sdl_t sdl, const config_t config){
     SDL_RenderClear(sdl.renderer);
 }
 
-//Update window with any changes
-void update_screen(const sdl_t sdl, const config_t config, const chip8_t chip8){
-    SDL_Rect rect = {.x = 0, .y = 0, .w = config.scale_factor, .h = config.scale_factor};
+// Frame color of each pixel value (bit N = on in plane N): background, foreground, XO-CHIP second plane, both
+static inline void frame_palette(const config_t config, uint32_t palette[4]){
+    palette[0] = config.bg_color;
+    palette[1] = config.fg_color;
+    palette[2] = config.fg2_color;
+    palette[3] = config.blend_color;
+}
+
+// Pixel value at X,Y of a frame, bit N set if it is on in plane N
+static inline uint8_t frame_pixel(const frame_t *frame, const uint32_t x, const uint32_t y){
+    const uint32_t shift = 63 - x % 64;
+    return ((frame->display[0][y][x / 64] >> shift) & 1) | (((frame->display[1][y][x / 64] >> shift) & 1) << 1);
+}
+
+// Draw framebuffer with one SDL_RenderFillRect per CHIP8 pixel
+void update_screen_rects(const sdl_t sdl, const config_t config, const frame_t *frame){
+    const uint32_t width = frame->hires ? CHIP8_HIRES_WIDTH : CHIP8_WIDTH;
+    const uint32_t height = frame->hires ? CHIP8_HIRES_HEIGHT : CHIP8_HEIGHT;
+    const uint32_t window_w = config.window_width * config.scale_factor;
+    const uint32_t window_h = config.window_height * config.scale_factor;
+    SDL_Rect rect;
     
     //grab colour values to draw
     const uint8_t bg_r = (config.bg_color >> 24) & 0xFF; 
@@ -234,44 +358,145 @@ void update_screen(const sdl_t sdl, const config_t config, const chip8_t chip8){
     const uint8_t bg_b = (config.bg_color >> 8 ) & 0xFF;
     const uint8_t bg_a = (config.bg_color >> 0 ) & 0xFF;
 
-    const uint8_t fg_r = (config.fg_color >> 24) & 0xFF; 
-    const uint8_t fg_g = (config.fg_color >> 16) & 0xFF;
-    const uint8_t fg_b = (config.fg_color >> 8 ) & 0xFF;
-    const uint8_t fg_a = (config.fg_color >> 0 ) & 0xFF;
+    uint32_t palette[4];
+    frame_palette(config, palette);
 
     // loop through display pixels, draw a rectangle per pixel to the SDL Window
-    for (uint32_t i =0 ; i < sizeof chip8.display; i++){
-        // translate 1D index i value to 2D XY coordinates
-        // X = i % window_width
-        // Y = i / window_width
-        rect.x = (i % config.window_width) * config.scale_factor;
-        rect.y = (i / config.window_width) * config.scale_factor;
-
-        if (chip8.display[i]){
-            // If the pixel is on, draw foreground color
-            SDL_SetRenderDrawColor(sdl.renderer, fg_r, fg_g, fg_b, fg_a);
-            SDL_RenderFillRect(sdl.renderer, &rect);
-
-            // if user requested drawing pixel outlines, draw those here
-            if (config.pixel_outlines){
-                SDL_SetRenderDrawColor(sdl.renderer, bg_r, bg_g, bg_b, bg_a);
-                SDL_RenderDrawRect(sdl.renderer, &rect);
+    for (uint32_t y = 0; y < height; y++){
+        for (uint32_t x = 0; x < width; x++){
+            // the same window pixels the texture renderer's scaling and outlines give this pixel
+            rect.x = pixel_edge(x, window_w, width);
+            rect.y = pixel_edge(y, window_h, height);
+            rect.w = pixel_edge(x + 1, window_w, width) - rect.x;
+            rect.h = pixel_edge(y + 1, window_h, height) - rect.y;
+
+            const uint8_t pixel = frame_pixel(frame, x, y);
+            if (pixel){
+                // If the pixel is on, draw its plane's foreground color
+                const uint32_t color = palette[pixel];
+                SDL_SetRenderDrawColor(sdl.renderer, color >> 24, (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF);
+                SDL_RenderFillRect(sdl.renderer, &rect);
+
+                // if user requested drawing pixel outlines, draw those here
+                if (config.pixel_outlines){
+                    SDL_SetRenderDrawColor(sdl.renderer, bg_r, bg_g, bg_b, bg_a);
+                    SDL_RenderDrawRect(sdl.renderer, &rect);
 
-            }
+                }
 
 
-        }else{
-            //Pixel is off, draw background color
-            SDL_SetRenderDrawColor(sdl.renderer, bg_r, bg_g, bg_b, bg_a);
-            SDL_RenderFillRect(sdl.renderer, &rect);
+            }else{
+                //Pixel is off, draw background color
+                SDL_SetRenderDrawColor(sdl.renderer, bg_r, bg_g, bg_b, bg_a);
+                SDL_RenderFillRect(sdl.renderer, &rect);
+            }
+
         }
+    }
 
+    SDL_RenderPresent(sdl.renderer);
 
-    }
     
+}
+
+// Draw framebuffer by converting it into the frame texture and presenting it with a single copy
+void update_screen_texture(const sdl_t sdl, const config_t config, const frame_t *frame){
+    const uint32_t width = frame->hires ? CHIP8_HIRES_WIDTH : CHIP8_WIDTH;
+    const uint32_t height = frame->hires ? CHIP8_HIRES_HEIGHT : CHIP8_HEIGHT;
+
+    // only upload the band of rows between the first and last dirty row, the texture keeps the rest
+    const uint64_t dirty_rows = frame->hires ? frame->dirty_rows : frame->dirty_rows & ((1ull << CHIP8_HEIGHT) - 1);
+    if (!dirty_rows) return;
+    const uint32_t first_row = __builtin_ctzll(dirty_rows);
+    const uint32_t last_row = 63 - __builtin_clzll(dirty_rows);
+    const SDL_Rect band = {.x = 0, .y = first_row, .w = width, .h = last_row - first_row + 1};
+
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(sdl.frame, &band, &pixels, &pitch) != 0){
+        SDL_Log("Could not lock SDL frame texture %s\n", SDL_GetError());
+        return;
+    }
+
+    // texture is RGBA8888, same format as the config colors
+    uint32_t palette[4];
+    frame_palette(config, palette);
+    for (uint32_t y = first_row; y <= last_row; y++){
+        uint32_t *row = (uint32_t *)((uint8_t *)pixels + (y - first_row) * pitch);
+        for (uint32_t word = 0; word < width / 64; word++){
+            uint64_t plane0 = frame->display[0][y][word], plane1 = frame->display[1][y][word];
+            for (uint32_t x = 0; x < 64; x++, plane0 <<= 1, plane1 <<= 1){
+                *row++ = palette[(plane0 >> 63) | ((plane1 >> 63) << 1)];
+            }
+        }
+    }
+    SDL_UnlockTexture(sdl.frame);
+
+    // the part of the texture this resolution uses, stretched to the whole window
+    const SDL_Rect source = {.x = 0, .y = 0, .w = width, .h = height};
+    SDL_RenderCopy(sdl.renderer, sdl.frame, &source, NULL);
+    SDL_Texture *outlines = sdl.outlines[frame->hires];
+    if (outlines) SDL_RenderCopy(sdl.renderer, outlines, NULL, NULL);
+
     SDL_RenderPresent(sdl.renderer);
+}
 
-    
+//Update window with any changes, only called when frame->dirty_rows is set
+void update_screen(const sdl_t sdl, const config_t config, const frame_t *frame){
+    if (config.renderer == RENDERER_TEXTURE){
+        update_screen_texture(sdl, config, frame);
+    }else{
+        update_screen_rects(sdl, config, frame);
+    }
+}
+
+
+// Emulator shared by the SDL thread (input and presenting) and the emulation thread. The emulation thread
+//  owns the machine, the SDL thread only talks to it through the atomics and takes frames from the frame buffer
+typedef struct {
+    chip8_t *chip8;            // emulation thread
+    chip8_engine_t *engine;    // emulation thread
+    config_t config;           // emulation thread's copy, recording is switched off if it runs out of memory
+    chip8_movie_t *movie;      // emulation thread
+    chip8_rewind_t *rewind;    // emulation thread
+    bool rewind_enabled;
+    audio_t *audio;            // beeper, the emulation thread sets audio->playing
+    shm_export_t *shm;         // emulation thread, NULL without --shm
+    stream_export_t *stream;   // emulation thread, NULL without --stream
+    pacer_t pacer;             // emulation thread, read by the SDL thread once it has finished
+    frame_buffer_t frames;
+    uint32_t frame_event;      // SDL user event pushed when a frame is published, wakes the SDL thread
+
+    atomic_int state;          // emulator_state_t, only set by the SDL thread
+    atomic_uint keys;          // keypad bitmap (bit N = key N), only set by the SDL thread
+    atomic_uint commands;      // COMMAND_* bits, set by the SDL thread and cleared by the emulation thread
+    SDL_mutex *wake_lock;      // with wake: the emulation thread sleeps on it while paused
+    SDL_cond *wake;            // signalled by the SDL thread on every state change and command
+
+    bool keypad[16];           // SDL thread: keys held right now
+    bool redraw;               // SDL thread: window contents were lost, present everything
+    frame_t shown;             // SDL thread: display last presented
+} emulator_t;
+
+// One off requests from the SDL thread, run by the emulation thread between frames
+#define COMMAND_SAVE_STATE 1u
+#define COMMAND_LOAD_STATE 2u
+#define COMMAND_SAVE_TRACE 4u
+
+// Change the emulator state (SDL thread), waking the emulation thread if it is asleep while paused
+void set_state(emulator_t *emu, const emulator_state_t state){
+    SDL_LockMutex(emu->wake_lock);
+    atomic_store(&emu->state, state);
+    SDL_CondSignal(emu->wake);
+    SDL_UnlockMutex(emu->wake_lock);
+}
+
+// Queue COMMAND_* bits for the emulation thread (SDL thread), run between frames or straight away while paused
+void send_command(emulator_t *emu, const uint32_t command){
+    SDL_LockMutex(emu->wake_lock);
+    atomic_fetch_or(&emu->commands, command);
+    SDL_CondSignal(emu->wake);
+    SDL_UnlockMutex(emu->wake_lock);
 }
 
 // Handle user input
@@ -280,636 +505,326 @@ void update_screen(const sdl_t sdl, const config_t config, const chip8_t chip8){
 // 456D             qwer
 // 789E             asdf
 // A0BF             zxcv
-void handle_input(chip8_t *chip8){
-    SDL_Event event;
-    
-    while(SDL_PollEvent(&event)) {
-        switch (event.type){
-            case SDL_QUIT:
-                // Exit window; End program
-                chip8->state = QUIT; // Will exit main emulator loop
-                return;
-            
-            case SDL_KEYDOWN:
-
-                switch(event.key.keysym.sym){
-                    case SDLK_ESCAPE:
-                        //escape key; exit window & end program
-                        chip8->state = QUIT;
-                        return;
-                    case SDLK_SPACE:
-                        // Space bar - pause emulator
-                        if (chip8->state == RUNNING){
-                            chip8->state = PAUSED; //pause
-                            puts("=====PAUSED=====");
-
-                        }else{
-                            chip8->state = RUNNING; // resume
-                        }
-                        return;
-                    // map qwerty keys to chip8 keypad
-                    case SDLK_1: chip8->keypad[0x01] = true; break;
-                    case SDLK_2: chip8->keypad[0x02] = true; break;
-                    case SDLK_3: chip8->keypad[0x03] = true; break;
-                    case SDLK_4: chip8->keypad[0x0C] = true; break;
-
-                    case SDLK_q: chip8->keypad[0x04] = true; break;
-                    case SDLK_w: chip8->keypad[0x05] = true; break;
-                    case SDLK_e: chip8->keypad[0x06] = true; break;
-                    case SDLK_r: chip8->keypad[0x0D] = true; break;
-
-                    case SDLK_a: chip8->keypad[0x07] = true; break;
-                    case SDLK_s: chip8->keypad[0x08] = true; break;
-                    case SDLK_d: chip8->keypad[0x09] = true; break;
-                    case SDLK_f: chip8->keypad[0x0E] = true; break;
-
-                    case SDLK_z: chip8->keypad[0x0A] = true; break;
-                    case SDLK_x: chip8->keypad[0x00] = true; break;
-                    case SDLK_c: chip8->keypad[0x0B] = true; break;
-                    case SDLK_v: chip8->keypad[0x0F] = true; break;
-                    
-                    default:
-                        break;
-                }
-                break;
-
-            case SDL_KEYUP:  
-                switch(event.key.keysym.sym){
-                    // map qwerty keys to chip8 keypad
-                    case SDLK_2: chip8->keypad[0x02] = false; break;
-                    case SDLK_1: chip8->keypad[0x01] = false; break;
-                    case SDLK_3: chip8->keypad[0x03] = false; break;
-                    case SDLK_4: chip8->keypad[0x0C] = false; break;
-
-                    case SDLK_q: chip8->keypad[0x04] = false; break;
-                    case SDLK_w: chip8->keypad[0x05] = false; break;
-                    case SDLK_e: chip8->keypad[0x06] = false; break;
-                    case SDLK_r: chip8->keypad[0x0D] = false; break;
-
-                    case SDLK_a: chip8->keypad[0x07] = false; break;
-                    case SDLK_s: chip8->keypad[0x08] = false; break;
-                    case SDLK_d: chip8->keypad[0x09] = false; break;
-                    case SDLK_f: chip8->keypad[0x0E] = false; break;
-
-                    case SDLK_z: chip8->keypad[0x0A] = false; break;
-                    case SDLK_x: chip8->keypad[0x00] = false; break;
-                    case SDLK_c: chip8->keypad[0x0B] = false; break;
-                    case SDLK_v: chip8->keypad[0x0F] = false; break;
-                    
-                    default:
-                        break;
-                }
-                break;
+// F5 saves state to <rom_name>.state, F9 loads it back
+// F12 saves the instruction trace to <rom_name>.trace (DEBUG builds)
+// Hold backspace to rewind
+void handle_event(emulator_t *emu, const config_t config, const SDL_Event *event){
+    switch (event->type){
+        case SDL_QUIT:
+            // Exit window; End program
+            set_state(emu, QUIT); // Will exit main emulator loop
+            return;
+        
+        case SDL_WINDOWEVENT:
+            // window contents were lost (uncovered/resized), redraw everything next frame
+            if (event->window.event == SDL_WINDOWEVENT_EXPOSED || event->window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                emu->redraw = true;
+            break;
 
-            default:
-                break;
-         }
-    }
-}
+        case SDL_KEYDOWN:
+
+            switch(event->key.keysym.sym){
+                case SDLK_ESCAPE:
+                    //escape key; exit window & end program
+                    set_state(emu, QUIT);
+                    return;
+                case SDLK_SPACE:
+                    // Space bar - pause emulator
+                    if (atomic_load(&emu->state) == RUNNING){
+                        set_state(emu, PAUSED); //pause
+                        puts("=====PAUSED=====");
 
+                    }else{
+                        set_state(emu, RUNNING); // resume
+                    }
+                    return;
+                case SDLK_BACKSPACE:
+                    // rewind for as long as backspace is held, not while recording (the movie only goes forwards)
+                    if (atomic_load(&emu->state) == RUNNING && !config.record_path) set_state(emu, REWINDING);
+                    return;
+                case SDLK_F5:
+                    // save state next to the ROM, done by the emulation thread between frames
+                    send_command(emu, COMMAND_SAVE_STATE);
+                    return;
+                case SDLK_F9:
+                    if (config.record_path) SDL_Log("Can't load a state while recording a movie\n");
+                    else send_command(emu, COMMAND_LOAD_STATE);
+                    return;
 #ifdef DEBUG
-void print_debug_info(chip8_t *chip8){
-    printf("Address: 0x%04X, Opcode: 0x%04x Desc: ",chip8->PC-2, chip8->inst.opcode);
-    switch ((chip8->inst.opcode >> 12) & 0x0F){ // get top 4 MSBs
-        case 0x00:
-            if ( chip8->inst.NN == 0xE0){
-                //0x00E0: clear screen
-                printf("Clear screen\n");
-                memset(&chip8->display[0], false, sizeof chip8->display);
-            } else if (chip8->inst.NN == 0xEE){
-                // 0x0EEE: return from subroutine
-                // Set PC to  last address on subroutine stack ("pop" it off the stack )
-                //  so next opcode is retrieved from that address
-                printf("Return from subroutine to address 0x%04X\n", *(chip8->stack_ptr-1));
-                chip8->PC = *--chip8->stack_ptr;
-            }else{
-                printf("Unimplemented opcode\n");
-            }
-            break;
-        case 0x01:
-            // 0x1NNN: Jumps to address NNN
-            printf("Jump to address NNN (0x%04X)\n", chip8->inst.NNN);
-            break;
-        case 0x02:
-            // 0x2NNN: Call subroutine at NNN
-            // store current address to return to on subroutine stack ("push" it on the stack)
-            //   and set PC to subroutine address so next opcode is gotten from there
-            *chip8->stack_ptr++ = chip8->PC; 
-            chip8->PC = chip8->inst.NNN;
-            break;
-        case 0x03:
-            // 0x3XNN: Skips next instruction if VX equals NN
-            printf("Check if V%X (0x%02X) == NN (0x%02X), skip next instruction if true\n",
-                chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.NN);
-            break;
-        case 0x04:
-            // 0x4XNN: Skips next instruction if VX does not equal NN
-            printf("Check if V%X (0x%02X) == NN (0x%02X), skip next instruction if false\n",
-                chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.NN);
-            break;
-        case 0x05:
-            // 0x5XY0: Skips next instruction if VX equals VY
-            printf("Check if V%X (0x%02X) == V%X (0x%02X), skip next instruction if true\n",
-                chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.Y, chip8->V[chip8->inst.Y]);
-            break;
-        case 0x06:
-            // 0x06NN: Set register VX to NN
-            printf("Set register V%X = NN (0x%2X)\n",
-            chip8->inst.X, chip8->inst.NN);
-            break;
-        case 0x07:
-            // 0x07XNN: Set register VX += NN
-            printf("Set register V%X (0x%02X) += NN (%0x2X). Result 0x%02XN \n",
-            chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.NN,
-            chip8->V[chip8->inst.X] +chip8->inst.NN );
-            break;
-        case 0x08:
-            switch(chip8->inst.N){
-                case 0:
-                    // 0x8XY0: set register VX = VY 
-                    printf("Set register V%0X = V%0X (0x%02X)\n",
-                        chip8->inst.X, chip8->inst.Y, chip8->V[chip8->inst.Y]);
-                    break;
-                case 1:
-                    // 0x8XY1: set register VX to VX ORd with VY
-                    printf("Set register V%0X (0x%02X) |= V%0X (0x%02X); Result: 0x%02X\n",
-                        chip8->inst.X, chip8->V[chip8->inst.X],
-                         chip8->inst.Y, chip8->V[chip8->inst.Y],
-                         chip8->V[chip8->inst.X] | chip8->V[chip8->inst.Y]);
-                    break;
-                case 2:
-                    // 0x8XY2: set register VX to VX ANDd with VY
-                    printf("Set register V%0X (0x%02X) &= V%0X (0x%02X); Result: 0x%02X\n",
-                        chip8->inst.X, chip8->V[chip8->inst.X],
-                         chip8->inst.Y, chip8->V[chip8->inst.Y],
-                         chip8->V[chip8->inst.X] & chip8->V[chip8->inst.Y]);
-                    break;
-                case 3:
-                    // 0x8XY3: set register VX to VX XORd with VY
-                    printf("Set register V%0X (0x%02X) ^= V%0X (0x%02X); Result: 0x%02X\n",
-                        chip8->inst.X, chip8->V[chip8->inst.X],
-                         chip8->inst.Y, chip8->V[chip8->inst.Y],
-                         chip8->V[chip8->inst.X] ^ chip8->V[chip8->inst.Y]);
-                    break;
-                case 4:
-                    // 0x8XY4: set register VX to VX + VY, set VF to 1 if carry 
-                    printf("Set register V%0X (0x%02X) += V%0X (0x%02X), VF = 1 if carry; Result: 0x%02X, VF = %X\n",
-                        chip8->inst.X, chip8->V[chip8->inst.X],
-                         chip8->inst.Y, chip8->V[chip8->inst.Y],
-                         chip8->V[chip8->inst.X] + chip8->V[chip8->inst.Y], 
-                         ((uint16_t) chip8->V[chip8->inst.X] +  chip8->V[chip8->inst.Y] > 255)); 
-                    break;
-                case 5:
-                    // 0x8XY5: set register VX to VX - VY, set VF to 1 if there is not a borrow (result is +ve/0)
-                    printf("Set register V%0X (0x%02X) -= V%0X (0x%02X), VF = 1 if no borrow; Result: 0x%02X, VF = %X\n",
-                        chip8->inst.X, chip8->V[chip8->inst.X],
-                         chip8->inst.Y, chip8->V[chip8->inst.Y],
-                         chip8->V[chip8->inst.X] - chip8->V[chip8->inst.Y], 
-                         ( chip8->V[chip8->inst.X] >=  chip8->V[chip8->inst.Y])); 
-                    break;
-                case 6:
-                    // 0x8XY6: right shift VX by 1, store LSB of VX before shift to VF
-                    printf("Set register V%0X (0x%02X) >>= V%0X (0x%02X), VF = shifted off bit (%X); Result: 0x%02X\n",
-                        chip8->inst.X, chip8->V[chip8->inst.X],
-                         chip8->inst.Y, chip8->V[chip8->inst.Y],
-                         (chip8->V[chip8->inst.X] >> 1), 
-                         (chip8->V[chip8->inst.X] & 1)); 
-                    break;
-                case 7:
-                    // 0x8XY7: set register VX to VY - VX, set VF to 1 if there is not a borrow (result is +ve/0)
-                    printf("Set register V%0X (0x%02X) = V%0X (0x%02X) - V%0X (0x%02X), VF = 1 if no borrow; Result: 0x%02X, VF = %X\n",
-                        chip8->inst.X, chip8->V[chip8->inst.X],
-                         chip8->inst.Y, chip8->V[chip8->inst.Y],
-                         chip8->inst.X, chip8->V[chip8->inst.X],
-                         chip8->V[chip8->inst.Y] - chip8->V[chip8->inst.X], 
-                         ( chip8->V[chip8->inst.X] <=  chip8->V[chip8->inst.Y]));  
-                    break;
-                case 0xE:
-                    // 0x8XYE: left shift VX by 1, store LSB of VX before shift to VF
-                    printf("Set register V%0X (0x%02X) <<= 1, VF = shifted off bit (%X); Result: 0x%02X\n",
-                        chip8->inst.X, chip8->V[chip8->inst.X],
-                         ((chip8->V[chip8->inst.X] & 0x80) >> 7),
-                         (chip8->V[chip8->inst.X] << 1)); 
-                    break;
+                case SDLK_F12:
+                    // dump the recent instruction history for chip8-trace
+                    send_command(emu, COMMAND_SAVE_TRACE);
+                    return;
+#endif
+                // map qwerty keys to chip8 keypad
+                case SDLK_1: emu->keypad[0x01] = true; break;
+                case SDLK_2: emu->keypad[0x02] = true; break;
+                case SDLK_3: emu->keypad[0x03] = true; break;
+                case SDLK_4: emu->keypad[0x0C] = true; break;
+
+                case SDLK_q: emu->keypad[0x04] = true; break;
+                case SDLK_w: emu->keypad[0x05] = true; break;
+                case SDLK_e: emu->keypad[0x06] = true; break;
+                case SDLK_r: emu->keypad[0x0D] = true; break;
+
+                case SDLK_a: emu->keypad[0x07] = true; break;
+                case SDLK_s: emu->keypad[0x08] = true; break;
+                case SDLK_d: emu->keypad[0x09] = true; break;
+                case SDLK_f: emu->keypad[0x0E] = true; break;
+
+                case SDLK_z: emu->keypad[0x0A] = true; break;
+                case SDLK_x: emu->keypad[0x00] = true; break;
+                case SDLK_c: emu->keypad[0x0B] = true; break;
+                case SDLK_v: emu->keypad[0x0F] = true; break;
+                
                 default:
-                    // unimplemented opcode
                     break;
             }
             break;
-        case 0x09:
-            // 0x9XY0: Skips the next instruction if VX != VY
-            printf("Check if V%0X (0x%02X) != V%0X (0x%02X), skip next instruction if true\n",
-                chip8->inst.X, chip8->V[chip8->inst.X],
-                 chip8->inst.Y, chip8->V[chip8->inst.Y]);
-            break;
-        case 0x0A:
-            // 0x0ANNN: Set index register I to NNN
-            printf("Set I to NNN (0x%04X)\n", chip8->inst.NNN);
-            break;
-        case 0x0B:
-            // 0xBNNN: Jumps to the address NNN plux V0
-            printf("Set PC to V0 (0x%02X) + NNN (0x%04X); Result = 0x%04X\n",
-                chip8->V[0], chip8->inst.NNN, chip8->V[0] + chip8->inst.NNN);
-            break;
-        case 0x0C:
-            // 0xCXNN: Sets register VX = rand() % 256 & NN (bitwise AND)
-            printf("Set V%X = rand() %% 256 & NN (0x%02X)\n", chip8->inst.X, chip8->inst.NN);
-            chip8->V[chip8->inst.X] = rand() % 256 & chip8->inst.NN;
-            break;
-        case 0x0D:
-            // 0xDXYN: Draw N height sprite at coordinates X,Y; read from mem location I;
-            // screen pixels are xor'd with sprite bits 
-            // VF (carry flag) is set if any screen pixels are set off; useful for 
-            // collision detections and other stuff
-            printf("Draw N (%u) height sprite at coords V%X (0x%02X), V%X (0x%02X)"
-             "from memory location I (%04X). Set VF = 1 if any pixels are turned off\n",
-             chip8->inst.N, chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.Y, chip8->V[chip8->inst.Y], chip8->I );
-            break;
-        case 0xE:
-            if (chip8->inst.NN == 0x9E){
-                // 0xEX9E: skip next instruction if key in VX is pressed 
-                printf("Skip next instruction if key in V%X (0x%02X) is pressed; Keypad value %d\n", 
-                    chip8->inst.X, chip8->V[chip8->inst.X], chip8->keypad[chip8->V[chip8->inst.X]]);
-
-            }else if(chip8->inst.NN == 0xA1){
-                // 0xEX9E: skip next instruction if key in VX is not pressed
-                printf("Skip next instruction if key in V%X (0x%02X) is not pressed; Keypad value %d\n", 
-                    chip8->inst.X, chip8->V[chip8->inst.X], chip8->keypad[chip8->V[chip8->inst.X]]);
 
+        case SDL_KEYUP:  
+            if (event->key.keysym.sym == SDLK_BACKSPACE && atomic_load(&emu->state) == REWINDING){
+                set_state(emu, RUNNING); // back to normal from wherever rewinding got to
+                return;
             }
-            break;
-        case 0xF:
-            switch(chip8->inst.NN){
-                case 0x0A:
-                    // 0xFX0A: VX = getkey(); Await until a keypress, and store in VX
-                    printf("Await until a key is pressed; Store key in V%X\n",
-                        chip8->inst.X);
-                    break;
-
-                case 0x1E:
-                    // 0FX1E: I+= VX; Add VX to register I. For non-Amiga CHIP8, does not affect VF 
-                    printf("I (0%04X) += V%X (0x%02X); Result (I): 0x%04X\n",
-                        chip8->I, chip8->inst.X, chip8->V[chip8->inst.X],
-                         chip8->I + chip8->V[chip8->inst.X]);
-                    break;
-                case 0x07:
-                    // 0xFX07: set VX to the value of delay timer
-                    printf("Set V%x = delay timer (0x%02X)\n",
-                        chip8->inst.X, chip8->delay_timer);
-                    break;
-
-                case 0x15:
-                    // 0xFX15: set delay timer to value of VX
-                    printf("Set Delay Timer = V%x (0x%02X) \n",
-                         chip8->inst.X, chip8->V[chip8->inst.X]);
-                    break;
+            switch(event->key.keysym.sym){
+                // map qwerty keys to chip8 keypad
+                case SDLK_2: emu->keypad[0x02] = false; break;
+                case SDLK_1: emu->keypad[0x01] = false; break;
+                case SDLK_3: emu->keypad[0x03] = false; break;
+                case SDLK_4: emu->keypad[0x0C] = false; break;
+
+                case SDLK_q: emu->keypad[0x04] = false; break;
+                case SDLK_w: emu->keypad[0x05] = false; break;
+                case SDLK_e: emu->keypad[0x06] = false; break;
+                case SDLK_r: emu->keypad[0x0D] = false; break;
+
+                case SDLK_a: emu->keypad[0x07] = false; break;
+                case SDLK_s: emu->keypad[0x08] = false; break;
+                case SDLK_d: emu->keypad[0x09] = false; break;
+                case SDLK_f: emu->keypad[0x0E] = false; break;
+
+                case SDLK_z: emu->keypad[0x0A] = false; break;
+                case SDLK_x: emu->keypad[0x00] = false; break;
+                case SDLK_c: emu->keypad[0x0B] = false; break;
+                case SDLK_v: emu->keypad[0x0F] = false; break;
                 
-                case 0x18:
-                    // 0xFX18: set VX to the value of sound timer
-                    printf("Set Sound Timer = V%x (0x%02X) \n",
-                         chip8->inst.X, chip8->V[chip8->inst.X]);
-                    break;
-                case 0x29:
-                    // 0xFX29: set register I to sprite location in memory for character in VX (0x0-0xF)
-                    printf("Set I to sprite location in memory for character in V%X (0x%2X). Result (VX*5) = (0x%2X) \n",
-                        chip8->inst.X, chip8->V[chip8->inst.X], chip8->V[chip8->inst.X] *5);
-                    break;
-                case 0x33:
-                    // 0xFX33: Store BCD (binary coded decimal) representation of VX at memory offset from I;
-                    //      I = hundred's place, I + 1 = ten's place, I + 2 = one's place
-                    printf("Store the BCD representation of V%X (0x%02X) at memory from I (0x%04X)\n",
-                        chip8->inst.X, chip8->V[chip8->inst.X], chip8->I);
-                    break;
-                case 0x55:
-                    // 0xFX55: Register dump V0-VF inclusive to memory offset from I;
-                    // SCHIP does not increment I, CHIP8 does increment I
-                    printf("Register dump V0-V%X (0x%02X) inclusive at memory offset from I (0x%04X)\n",
-                        chip8->inst.X, chip8->V[chip8->inst.X], chip8->I);
-                    break;
-                case 0x65:
-                    // 0xFX65: Register load V0-VF from memory offset from I;
-                    // SCHIP does not increment I, CHIP8 does increment I
-                    printf("Register load V0-V%X (0x%02X) from memory offset from I (0x%04X)\n",
-                        chip8->inst.X, chip8->V[chip8->inst.X], chip8->I);
                 default:
                     break;
             }
             break;
+
         default:
-            printf("Unimplemented opcode\n");
-            break; //unimplemented or invalid opcode
+            break;
     }
-
 }
-#endif
 
+// Handle all pending user input, then pass the keypad on to the emulation thread
+void handle_input(emulator_t *emu, const config_t config){
+    SDL_Event event;
 
-// Emulate 1 CHIP8 instruction
-void emulate_instruction(chip8_t *chip8, config_t config){
-    // since x86 is little endian and chip 8 is big endian
-    // get next opcode from ROM/ram
-    chip8->inst.opcode = (chip8->ram[chip8->PC] << 8) | chip8 -> ram[chip8->PC+1];
-    chip8->PC +=2; // preincrement PC for next opcode -- 2 bytes 
-
-    // fill out current instruction format
-    // DXYN
-    chip8->inst.NNN = chip8->inst.opcode & 0x0FFF;
-    chip8->inst.NN = chip8->inst.opcode & 0x0FF;
-    chip8->inst.N = chip8->inst.opcode & 0x0F;
-    chip8->inst.X = (chip8->inst.opcode >> 8) & 0x0F; // right bit shift by 8 to get bits 9-12 
-    chip8->inst.Y = (chip8->inst.opcode >> 4) & 0x0F; // right bit shift by 4 to get bits 5-8
-
-    #ifdef DEBUG
-        print_debug_info(chip8);
-    #endif
-
-
-    //emulate opcode 
-    switch ((chip8->inst.opcode >> 12) & 0x0F){ // get top 4 MSBs
-        case 0x00:
-            if ( chip8->inst.NN == 0xE0){
-                //0x00E0: clear screen
-                memset(&chip8->display[0], false, sizeof chip8->display);
-            } else if (chip8->inst.NN == 0xEE){
-                // 0x0EEE: return from subroutine
-                // Set PC to  last address on subroutine stack ("pop" it off the stack )
-                //  so next opcode is retrieved from that address
-                chip8->PC = *--chip8->stack_ptr;
-            } else{
-                // unimplemented/invalid opcode, may be 0xNNN for calling machine code routine for RCA1802
-            }
-            break;
-        case 0x01:
-            // 0x1NNN: Jumps to address NNN
-            chip8->PC = chip8->inst.NNN; // set PC so that next opcode is from NNN
-            break;
-        case 0x02:
-            // 0x2NNN: Call subroutine at NNN
-            // store current address to return to on subroutine stack ("push" it on the stack)
-            //   and set PC to subroutine address so next opcode is gotten from there
-            *chip8->stack_ptr++ = chip8->PC; 
-            chip8->PC = chip8->inst.NNN;
-            break;
-        case 0x03:
-            // 0x3XNN: Skips next instruction if VX equals NN
-            if (chip8->V[chip8->inst.X] == chip8->inst.NN){
-                chip8->PC+=2;   //skip next opcode/instruction
-            }
-            break;
-        case 0x04:
-            // 0x4XNN: Skips next instruction if VX does not equal NN
-            if (chip8->V[chip8->inst.X] != chip8->inst.NN){
-                chip8->PC+=2;   //skip next opcode/instruction
-            }
-            break;
-        case 0x05:
-            // 0x5XY0: Skips next instruction if VX equals VY#
-            if (chip8->V[chip8->inst.X] == chip8->V[chip8->inst.Y]){
-                chip8->PC+=2;   //skip next opcode/instruction
-            }
-            break;
-        case 0x06:
-            // 0x06NN: Set register VX to NN
-            chip8->V[chip8->inst.X] = chip8->inst.NN;
-            break;
-        case 0x07:
-            // 0x07XNN: Set register VX += NN
-            chip8->V[chip8->inst.X] += chip8->inst.NN;
-            break;
-        case 0x08:
-            switch(chip8->inst.N){
-                case 0:
-                    // 0x8XY0: set register VX = VY 
-                    chip8->V[chip8->inst.X] = chip8->V[chip8->inst.Y]; 
-                    break;
-                case 1:
-                    // 0x8XY1: set register VX to VX ORd with VY
-                    chip8->V[chip8->inst.X] |= chip8->V[chip8->inst.Y]; 
-                    break;
-                case 2:
-                    // 0x8XY2: set register VX to VX ANDd with VY
-                    chip8->V[chip8->inst.X] &= chip8->V[chip8->inst.Y]; 
-                    break;
-                case 3:
-                    // 0x8XY3: set register VX to VX XORd with VY
-                    chip8->V[chip8->inst.X] ^= chip8->V[chip8->inst.Y]; 
-                    break;
-                case 4:
-                    // 0x8XY4: set register VX to VX + VY, set VF to 1 if carry 
-                    if((uint16_t)chip8->V[chip8->inst.X] + chip8->V[chip8->inst.Y] > 255){
-                        chip8->V[0xF] = 1;
-                    }else{
-                        chip8->V[0xF] = 0;
-                    }
-                    chip8->V[chip8->inst.X] += chip8->V[chip8->inst.Y]; 
-                    break;
-                case 5:
-                    // 0x8XY5: set register VX to VX - VY, set VF to 1 if there is not a borrow (result is +ve/0)
-                    if(chip8->V[chip8->inst.X] >= chip8->V[chip8->inst.Y]){
-                        chip8->V[0xF] = 1;
-                    }else{
-                        chip8->V[0xF] = 0;
-                    }
-                    chip8->V[chip8->inst.X] -= chip8->V[chip8->inst.Y]; 
-                    break;
-                case 6:
-                    // 0x8XY6: right shift VX by 1, store LSB of VX before shift to VF
-                    chip8->V[0xF] = chip8->V[chip8->inst.X] & 1;
-                    chip8->V[chip8->inst.X] >>= 1;
-                    break;
-                case 7:
-                    // 0x8XY7: set register VX to VY - VX, set VF to 1 if there is not a borrow (result is +ve/0)
-                    if(chip8->V[chip8->inst.X] <= chip8->V[chip8->inst.Y]){
-                        chip8->V[0xF] = 1;
-                    }else{
-                        chip8->V[0xF] = 0;
-                    }
-                    chip8->V[chip8->inst.X] = chip8->V[chip8->inst.Y] - chip8->V[chip8->inst.X]; 
-                    break;
-                case 0xE:
-                    // 0x8XYE: left shift VX by 1, store LSB of VX before shift to VF
-                    chip8->V[0xF] = ((chip8->V[chip8->inst.X]) & 0x80) >> 7;
-                    chip8->V[chip8->inst.X] <<= 1;
-                    break;
-                default:
-                    // unimplemented opcode
-                    break;
-            }
-            break;
-        case 0x09:
-            // 0x9XY0: Skips the next instruction if VX != VY
-            if (chip8->V[chip8->inst.X] != chip8->V[chip8->inst.Y]){
-                chip8->PC+=2;
-            }
-            break;
-        case 0x0A:
-            // 0xANNN: Set index register I to NNN
-            chip8->I  = chip8->inst.NNN;
-            break;
-        case 0x0B:
-            // 0xBNNN: Jumps to the address NNN plux V0
-            chip8->PC = chip8->V[0x0] + chip8->inst.NNN;
-            break;
-        case 0x0C:
-            // 0xCXNN: Sets register VX = rand() % 256 & NN (bitwise AND)
-            chip8->V[chip8->inst.X] = (rand() % 256) & chip8->inst.NN;
-            break;
-        case 0x0D:
-            // 0xDXYN: Draw N height sprite at coordinates X,Y; read from mem location I;
-            // screen pixels are xor'd with sprite bits 
-            // VF (carry flag) is set if any screen pixels are set off; useful for 
-            // collision detections and other stuff
-
-            uint8_t X_coord = chip8->V[chip8->inst.X] % config.window_width; 
-            uint8_t Y_coord = chip8->V[chip8->inst.Y] % config.window_height;
-            const uint8_t orig_X = X_coord; // original X value
-
+    while(SDL_PollEvent(&event)) {
+        handle_event(emu, config, &event);
+    }
 
-            chip8->V[0xF] = 0; // initialise carry flag to 0
+    uint32_t keys = 0;
+    for (uint32_t i = 0; i < sizeof emu->keypad; i++) keys |= (uint32_t)emu->keypad[i] << i;
+    atomic_store(&emu->keys, keys);
+}
 
-            // loop over all N rows of the sprite
-            for ( uint8_t i = 0; i< chip8->inst.N;i++){
-                // get next byte/ row of sprite data
-                const uint8_t sprite_data = chip8->ram[chip8->I + i];
-                X_coord = orig_X; // reset X for next row to draw
+// Present the newest frame from the emulation thread, if there is one and it changed anything
+void present_frame(const sdl_t sdl, const config_t config, emulator_t *emu){
+    frame_t *frame = take_frame(&emu->frames);
+    if (!frame){
+        if (!emu->redraw) return;
+        frame = &emu->frames.frames[emu->frames.front]; // nothing new, draw the last frame again
+    }
 
-                for (int8_t j = 7; j >= 0; j--){
-                    bool *pixel = &chip8->display[Y_coord * config.window_width + X_coord];
-                    const bool sprite_bit = sprite_data & ( 1 << j );
-                    // if sprite pixel/bit is on and display pixel is on, set carry flag
-                    if ( sprite_bit && *pixel) {
+    // only rows that changed since the last present are redrawn, however many frames were skipped in between;
+    //  everything when the resolution changed
+    frame->dirty_rows = emu->redraw || frame->hires != emu->shown.hires ? DIRTY_ALL_ROWS : 0;
+    for (uint32_t y = 0; y < CHIP8_HIRES_HEIGHT; y++){
+        for (uint32_t plane = 0; plane < CHIP8_PLANES; plane++){
+            if (memcmp(frame->display[plane][y], emu->shown.display[plane][y], sizeof frame->display[plane][y]))
+                frame->dirty_rows |= 1ull << y;
+        }
+    }
+    if (!frame->dirty_rows) return;
 
-                        chip8->V[0xF] = 1;
+    update_screen(sdl, config, frame);
+    memcpy(emu->shown.display, frame->display, sizeof emu->shown.display);
+    emu->shown.hires = frame->hires;
+    emu->redraw = false;
+}
 
-                    }
 
-                    // XOR display pixel with sprite pixel/bit to set it on/off
-                    *pixel ^= sprite_bit;
+// Set the machine's keypad from the SDL thread's keypad bitmap
+void apply_keys(chip8_t *chip8, const uint32_t keys){
+    for (uint32_t i = 0; i < sizeof chip8->keypad; i++) chip8->keypad[i] = (keys >> i) & 1;
+}
 
-                    // stop drawing if hit right edge of screen
-                    if(++X_coord >= config.window_width) break; 
-                }
+// Emulation thread: run the save/load requests from the SDL thread
+void run_commands(emulator_t *emu){
+    const uint32_t commands = atomic_exchange(&emu->commands, 0);
+    if (!commands) return;
+
+    chip8_t *chip8 = emu->chip8;
+    char path[4096];
+    snprintf(path, sizeof path, "%s.state", chip8->rom_name);
+    if ((commands & COMMAND_SAVE_STATE) && save_snapshot_file(chip8, path)) SDL_Log("Saved state to %s\n", path);
+    if ((commands & COMMAND_LOAD_STATE) && load_snapshot_file(chip8, path)){
+        init_engine(emu->engine, emu->config.engine); // RAM was replaced, throw away decoded code
+        SDL_Log("Loaded state from %s\n", path);
+    }
+#ifdef DEBUG
+    snprintf(path, sizeof path, "%s.trace", chip8->rom_name);
+    if ((commands & COMMAND_SAVE_TRACE) && save_trace_file(chip8->trace, path))
+        SDL_Log("Saved instruction trace to %s\n", path);
+#endif
+}
 
-                // stop drawing entire sprite if hit bottom edge of screen
-                if (++Y_coord >= config.window_height) break;
+// longest sleep while paused with --stream, well inside STREAM_VIEWER_TIMEOUT_MS
+#define PAUSED_STREAM_WAKE_MS 500
+
+// Emulation thread: emulate in step with real time and publish every frame that changed the display,
+//  until the SDL thread asks to quit. Presenting happens on the SDL thread, so a slow present or a driver
+//  stall doesn't hold up emulated time
+int emulation_thread(void *data){
+    emulator_t *emu = data;
+    chip8_t *chip8 = emu->chip8;
+    chip8_engine_t *engine = emu->engine;
+    pacer_t *pacer = &emu->pacer;
+    init_pacer(pacer);
+
+    while ((chip8->state = atomic_load(&emu->state)) != QUIT){
+        const config_t config = emu->config;
+        run_commands(emu);
+        // an agent on --shm plays along with the keyboard
+        const uint32_t keys = atomic_load(&emu->keys) | (emu->shm ? shm_keys(emu->shm) : 0);
+        apply_keys(chip8, keys);
+        if (config.record_path && !record_keypad(emu->movie, chip8)) emu->config.record_path = NULL;
+
+        if (chip8->state == PAUSED){
+            // nothing to do (or play) until the SDL thread says so
+            atomic_store_explicit(&emu->audio->playing, false, memory_order_relaxed);
+
+            // sleep until the SDL thread resumes, quits or sends a command. Streaming still wakes up now and then
+            //  to take viewers' hellos so they stay registered (nothing new is sent while paused)
+            SDL_LockMutex(emu->wake_lock);
+            if (atomic_load(&emu->state) == PAUSED && !atomic_load(&emu->commands)){
+                if (emu->stream) SDL_CondWaitTimeout(emu->wake, emu->wake_lock, PAUSED_STREAM_WAKE_MS);
+                else SDL_CondWait(emu->wake, emu->wake_lock);
             }
+            SDL_UnlockMutex(emu->wake_lock);
+            if (emu->stream) publish_stream(emu->stream, chip8);
 
-            break;
+            reset_pacer(pacer); // don't try to catch up on the time spent paused
+            continue;
+        }
 
-        case 0xE:
-            if (chip8->inst.NN == 0x9E){
-                // 0xEX9E: skip next instruction if key in VX is pressed 
-                if (chip8->keypad[chip8->V[chip8->inst.X]]){
-                    chip8->PC+=2;
-                }
+        if (chip8->state == REWINDING){
+            // step back 1 recorded frame per host frame, the keys held right now stay held
+            reset_pacer(pacer); // no emulated time passes while rewinding
+            if (emu->rewind_enabled && pop_rewind(emu->rewind, chip8)) init_engine(engine, config.engine); // RAM replaced
+            apply_keys(chip8, keys);
+        }else if (config.turbo){
+            // Uncapped: keep emulating 1/60s frames until this host frame's time is used up,
+            //  timers tick once per emulated frame so games still see 60hz
+            do {
+                run_frame(chip8, engine, config);
+            } while (SDL_GetPerformanceCounter() < pacer->next_deadline);
+        }else{
+            // Emulate however many cycles (scaled by --speed) are due for the real time that passed,
+            //  the timers tick inside at exactly 60hz of emulated time
+            const uint64_t ticks_before = chip8->timer_ticks;
+            run_cycles(chip8, engine, config, pacer_cycles_due(pacer, config));
+
+            // only the last of several emulated frames run in one host frame gets shown
+            const uint64_t frames_run = chip8->timer_ticks - ticks_before;
+            if (frames_run > 1) pacer->dropped_frames += frames_run - 1;
+        }
 
-                
+        // beep while the sound timer runs (never while rewinding, that would just be noise)
+        atomic_store_explicit(&emu->audio->playing, chip8->state == RUNNING && chip8->sound_timer > 0,
+                              memory_order_relaxed);
 
-            }else if(chip8->inst.NN == 0xA1){
-                // 0xEX9E: skip next instruction if key in VX is not pressed
-                if (!chip8->keypad[chip8->V[chip8->inst.X]]){
-                    chip8->PC+=2;
-                }
+        // record this frame for rewinding
+        if (emu->rewind_enabled && chip8->state == RUNNING) push_rewind(emu->rewind, chip8);
 
+        // every host frame goes out to shared memory, changed or not, so agents can count on a steady rate
+        if (emu->shm) publish_shm(emu->shm, chip8);
 
-            }
-            break;
-        
-        case 0xF:
-            switch(chip8->inst.NN){
-                case 0x0A:
-                    // 0xFX0A: VX = getkey(); Await until a keypress, and store in VX
-                    bool any_key_pressed = false;
-                    for (uint8_t i=0; i < sizeof chip8->keypad;i++){
-                        if (chip8->keypad[i]){
-                            chip8->V[chip8->inst.X]  = i; // i = key (offset into keypad array)
-                            any_key_pressed = true;
-                            break;
-                        }
-                    }
-                    // if no key has been pressed, 
-                    //  keep getting the current the opcode and running this instruction
-                    if (!any_key_pressed){
-                        chip8->PC-=2; 
-                    }
-                    break;
+        // spectators only get the rows that changed, before dirty_rows is cleared below
+        if (emu->stream) publish_stream(emu->stream, chip8);
 
-                case 0x1E:
-                    // 0FX1E: I+= VX; Add VX to register I. For non-Amiga CHIP8, does not affect VF 
-                    chip8->I += chip8->V[chip8->inst.X];
-                    break;
-                
-                case 0x07:
-                    // 0xFX07: set VX to the value of delay timer
-                    chip8->V[chip8->inst.X] = chip8->delay_timer;
-                    break;
+        // frames that didn't touch the display are not published. If the SDL thread took the last one it may
+        //  be asleep, so wake it up; otherwise the frame it hasn't taken yet is replaced and never shown
+        if (chip8->dirty_rows){
+            if (publish_frame(&emu->frames, chip8)){
+                SDL_Event event = {.type = emu->frame_event};
+                SDL_PushEvent(&event);
+            }else{
+                pacer->dropped_frames++;
+            }
+            chip8->dirty_rows = 0;
+        }
 
-                case 0x15:
-                    // 0xFX15: set delay timer to value of VX
-                    chip8->delay_timer = chip8->V[chip8->inst.X];
-                    break;
-                
-                case 0x18:
-                    // 0xFX18: set delay timer to value of VX
-                    chip8->sound_timer = chip8->V[chip8->inst.X];
-                    break;
+        if (config.turbo){
+            // no waiting, next host frame starts now
+            reset_pacer(pacer);
+        }else{
+            // Wait for the next frame, presenting (and waiting for vsync) is the SDL thread's problem
+            pacer_wait(pacer, false);
+        }
+    }
+    return 0;
+}
 
-                case 0x29:
-                    // 0xFX29: set register I to sprite location in memory for character in VX (0x0-0xF)
-                    chip8->I = chip8->V[chip8->inst.X] * 5;
-                    break;
-                
-                case 0x33:
-                    // 0xFX33: Store BCD (binary coded decimal) representation of VX at memory offset from I;
-                    //      I = hundred's place, I + 1 = ten's place, I + 2 = one's place
-                    uint8_t bcd = chip8->V[chip8->inst.X];
-                    chip8->ram[chip8->I + 2] = bcd % 10;
-                    bcd /= 10;
-                    chip8->ram[chip8->I + 1] = bcd % 10; 
-                    bcd /= 10;
-                    chip8->ram[chip8->I] = bcd;
-                    break;
 
-                case 0x55:
-                    // 0xFX55: Register dump V0-VF inclusive to memory offset from I;
-                    // SCHIP does not increment I, CHIP8 does increment I
-                    // NOTE: Could make this a config flag to use SCHIP or CHIP8 logic for I
-                    for (uint8_t i =0; i <= chip8->inst.X; i++) {
-                        chip8->ram[chip8->I + i] = chip8 ->V[i];
-                    }
-                    break;
+// --bench: time update_screen with each renderer, for a full redraw and for a single changed row,
+//  printed as JSON lines like chip8-headless --bench. Uses whatever ROM display there is plus random pixels
+void bench_render(const sdl_t sdl, config_t config, chip8_t *chip8){
+    const uint32_t frames = 600;
+    frame_t screen; // starts as whatever the ROM's display is
+    memcpy(screen.display, chip8->display, sizeof screen.display);
+    screen.hires = chip8->hires;
+    const struct {
+        renderer_t renderer;
+        const char *name;
+    } renderers[] = {
+        {RENDERER_RECTS, "rects"},
+        {RENDERER_TEXTURE, "texture"},
+    };
+    const struct {
+        uint64_t dirty_rows;
+        const char *name;
+    } patterns[] = {
+        {DIRTY_ALL_ROWS, "full"},
+        {1ull << (CHIP8_HEIGHT / 2), "row"},
+    };
 
-                case 0x65:
-                    // 0xFX65: Register load V0-VF from memory offset from I;
-                    // SCHIP does not increment I, CHIP8 does increment I
-                    // NOTE: Could make this a config flag to use SCHIP or CHIP8 logic for I
-                    for (uint8_t i =0; i <= chip8->inst.X; i++) {
-                        chip8 ->V[i] = chip8->ram[chip8->I + i];
+    for (uint32_t r = 0; r < sizeof renderers / sizeof renderers[0]; r++){
+        config.renderer = renderers[r].renderer;
+        for (uint32_t p = 0; p < sizeof patterns / sizeof patterns[0]; p++){
+            const uint64_t start = SDL_GetPerformanceCounter();
+            for (uint32_t frame = 0; frame < frames; frame++){
+                // change the rows this pattern says are dirty so every frame really is different
+                for (uint32_t y = 0; y < CHIP8_HIRES_HEIGHT; y++){
+                    if (!((patterns[p].dirty_rows >> y) & 1)) continue;
+                    for (uint32_t byte = 0; byte < 8 * CHIP8_ROW_WORDS; byte++){
+                        uint64_t *word = &screen.display[0][y][byte % CHIP8_ROW_WORDS];
+                        *word = (*word << 8) | random_byte(chip8);
                     }
-                    break;
-                default:
-                    break;
+                }
+                screen.dirty_rows = patterns[p].dirty_rows;
+                update_screen(sdl, config, &screen);
             }
-            break;
-        
-        default:
-            break; //unimplemented or invalid opcode
-    }
+            const double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
 
-}
-
-// Update CHIP8 delay and sound timers every 60hz
-void update_timers(chip8_t* chip8){
-    if (chip8->delay_timer > 0){
-        chip8->delay_timer--;
-    }
-    if (chip8->sound_timer > 0){
-        chip8->sound_timer--;
-        //setup sound 
-
-    }else{
-        // stop playing sound
-    
+            printf("{\"type\":\"render\",\"renderer\":\"%s\",\"dirty\":\"%s\",\"vsync\":%s,\"frames\":%u,"
+                   "\"seconds\":%.6f,\"us_per_frame\":%.3f}\n", renderers[r].name, patterns[p].name,
+                   config.vsync ? "true" : "false", frames, seconds, seconds * 1e6 / frames);
+        }
     }
 }
 
@@ -917,7 +832,7 @@ void update_timers(chip8_t* chip8){
 int main(int argc, char **argv){
     // default message usage for args
     if (argc < 2){
-        fprintf(stderr, "Usage: %s <rom_name>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <rom_name> [options]\n", argv[0]);
         exit(EXIT_FAILURE);
     }
     // initialise emulator configuration/options
@@ -933,47 +848,122 @@ int main(int argc, char **argv){
     chip8_t chip8 = {0};
     const char *rom_name = argv[1];
     if (!init_chip8(&chip8, rom_name)) {exit(EXIT_FAILURE);}
+    if (config.fixed_quirks) chip8.quirks = config.quirks; // --quirks beats the file extension
+
+    // --hexdump/--disasm: look at the ROM instead of running it
+    if (config.hexdump || config.disasm){
+        if (config.hexdump) print_hexdump(&chip8);
+        if (config.disasm) print_disassembly(&chip8);
+        final_cleanup(sdl);
+        exit(EXIT_SUCCESS);
+    }
+
+#ifdef DEBUG
+    // record every instruction, F12 saves them
+    static chip8_trace_t trace;
+    chip8.trace = &trace;
+#endif
     
     // Initial screen clear
     clear_screen(sdl, config);
 
-    // setup random value seed
-    srand(time(NULL));
-
-    //Main emulator loop
-    while(chip8.state != QUIT){
-        // Handle user_input
-        handle_input(&chip8);
-        if (chip8.state == PAUSED) continue;
-
-        // Get_time before running instructions 
-        const uint64_t start_frame_time = SDL_GetPerformanceCounter();
-
-        // Emulate CHIP8 instructions for this emulator "frame" (60hz)
-        for (uint32_t i = 0; i< config.inst_per_second / 60 ;i++)
-            emulate_instruction(&chip8, config);
-
-        // Get_time elapsed after running instructions 
-        const uint64_t end_frame_time = SDL_GetPerformanceCounter();
-
+    // --bench: time the renderers instead of running the ROM
+    if (config.bench){
+        bench_render(sdl, config, &chip8);
+        final_cleanup(sdl);
+        exit(EXIT_SUCCESS);
+    }
 
-        // Delay for approximately 60hz/60fps (16.67) or actual time elapsed
-        double time_elapsed = (double) ((end_frame_time - start_frame_time) / 1000) / SDL_GetPerformanceFrequency();
+    // execution engine for running instructions, selected with --predecode/--blocks
+    static chip8_engine_t engine;
+    init_engine(&engine, config.engine);
+
+    // random value seed, fixed with --seed for reproducible runs
+    const uint64_t seed = config.fixed_seed ? config.seed : (uint64_t)time(NULL);
+    seed_chip8(&chip8, seed);
+
+    // --record: keypad changes go into a movie, replayable with chip8-headless --replay
+    chip8_movie_t movie;
+    init_movie(&movie, seed, config);
+
+    // recent history for rewinding, within the --rewind-memory budget
+    static chip8_rewind_t rewind;
+    const uint64_t rewind_bytes = (uint64_t)config.rewind_kb * 1024;
+    const bool rewind_enabled = init_rewind(&rewind, rewind_bytes > UINT32_MAX ? UINT32_MAX : rewind_bytes);
+    if (!rewind_enabled) SDL_Log("Rewind disabled, could not set up a %u KiB rewind buffer\n", config.rewind_kb);
+
+    // beeper for the sound timer, with a --audio-buffer samples buffer
+    static audio_t audio;
+    init_audio(&sdl, config, &audio);
+
+    // --shm: free running export for agents watching (and playing) alongside the window
+    static shm_export_t shm;
+    if (config.shm_name && !init_shm(&shm, config.shm_name, false)) {exit(EXIT_FAILURE);}
+
+    // --stream: chip8-viewer spectators over UDP
+    static stream_export_t stream = {.socket = -1};
+    if (config.stream_port && !init_stream(&stream, config.stream_port)) {exit(EXIT_FAILURE);}
+
+    // emulation runs on its own thread and publishes frames, this thread handles input and presents them
+    static emulator_t emu;
+    emu = (emulator_t){
+        .chip8 = &chip8,
+        .engine = &engine,
+        .config = config,
+        .movie = &movie,
+        .rewind = &rewind,
+        .rewind_enabled = rewind_enabled,
+        .audio = &audio,
+        .shm = config.shm_name ? &shm : NULL,
+        .stream = config.stream_port ? &stream : NULL,
+        .frame_event = SDL_RegisterEvents(1),
+        .redraw = true,
+    };
+    init_frame_buffer(&emu.frames);
+    atomic_init(&emu.state, RUNNING);
+    atomic_init(&emu.keys, 0);
+    atomic_init(&emu.commands, 0);
+    emu.wake_lock = SDL_CreateMutex();
+    emu.wake = SDL_CreateCond();
+    if (!emu.wake_lock || !emu.wake){
+        SDL_Log("Could not create emulation thread wake up %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
 
+    SDL_Thread *thread = SDL_CreateThread(emulation_thread, "emulation", &emu);
+    if (!thread){
+        SDL_Log("Could not create emulation thread %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
 
-        // SDL_Delay(16 - actual time elapsed) 
-        SDL_Delay(16.67f > time_elapsed ? 16.67f - time_elapsed : 0); // time in ms 
+    //Main loop: sleep until there is input or a new frame, then present the newest frame.
+    // With --vsync presenting blocks until the display refresh, which only holds up this thread
+    while(atomic_load(&emu.state) != QUIT){
+        SDL_Event event;
+        if (SDL_WaitEventTimeout(&event, 100)) handle_event(&emu, config, &event);
+        handle_input(&emu, config);
+        present_frame(sdl, config, &emu);
+    }
+    SDL_WaitThread(thread, NULL);
+    SDL_DestroyCond(emu.wake);
+    SDL_DestroyMutex(emu.wake_lock);
 
+    const pacer_t pacer = emu.pacer;
+    SDL_Log("Frames: %llu, late: %llu, dropped: %llu\n", (unsigned long long)pacer.frames,
+            (unsigned long long)pacer.late_frames, (unsigned long long)pacer.dropped_frames);
+    if (config.stream_port) SDL_Log("Streamed %llu updates, %llu keyframes, %llu bytes, up to %u viewers\n",
+                                    (unsigned long long)stream.updates, (unsigned long long)stream.keyframes,
+                                    (unsigned long long)stream.bytes, stream.most_viewers);
 
-        // Update window with changes
-        update_screen(sdl, config, chip8);
-        
-        // Update delay and sound timers every 60hz
-        update_timers(&chip8);
+    if (emu.config.record_path && save_movie(&movie, chip8.cycles, emu.config.record_path))
+        SDL_Log("Recorded %u input changes over %llu instructions to %s\n", movie.count,
+                (unsigned long long)chip8.cycles, emu.config.record_path);
 
-    }
-    
     //Final cleanup
+    free_movie(&movie);
+    free_rewind(&rewind);
+    free_shm(&shm);
+    free_stream(&stream);
     final_cleanup(sdl);
 
     exit(EXIT_SUCCESS);
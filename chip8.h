@@ -0,0 +1,481 @@
+#ifndef CHIP8_H
+#define CHIP8_H
+
+/* CHIP8 emulator core
+    Everything needed to run a CHIP8 machine (CPU, memory, timers, framebuffer) with no SDL dependency,
+    so it can be linked into headless tools as libchip8.a as well as the SDL frontend
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Frontend renderer modes
+typedef enum {
+    RENDERER_RECTS = 0,     // one filled rect per CHIP8 pixel
+    RENDERER_TEXTURE,       // framebuffer uploaded to a streaming texture, presented with one copy
+} renderer_t;
+
+// Execution engines selectable at runtime
+typedef enum {
+    ENGINE_INTERPRETER = 0,    // run_instructions (reference switch, or threaded when built with DISPATCH=threaded)
+    ENGINE_PREDECODE,          // predecoded instruction cache
+    ENGINE_BLOCKS,             // basic block translation with superinstructions
+    ENGINE_REFERENCE,          // always the reference switch, even with DISPATCH=threaded (what chip8-difftest checks against)
+} engine_type_t;
+
+// Quirk profiles, the instruction behaviours CHIP8 interpreters disagree on. Each profile gets its own
+//  specialised copy of the interpreter at compile time, picked per ROM when it is loaded
+typedef enum {
+    QUIRKS_DEFAULT = 0,     // this emulator's original mix: shifts VX, FX55/FX65 leave I, BNNN + V0, sprites clip
+    QUIRKS_CHIP8,           // COSMAC VIP CHIP8: shifts VY into VX, FX55/FX65 I += X + 1, BNNN + V0, sprites clip
+    QUIRKS_SCHIP,           // SUPER-CHIP 1.1: shifts VX, FX55/FX65 leave I, BXNN + VX, sprites clip
+    QUIRKS_XOCHIP,          // XO-CHIP: shifts VY into VX, FX55/FX65 I += X + 1, BNNN + V0, sprites wrap
+    QUIRKS_COUNT,
+} quirks_t;
+
+// Emulator Config object
+typedef struct {
+    uint32_t window_width;      // SDL window width
+    uint32_t window_height;     // SDL window height
+    uint32_t fg_color;          // Foreground Color RGBA8888 (bits)
+    uint32_t bg_color;          // Background Color RGBA8888 (bits)
+    uint32_t fg2_color;         // XO-CHIP: pixels on in the second plane only
+    uint32_t blend_color;       // XO-CHIP: pixels on in both planes
+    uint32_t scale_factor;      // Amount to scale a CHIP8 pixel by ... e.g 20x will be a 20x larger window
+    bool pixel_outlines;        // Draw pixel outlines yes/no 
+    uint32_t inst_per_second;   // CHIP8 CPU "clock rate"/hz
+    renderer_t renderer;        // How the SDL frontend draws the framebuffer
+    engine_type_t engine;       // Execution engine used to run instructions
+    float speed;                // Emulated time per real time, 2.0 = double speed
+    bool turbo;                 // Uncapped, run as many emulated frames as possible
+    bool vsync;                 // Present in sync with the display refresh
+    const char *batch_path;     // Headless batch mode: directory of ROMs or file listing ROM paths
+    uint32_t threads;           // Headless batch mode worker threads, 0 = one per CPU core
+    uint64_t max_instructions;  // Headless instruction budget per ROM, 0 = default
+    uint32_t rewind_kb;         // Memory budget for the rewind buffer in KiB
+    uint64_t seed;              // Random number seed for CXNN, used when fixed_seed is set
+    bool fixed_seed;            // --seed given, otherwise the frontends seed from the time
+    const char *record_path;    // Record keypad input to this movie file
+    const char *replay_path;    // Headless: feed keypad input from this movie file
+    bool bench;                 // Benchmark mode, engines headless / update_screen in the SDL frontend
+    bool hexdump;               // Print the RAM as loaded and exit
+    bool disasm;                // Print a disassembly of the ROM and exit
+    uint32_t instances;         // Headless batch mode: machines per ROM, each seeded differently
+    uint32_t audio_samples;     // Audio buffer size in samples, smaller = lower latency but more risk of underruns
+    bool idle_skip;             // Fast forward through idle loops (timer waits, FX0A, jump to self), same results
+    const char *shm_name;       // Export display/registers and take keypad input through this shared memory object
+    uint32_t stream_port;       // Stream the display to viewers on this UDP port, 0 = not streaming
+    quirks_t quirks;            // Quirk profile, used when fixed_quirks is set
+    bool fixed_quirks;          // --quirks given, otherwise the profile comes from the ROM's file extension
+    uint32_t check_interval;    // chip8-difftest: instructions between machine state comparisons
+    uint32_t fuzz_roms;         // chip8-difftest: random opcode ROMs to cross-check, 0 = check the given ROM instead
+    const char *golden_path;    // Headless: check the final frames of the ROMs in this golden hash file
+    bool update_golden;         // Headless: rewrite the golden file with the current hashes instead
+    const char *png_dir;        // Headless: write PNGs of frames that don't match their golden hash here
+} config_t;
+
+//Emulator states
+typedef enum {
+    QUIT = 0,
+    RUNNING,
+    PAUSED,
+    REWINDING,  // stepping back through the rewind buffer instead of emulating
+} emulator_state_t;
+
+
+// CHIP8 instruction format
+typedef struct{
+    uint16_t opcode;    
+    uint16_t NNN;       // 12-bit address/constant
+    uint8_t NN;         // 8-bit constant
+    uint8_t N;          // 4-bit constant
+    uint8_t X;          // 4-bit register identifier
+    uint8_t Y;          // 4-bit register identifier
+    
+} instruction_t;
+
+
+// original CHIP8 resolution
+#define CHIP8_WIDTH 64
+#define CHIP8_HEIGHT 32
+
+// SUPER-CHIP/XO-CHIP high resolution (00FF), the framebuffer is always this big and 64x32 uses its top left
+#define CHIP8_HIRES_WIDTH 128
+#define CHIP8_HIRES_HEIGHT 64
+#define CHIP8_ROW_WORDS (CHIP8_HIRES_WIDTH / 64)    // packed uint64_t per display row
+#define CHIP8_PLANES 2                              // XO-CHIP bit planes, selected with FN01
+
+// all display rows changed, e.g after 00E0 clear screen
+#define DIRTY_ALL_ROWS 0xFFFFFFFFFFFFFFFFull
+
+// Instruction trace entry, the registers just before an instruction ran. DEBUG builds record 1 per instruction
+//  into a ring instead of printf-ing it, chip8-trace pretty prints a saved trace afterwards
+typedef struct {
+    uint32_t sequence;         // instructions traced before this one (low 32 bits)
+    uint16_t PC;               // address of the instruction
+    uint16_t opcode;
+    uint16_t I;
+    uint16_t return_address;   // top of the subroutine stack, 0 if empty
+    uint16_t keys;             // bit N = key N held
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint8_t V[16];
+} chip8_trace_entry_t;
+
+// Ring of the most recent trace entries, the newest is entries[(count - 1) % CHIP8_TRACE_ENTRIES]
+#define CHIP8_TRACE_ENTRIES 65536          // power of 2, 2 MiB
+#define CHIP8_TRACE_MAGIC 0x52543843u      // "C8TR" in little endian, trace file header
+#define CHIP8_TRACE_VERSION 1
+typedef struct {
+    uint64_t count;            // entries ever recorded
+    chip8_trace_entry_t entries[CHIP8_TRACE_ENTRIES];
+} chip8_trace_t;
+
+
+// CHIP8 Machine object
+typedef struct {
+
+    emulator_state_t state;
+    uint8_t ram[4096];  //Memory of the machine is 4096 Bytes
+    
+    // approaches to display
+    
+    // uint8_t *display; // display = &ram[0xF00] - &ram[0xFFF]
+    // 1 bit per pixel per plane, rows of CHIP8_ROW_WORDS words, MSB of word 0 is X=0. In 64x32 only word 0
+    //  of the first 32 rows is used, so the original resolution draws exactly as it always has
+    uint64_t display[CHIP8_PLANES][CHIP8_HIRES_HEIGHT][CHIP8_ROW_WORDS];
+    uint64_t dirty_rows; // bitmap of display rows changed since last presented, bit N = row N
+    bool hires;          // SUPER-CHIP 128x64 mode (00FF), 64x32 otherwise (00FE)
+    uint8_t planes;      // XO-CHIP planes drawn/cleared/scrolled (FN01), bit N = plane N, 1 = the usual 1 plane
+
+
+    uint16_t stack[12];        // subroutine stack
+    uint16_t *stack_ptr;       // stack pointer
+    uint8_t V[16];             // data registers V0-VF
+    uint8_t flags[16];         // SUPER-CHIP "RPL" user flags, FX75/FX85
+    uint16_t I;                // index register
+    uint16_t PC;               // Program Counter
+    uint8_t delay_timer;       // decrements at 60hz when >0
+    uint8_t sound_timer;       // decrements at 60hz and plays tone when >0
+    uint64_t cycles;           // instructions executed so far, the emulated time base
+    uint64_t timer_ticks;      // 60hz timer ticks so far
+    uint64_t rng_state;        // xorshift64* state for CXNN, never 0
+    bool keypad[16];           // hexadecimal keypad 0x0-0xF
+    const char *rom_name;      // currently running ROM
+    uint16_t rom_size;         // bytes loaded at the 0x200 entry point
+    quirks_t quirks;           // instruction behaviour profile, call init_engine after changing it
+    
+    instruction_t inst;        // currently executing instruction
+    chip8_trace_t *trace;      // DEBUG builds record instructions here, NULL = no tracing
+
+} chip8_t;
+
+
+// Opcode handler used by the faster execution engines, runs 1 decoded instruction
+typedef void (*op_handler_t)(chip8_t *chip8, const instruction_t *inst);
+
+// Predecoded instruction cache entry
+typedef struct {
+    op_handler_t handler;      // NULL if this slot has not been decoded yet
+    instruction_t inst;        // decoded instruction fields
+    uint8_t ram_write_length;  // bytes written to RAM from I (FX33/FX55), invalidates cache entries
+} decoded_inst_t;
+
+// Predecoded instruction cache, one entry per 2 byte aligned RAM address, keyed by PC/2
+typedef struct {
+    decoded_inst_t entries[4096 / 2];
+} chip8_cache_t;
+
+
+// Basic block op, a single instruction or a fused pair (superinstruction)
+typedef struct block_op block_op_t;
+typedef uint8_t (*op_block_fn_t)(chip8_t *chip8, const block_op_t *op); // returns instructions executed
+struct block_op {
+    op_block_fn_t fn;          // runs a superinstruction, NULL for a single instruction
+    op_handler_t handler;      // opcode handler for single instruction ops
+    instruction_t a;           // first instruction
+    instruction_t b;           // second instruction of a superinstruction
+};
+
+// Translated straight-line run of instructions
+#define BLOCK_MAX_OPS 16
+typedef struct {
+    uint16_t start;            // address of first instruction
+    uint16_t end;              // address after the last instruction
+    uint8_t inst_count;        // CHIP8 instructions covered
+    uint8_t op_count;          // ops after fusing superinstructions
+    uint8_t write_length;      // RAM bytes the last instruction writes from I (FX33/FX55)
+    block_op_t ops[BLOCK_MAX_OPS];
+} block_t;
+
+// Translated block cache, pool is flushed when it fills up
+typedef struct {
+    uint16_t lookup[4096 / 2]; // pool index + 1 of the block starting at address*2, 0 = not translated
+    uint16_t used;             // pool entries in use
+    uint16_t code_low;         // lowest address covered by any translated block
+    uint16_t code_high;        // address after the highest one, RAM writes outside low-high can't hit a block
+    uint16_t resume_pc;        // PC a partly run block stopped at, valid if resume_block != 0
+    uint16_t resume_block;     // pool index + 1 of the partly run block, 0 = none
+    uint8_t resume_op;         // op to carry on from
+    bool resume_half;          // resume_op is a superinstruction whose first instruction already ran
+    block_t pool[256];
+} chip8_blocks_t;
+
+// Execution engine and its caches
+typedef struct {
+    engine_type_t type;
+    uint32_t idle_wait;        // run_cycles chunks to go before looking for an idle loop again
+    uint32_t idle_backoff;     // idle_wait after the next miss, doubles with every miss in a row
+    union {
+        chip8_cache_t cache;   // ENGINE_PREDECODE
+        chip8_blocks_t blocks; // ENGINE_BLOCKS
+    };
+} chip8_engine_t;
+
+
+// Lockstep multi-instance core, CHIP8_LANES machines running the same ROM with different inputs/seeds.
+//  V, I and PC live in structure of arrays form (lane = machine) so common instructions run across every
+//  lane at once with SIMD; everything else (RAM, display, stack, timers, keypad) stays in a chip8_t per lane
+#define CHIP8_LANES 32
+typedef struct {
+    uint8_t V[16][CHIP8_LANES];   // V[register][lane]
+    uint16_t I[CHIP8_LANES];
+    uint16_t PC[CHIP8_LANES];
+    uint32_t count;               // lanes in use, 1 - CHIP8_LANES
+    chip8_t machines[CHIP8_LANES]; // rest of each machine's state, V/I/PC in here are stale (see sync_lane)
+} chip8_lanes_t;
+
+
+// Save state snapshot, a fixed layout copy of everything that defines a running machine.
+//  Fields are ordered largest first so there is no padding, the whole struct is the file format
+//  (native byte order, a foreign endian file fails the magic check) and restoring is a few memcpys
+#define CHIP8_SNAPSHOT_MAGIC 0x38504843u   // "CHP8" in little endian
+#define CHIP8_SNAPSHOT_VERSION 3
+typedef struct {
+    uint32_t magic;            // CHIP8_SNAPSHOT_MAGIC
+    uint32_t version;          // CHIP8_SNAPSHOT_VERSION, bumped whenever the layout changes
+    uint64_t cycles;
+    uint64_t timer_ticks;
+    uint64_t rng_state;
+    uint64_t display[CHIP8_PLANES][CHIP8_HIRES_HEIGHT][CHIP8_ROW_WORDS];
+    uint16_t stack[12];
+    uint16_t I;
+    uint16_t PC;
+    uint8_t ram[4096];
+    uint8_t V[16];
+    uint8_t keypad[16];        // 1 byte per key, 0/1
+    uint8_t flags[16];
+    uint8_t stack_index;       // stack_ptr as an index into stack
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint8_t hires;             // 0/1
+    uint8_t planes;
+    uint8_t reserved[7];       // keeps the size a multiple of 8, always 0
+} chip8_snapshot_t;
+
+
+// Rewind buffer entry, a full snapshot (keyframe) or a delta against the keyframe before it
+typedef struct {
+    uint32_t offset;           // start of the entry in the rewind data buffer
+    uint32_t size;             // bytes
+    bool keyframe;
+} rewind_entry_t;
+
+// Rewind buffer, a ring of snapshots within a fixed memory budget, oldest entries are dropped to make room.
+//  Deltas are the snapshot XORed with the keyframe and run length encoded, so unchanged bytes cost nothing
+typedef struct {
+    uint8_t *data;             // ring of encoded entries
+    uint32_t capacity;         // data bytes
+    rewind_entry_t *entries;   // ring of entries, oldest first
+    uint32_t max_entries;
+    uint32_t first;            // oldest entry
+    uint32_t count;            // entries in use
+    uint32_t since_keyframe;   // deltas pushed since the last keyframe
+    chip8_snapshot_t keyframe; // newest keyframe, new deltas are made against it
+} chip8_rewind_t;
+
+
+// Movie (input recording) event, the keypad state from an emulated instruction count onwards
+typedef struct {
+    uint64_t cycle;            // chip8->cycles the keypad changed at
+    uint16_t keys;             // bit N = key N held
+} movie_event_t;
+
+// Movie, every keypad change of a run plus what's needed to reproduce it exactly (seed, clock rate, length)
+typedef struct {
+    uint64_t seed;             // seed_chip8 seed the run used
+    uint64_t length;           // cycles the run lasted
+    uint32_t inst_per_second;  // clock rate, decides where timer ticks land
+    uint32_t count;            // events
+    uint32_t capacity;
+    uint32_t next;             // replay: next event to apply
+    movie_event_t *events;
+} chip8_movie_t;
+
+
+// Resolution the machine is in right now, 64x32 or 128x64
+static inline uint32_t display_width(const chip8_t *chip8){
+    return chip8->hires ? CHIP8_HIRES_WIDTH : CHIP8_WIDTH;
+}
+static inline uint32_t display_height(const chip8_t *chip8){
+    return chip8->hires ? CHIP8_HIRES_HEIGHT : CHIP8_HEIGHT;
+}
+
+// Get pixel at X,Y (in the current resolution) of the packed display: bit N set if it is on in plane N, 0 = off
+static inline uint8_t get_pixel(const chip8_t *chip8, const uint32_t x, const uint32_t y){
+    const uint32_t shift = 63 - x % 64;
+    return ((chip8->display[0][y][x / 64] >> shift) & 1) | (((chip8->display[1][y][x / 64] >> shift) & 1) << 1);
+}
+
+// Next random byte from the machine's own generator (xorshift64*): reproducible for a given seed,
+//  independent between machines so it is safe to run many in parallel, and a few cycles instead of rand()
+static inline uint8_t random_byte(chip8_t *chip8){
+    uint64_t x = chip8->rng_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    chip8->rng_state = x;
+    return (x * 0x2545F4914F6CDD1Dull) >> 56; // top bits are the best mixed
+}
+
+
+// Setup initial emulator configuration from passed in args
+bool set_config_from_args(config_t *config, const int argc, char **argv);
+
+// Initialise CHIP8 machine and load ROM file into memory, the quirk profile is picked from the file extension
+bool init_chip8(chip8_t *chip8, const char rom_name[]);
+
+// Initialise CHIP8 machine with a ROM image already in memory, rom_name is for messages and quirks_for_rom
+bool init_chip8_buffer(chip8_t *chip8, const char rom_name[], const uint8_t *rom, const size_t rom_size);
+
+// Copy a loaded (or running) machine into another, e.g. to start many instances of a ROM loaded once.
+//  Much cheaper than loading the ROM again; the clone doesn't share the original's trace ring
+void clone_chip8(chip8_t *clone, const chip8_t *chip8);
+
+// Quirk profile for a ROM file name: .sc8 is SUPER-CHIP, .xo8 XO-CHIP, anything else QUIRKS_DEFAULT
+quirks_t quirks_for_rom(const char rom_name[]);
+
+// Quirk profile by name (default, chip8, schip, xochip), false if there's no such profile
+bool parse_quirks(const char *name, quirks_t *quirks);
+
+// Name of a quirk profile
+const char *quirks_name(const quirks_t quirks);
+
+// Seed the machine's random number generator, any seed (including 0) is fine; init_chip8 seeds with 0
+void seed_chip8(chip8_t *chip8, const uint64_t seed);
+
+// Emulate 1 CHIP8 instruction
+void emulate_instruction(chip8_t *chip8);
+
+// Emulate count CHIP8 instructions back to back without returning to the caller in between;
+//  uses the threaded dispatch engine when built with CHIP8_THREADED_DISPATCH, emulate_instruction otherwise
+void run_instructions(chip8_t *chip8, uint32_t count);
+
+// Run count instructions through the reference switch, specialised for the machine's quirk profile
+void run_reference(chip8_t *chip8, uint32_t count);
+
+// Clear all predecoded instructions, call after loading a ROM or writing to RAM from outside the CPU
+void init_cache(chip8_cache_t *cache);
+
+// Emulate 1 CHIP8 instruction using the predecoded instruction cache; same result as emulate_instruction
+//  but instructions are only fetched/decoded the first time their address is executed
+void emulate_instruction_cached(chip8_t *chip8, chip8_cache_t *cache);
+
+// Clear all translated blocks, call after loading a ROM or writing to RAM from outside the CPU
+void init_blocks(chip8_blocks_t *blocks);
+
+// Emulate count CHIP8 instructions through translated basic blocks; same result as emulate_instruction
+void run_blocks(chip8_t *chip8, chip8_blocks_t *blocks, uint32_t count);
+
+// Setup an execution engine with empty caches, call again after loading a ROM or writing RAM from outside the CPU
+void init_engine(chip8_engine_t *engine, const engine_type_t type);
+
+// Emulate count CHIP8 instructions with the given execution engine
+void run_engine(chip8_t *chip8, chip8_engine_t *engine, uint32_t count);
+
+// Emulate exactly count instructions (cycles), ticking the timers at exactly 60hz of emulated time
+//  (every inst_per_second/60 cycles on average); chip8->cycles and timer_ticks track emulated time.
+//  With config.idle_skip, idle loops are counted through instead of run, the machine ends up the same
+void run_cycles(chip8_t *chip8, chip8_engine_t *engine, const config_t config, uint64_t count);
+
+// Emulate until the next 60hz timer tick (1 emulated frame)
+void run_frame(chip8_t *chip8, chip8_engine_t *engine, const config_t config);
+
+// Setup count lanes as copies of machine (e.g. straight after init_chip8)
+void init_lanes(chip8_lanes_t *lanes, const chip8_t *machine, const uint32_t count);
+
+// Emulate count instructions on every lane in lockstep, ticking timers at 60hz of emulated time like run_cycles;
+//  same result per lane as emulate_instruction
+void run_lanes(chip8_lanes_t *lanes, const config_t config, uint64_t count);
+
+// Copy a lane's V/I/PC back into its chip8_t and return it, for reading the complete machine
+chip8_t *sync_lane(chip8_lanes_t *lanes, const uint32_t lane);
+
+// Copy machine state into an in-memory snapshot
+void save_snapshot(const chip8_t *chip8, chip8_snapshot_t *snapshot);
+
+// Restore machine state from a snapshot, false if it isn't a valid snapshot of this version.
+//  RAM is replaced, so call init_engine afterwards
+bool load_snapshot(chip8_t *chip8, const chip8_snapshot_t *snapshot);
+
+// Save/load a snapshot to/from a file
+bool save_snapshot_file(const chip8_t *chip8, const char *path);
+bool load_snapshot_file(chip8_t *chip8, const char *path);
+
+// Allocate a rewind buffer using about budget_bytes of memory in total, false if out of memory
+bool init_rewind(chip8_rewind_t *rewind, const uint32_t budget_bytes);
+
+// Free a rewind buffer
+void free_rewind(chip8_rewind_t *rewind);
+
+// Record the current machine state, call once per frame
+void push_rewind(chip8_rewind_t *rewind, const chip8_t *chip8);
+
+// Step back 1 push: drop the newest recorded state and restore the one before it, false if there is nothing
+//  older left. RAM is replaced, so call init_engine afterwards
+bool pop_rewind(chip8_rewind_t *rewind, chip8_t *chip8);
+
+// Start an empty movie for recording a run with this seed/config
+void init_movie(chip8_movie_t *movie, const uint64_t seed, const config_t config);
+
+// Record the keypad if it changed, call after handling input; false if out of memory
+bool record_keypad(chip8_movie_t *movie, const chip8_t *chip8);
+
+// Write a recorded movie to a file, length is the cycle count the run ended at
+bool save_movie(chip8_movie_t *movie, const uint64_t length, const char *path);
+
+// Read a movie file for replaying
+bool load_movie(chip8_movie_t *movie, const char *path);
+
+// Free a movie's events
+void free_movie(chip8_movie_t *movie);
+
+// Emulate count instructions like run_cycles, setting the keypad from the movie at exactly the recorded cycles
+void run_movie(chip8_t *chip8, chip8_engine_t *engine, const config_t config, chip8_movie_t *movie, uint64_t count);
+
+// Disassemble 1 instruction into text, e.g "LD VA, 0x05"
+void disassemble(const uint16_t opcode, char *text, const size_t size);
+
+// Print the RAM as a hexdump, 16 bytes per line
+void print_hexdump(const chip8_t *chip8);
+
+// Print a disassembly of the loaded ROM, 1 instruction per line with its address and opcode
+void print_disassembly(const chip8_t *chip8);
+
+// Empty a trace ring
+void init_trace(chip8_trace_t *trace);
+
+// Write the entries in a trace ring to a file oldest first, for chip8-trace to decode
+bool save_trace_file(const chip8_trace_t *trace, const char *path);
+
+// True if the machine can't make progress on its own: jumping to itself or waiting for a key with none pressed
+bool is_halted(const chip8_t *chip8);
+
+// Fast non-cryptographic (FNV-1a) hash of the framebuffer in its current resolution
+uint64_t hash_display(const chip8_t *chip8);
+
+// Update CHIP8 delay and sound timers, call at 60hz
+void update_timers(chip8_t *chip8);
+
+#endif // CHIP8_H
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "chip8_api.h"
+
+/* Embedding API
+    Thin layer over the core: an instance is a machine, its engine and config, plus the machine as it was
+    loaded for chip8_api_reset. The library is built with hidden visibility, only CHIP8_API functions are
+    exported, so the rest of the core can change freely between versions
+*/
+
+_Static_assert(CHIP8_API_WIDTH == CHIP8_HIRES_WIDTH && CHIP8_API_HEIGHT == CHIP8_HIRES_HEIGHT &&
+               CHIP8_API_PLANES == CHIP8_PLANES && CHIP8_API_DISPLAY_WORDS * 8 == sizeof(((chip8_t *)0)->display),
+               "display size mismatch");
+_Static_assert(CHIP8_API_ENGINE_INTERPRETER == ENGINE_INTERPRETER && CHIP8_API_ENGINE_PREDECODE == ENGINE_PREDECODE &&
+               CHIP8_API_ENGINE_BLOCKS == ENGINE_BLOCKS, "engine numbers mismatch");
+_Static_assert(CHIP8_API_QUIRKS_DEFAULT == QUIRKS_DEFAULT && CHIP8_API_QUIRKS_CHIP8 == QUIRKS_CHIP8 &&
+               CHIP8_API_QUIRKS_SCHIP == QUIRKS_SCHIP && CHIP8_API_QUIRKS_XOCHIP == QUIRKS_XOCHIP, "quirk numbers mismatch");
+_Static_assert(sizeof(chip8_api_registers_t) == 48, "chip8_api_registers_t layout changed, bump CHIP8_API_VERSION");
+
+struct chip8_api_instance {
+    chip8_t chip8;
+    chip8_engine_t engine;
+    config_t config;
+    chip8_snapshot_t loaded;   // state straight after loading the ROM, for chip8_api_reset
+};
+
+
+// CHIP8_API_VERSION the library was built with, check it against the header's
+uint32_t chip8_api_version(void){
+    return CHIP8_API_VERSION;
+}
+
+// Create an instance running a ROM image (copied, rom can be freed afterwards) at inst_per_second (0 = default
+//  500), seeded with seed, using engine (CHIP8_API_ENGINE_*). NULL if the ROM is too big or out of memory
+chip8_api_instance_t *chip8_api_create(const uint8_t *rom, const size_t rom_size, const uint32_t inst_per_second,
+                                       const uint64_t seed, const uint32_t engine){
+    if (engine > CHIP8_API_ENGINE_BLOCKS) return NULL;
+
+    chip8_api_instance_t *instance = calloc(1, sizeof *instance);
+    if (!instance) return NULL;
+
+    // same defaults as the frontends with no options
+    char *argv[] = {"chip8_api", NULL};
+    set_config_from_args(&instance->config, 1, argv);
+    if (inst_per_second) instance->config.inst_per_second = inst_per_second < 60 ? 60 : inst_per_second;
+    instance->config.engine = engine;
+
+    if (!init_chip8_buffer(&instance->chip8, "chip8_api", rom, rom_size)){
+        free(instance);
+        return NULL;
+    }
+    save_snapshot(&instance->chip8, &instance->loaded);
+
+    init_engine(&instance->engine, instance->config.engine);
+    seed_chip8(&instance->chip8, seed);
+    return instance;
+}
+
+// Free an instance, NULL is fine
+void chip8_api_destroy(chip8_api_instance_t *instance){
+    free(instance);
+}
+
+// Switch an instance to another quirk profile (CHIP8_API_QUIRKS_*), false if there's no such profile
+bool chip8_api_set_quirks(chip8_api_instance_t *instance, const uint32_t quirks){
+    if (quirks >= QUIRKS_COUNT) return false;
+    instance->chip8.quirks = quirks;
+    init_engine(&instance->engine, instance->config.engine); // decoded handlers are per profile
+    return true;
+}
+
+// Put an instance back to how it was created, reseeded with seed (e.g the start of a new episode)
+void chip8_api_reset(chip8_api_instance_t *instance, const uint64_t seed){
+    load_snapshot(&instance->chip8, &instance->loaded);
+    instance->chip8.state = RUNNING;
+    instance->chip8.dirty_rows = DIRTY_ALL_ROWS;
+    init_engine(&instance->engine, instance->config.engine); // RAM was replaced
+    seed_chip8(&instance->chip8, seed);
+}
+
+// Write 1 instance's framebuffer at index i of displays
+static void write_display(const chip8_t *chip8, void *displays, const uint32_t i, const chip8_api_format_t format){
+    if (format == CHIP8_API_PACKED){
+        memcpy((uint64_t *)displays + (size_t)i * CHIP8_API_DISPLAY_WORDS, chip8->display, sizeof chip8->display);
+    }else if (format == CHIP8_API_PIXELS){
+        // 64x32 is written at 2x2 per pixel: each row twice, the second a copy of the first
+        const uint32_t scale = chip8->hires ? 1 : 2;
+        uint8_t *pixels = (uint8_t *)displays + (size_t)i * CHIP8_API_DISPLAY_PIXELS;
+        for (uint32_t y = 0; y < display_height(chip8); y++){
+            uint8_t *row = pixels;
+            for (uint32_t word = 0; word < display_width(chip8) / 64; word++){
+                uint64_t plane0 = chip8->display[0][y][word], plane1 = chip8->display[1][y][word];
+                for (uint32_t x = 0; x < 64; x++, plane0 <<= 1, plane1 <<= 1){
+                    const uint8_t pixel = (plane0 >> 63) | ((plane1 >> 63) << 1);
+                    for (uint32_t copy = 0; copy < scale; copy++) *pixels++ = pixel;
+                }
+            }
+            if (scale == 2){
+                memcpy(pixels, row, CHIP8_API_WIDTH);
+                pixels += CHIP8_API_WIDTH;
+            }
+        }
+    }
+}
+
+// Step count instances by frames emulated frames (1/60s each) with keys[i] (bit N = key N, NULL = none held)
+//  held for all of them, then write each instance's framebuffer into displays in format, instance i at
+//  i * CHIP8_API_DISPLAY_WORDS/PIXELS. Returns how many instances are halted afterwards
+uint32_t chip8_api_step(chip8_api_instance_t *const *instances, const uint32_t count, const uint16_t *keys,
+                        const uint32_t frames, void *displays, const chip8_api_format_t format){
+    uint32_t halted = 0;
+    for (uint32_t i = 0; i < count; i++){
+        chip8_api_instance_t *instance = instances[i];
+        chip8_t *chip8 = &instance->chip8;
+
+        const uint16_t held = keys ? keys[i] : 0;
+        for (uint32_t key = 0; key < sizeof chip8->keypad; key++) chip8->keypad[key] = (held >> key) & 1;
+
+        // a whole frame at a time, run_cycles fast forwards through the waits in between
+        for (uint32_t frame = 0; frame < frames; frame++) run_frame(chip8, &instance->engine, instance->config);
+        chip8->dirty_rows = 0; // nobody presents these
+
+        if (displays) write_display(chip8, displays, i, format);
+        halted += is_halted(chip8);
+    }
+    return halted;
+}
+
+// Write the framebuffers of count instances without stepping them, same layout as chip8_api_step
+void chip8_api_displays(chip8_api_instance_t *const *instances, const uint32_t count, void *displays,
+                        const chip8_api_format_t format){
+    for (uint32_t i = 0; i < count; i++) write_display(&instances[i]->chip8, displays, i, format);
+}
+
+// Write the registers of count instances into registers[0..count-1]
+void chip8_api_registers(chip8_api_instance_t *const *instances, const uint32_t count,
+                         chip8_api_registers_t *registers){
+    for (uint32_t i = 0; i < count; i++){
+        const chip8_t *chip8 = &instances[i]->chip8;
+        chip8_api_registers_t *out = &registers[i];
+
+        *out = (chip8_api_registers_t){
+            .cycles = chip8->cycles,
+            .frames = chip8->timer_ticks,
+            .I = chip8->I,
+            .PC = chip8->PC,
+            .delay_timer = chip8->delay_timer,
+            .sound_timer = chip8->sound_timer,
+            .halted = is_halted(chip8),
+            .hires = chip8->hires,
+            .planes = chip8->planes,
+        };
+        for (uint32_t key = 0; key < sizeof chip8->keypad; key++) out->keys |= (uint16_t)(chip8->keypad[key] << key);
+        memcpy(out->V, chip8->V, sizeof out->V);
+    }
+}
+
+// Bytes a saved state takes, for sizing chip8_api_save buffers
+size_t chip8_api_state_size(void){
+    return sizeof(chip8_snapshot_t);
+}
+
+// Save an instance's complete state into state (chip8_api_state_size bytes)
+void chip8_api_save(const chip8_api_instance_t *instance, void *state){
+    chip8_snapshot_t snapshot;
+    save_snapshot(&instance->chip8, &snapshot);
+    memcpy(state, &snapshot, sizeof snapshot); // the caller's buffer may not be aligned
+}
+
+// Restore a state from chip8_api_save (any instance of the same library version), false if it isn't one
+bool chip8_api_load(chip8_api_instance_t *instance, const void *state){
+    chip8_snapshot_t snapshot;
+    memcpy(&snapshot, state, sizeof snapshot);
+    if (!load_snapshot(&instance->chip8, &snapshot)) return false;
+    instance->chip8.state = RUNNING;
+    init_engine(&instance->engine, instance->config.engine); // RAM was replaced
+    return true;
+}
@@ -0,0 +1,112 @@
+#ifndef CHIP8_API_H
+#define CHIP8_API_H
+
+/* Embedding API
+    A small stable C interface to the emulator core for other languages (ctypes/cffi) and programs, built as
+    libchip8.so. Instances are opaque, so chip8_t and the engines can change without breaking callers, and
+    the main entry point steps a whole batch of instances by some frames in 1 call: the per call cost of an
+    FFI is paid once per batch instead of once per machine per frame.
+
+    Nothing allocates except chip8_api_create; every output goes into buffers the caller owns (e.g numpy
+    arrays), laid out contiguously instance after instance. Different instances can be stepped on different
+    threads at the same time, the same instance from 1 thread at a time
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__GNUC__)
+#define CHIP8_API __attribute__((visibility("default")))
+#else
+#define CHIP8_API
+#endif
+
+#define CHIP8_API_VERSION 2             // bumped whenever a signature or output layout changes
+
+#define CHIP8_API_WIDTH 128             // SUPER-CHIP high resolution, 64x32 output is scaled up to it
+#define CHIP8_API_HEIGHT 64
+#define CHIP8_API_PLANES 2              // XO-CHIP bit planes
+#define CHIP8_API_DISPLAY_WORDS 256     // CHIP8_API_PACKED output per instance, [plane][row][2] uint64_t
+#define CHIP8_API_DISPLAY_PIXELS 8192   // CHIP8_API_PIXELS output per instance, 1 uint8_t per pixel
+
+// Execution engines, same results with different speeds
+#define CHIP8_API_ENGINE_INTERPRETER 0
+#define CHIP8_API_ENGINE_PREDECODE 1
+#define CHIP8_API_ENGINE_BLOCKS 2
+
+// Framebuffer output formats
+typedef enum {
+    CHIP8_API_NONE = 0,     // don't write framebuffers
+    CHIP8_API_PACKED,       // CHIP8_API_DISPLAY_WORDS uint64_t per instance, the framebuffer as is: 2 words per row,
+                            //  MSB of the first is X=0. In 64x32 only the first word of the first 32 rows is used
+    CHIP8_API_PIXELS,       // CHIP8_API_DISPLAY_PIXELS uint8_t per instance, row major 128x64 whatever the resolution
+                            //  (64x32 pixels are 2x2), bit N set = on in plane N, so 0/1 without XO-CHIP planes
+} chip8_api_format_t;
+
+// Registers and counters of an instance, see chip8_api_registers
+typedef struct {
+    uint64_t cycles;        // instructions executed since create/reset
+    uint64_t frames;        // 60hz timer ticks since create/reset
+    uint16_t I;
+    uint16_t PC;
+    uint16_t keys;          // keypad bitmap the last step ran with
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint8_t V[16];
+    uint8_t halted;         // jumping to itself or waiting for a key with none pressed
+    uint8_t hires;          // 1 = 128x64, 0 = 64x32
+    uint8_t planes;         // XO-CHIP planes selected (FN01), bit N = plane N
+    uint8_t reserved[5];    // always 0, keeps the size a multiple of 8
+} chip8_api_registers_t;
+
+typedef struct chip8_api_instance chip8_api_instance_t;
+
+// CHIP8_API_VERSION the library was built with, check it against the header's
+CHIP8_API uint32_t chip8_api_version(void);
+
+// Create an instance running a ROM image (copied, rom can be freed afterwards) at inst_per_second (0 = default
+//  500), seeded with seed, using engine (CHIP8_API_ENGINE_*). NULL if the ROM is too big or out of memory
+CHIP8_API chip8_api_instance_t *chip8_api_create(const uint8_t *rom, const size_t rom_size, const uint32_t inst_per_second,
+                                                 const uint64_t seed, const uint32_t engine);
+
+// Free an instance, NULL is fine
+CHIP8_API void chip8_api_destroy(chip8_api_instance_t *instance);
+
+// Quirk profiles for chip8_api_set_quirks, same behaviours as --quirks
+#define CHIP8_API_QUIRKS_DEFAULT 0      // shifts VX, FX55/FX65 leave I, BNNN + V0, sprites clip
+#define CHIP8_API_QUIRKS_CHIP8 1        // COSMAC VIP
+#define CHIP8_API_QUIRKS_SCHIP 2        // SUPER-CHIP 1.1
+#define CHIP8_API_QUIRKS_XOCHIP 3       // XO-CHIP
+
+// Switch an instance to another quirk profile (CHIP8_API_QUIRKS_*), false if there's no such profile.
+//  Instances start with CHIP8_API_QUIRKS_DEFAULT; the profile is kept across reset and load
+CHIP8_API bool chip8_api_set_quirks(chip8_api_instance_t *instance, const uint32_t quirks);
+
+// Put an instance back to how it was created, reseeded with seed (e.g the start of a new episode)
+CHIP8_API void chip8_api_reset(chip8_api_instance_t *instance, const uint64_t seed);
+
+// Step count instances by frames emulated frames (1/60s each) with keys[i] (bit N = key N, NULL = none held)
+//  held for all of them, then write each instance's framebuffer into displays in format, instance i at
+//  i * CHIP8_API_DISPLAY_WORDS/PIXELS. Returns how many instances are halted afterwards
+CHIP8_API uint32_t chip8_api_step(chip8_api_instance_t *const *instances, const uint32_t count, const uint16_t *keys,
+                                  const uint32_t frames, void *displays, const chip8_api_format_t format);
+
+// Write the framebuffers of count instances without stepping them, same layout as chip8_api_step
+CHIP8_API void chip8_api_displays(chip8_api_instance_t *const *instances, const uint32_t count, void *displays,
+                                  const chip8_api_format_t format);
+
+// Write the registers of count instances into registers[0..count-1]
+CHIP8_API void chip8_api_registers(chip8_api_instance_t *const *instances, const uint32_t count,
+                                   chip8_api_registers_t *registers);
+
+// Bytes a saved state takes, for sizing chip8_api_save buffers
+CHIP8_API size_t chip8_api_state_size(void);
+
+// Save an instance's complete state into state (chip8_api_state_size bytes)
+CHIP8_API void chip8_api_save(const chip8_api_instance_t *instance, void *state);
+
+// Restore a state from chip8_api_save (any instance of the same library version), false if it isn't one
+CHIP8_API bool chip8_api_load(chip8_api_instance_t *instance, const void *state);
+
+#endif
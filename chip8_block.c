@@ -0,0 +1,265 @@
+#include <string.h>
+
+#include "chip8.h"
+#include "chip8_ops.h"
+
+/* Basic block translator
+    Straight-line runs of CHIP8 instructions are translated once into a block of decoded ops, ending at the
+    first instruction that changes control flow (jumps, calls, returns, skips, FX0A) or writes RAM (FX33/FX55).
+    A block runs with a single PC update and no fetch/decode, and common pairs of instructions are fused
+    into superinstructions that do both in one handler call.
+    Blocks work on the same chip8_t state as emulate_instruction so the two can be cross-checked.
+*/
+
+#define POOL_ENTRIES (sizeof ((chip8_blocks_t *)0)->pool / sizeof (block_t))
+#define LOOKUP_ENTRIES (sizeof ((chip8_blocks_t *)0)->lookup / sizeof (uint16_t))
+
+
+// Superinstruction handlers, a and b are 2 consecutive instructions; return the number of instructions run
+
+// ANNN, DXYN: point I at a sprite and draw it
+static uint8_t op_ANNN_DXYN(chip8_t *chip8, const block_op_t *op){
+    op_ANNN(chip8, &op->a);
+    op_DXYN(chip8, &op->b);
+    return 2;
+}
+
+// ANNN, DXYN with QUIRK_SPRITE_WRAP
+static uint8_t op_ANNN_DXYN_wrap(chip8_t *chip8, const block_op_t *op){
+    op_ANNN(chip8, &op->a);
+    op_DXYN_wrap(chip8, &op->b);
+    return 2;
+}
+
+// 6XNN, 6YNN: load 2 registers
+static uint8_t op_6XNN_6XNN(chip8_t *chip8, const block_op_t *op){
+    chip8->V[op->a.X] = op->a.NN;
+    chip8->V[op->b.X] = op->b.NN;
+    return 2;
+}
+
+// 7XNN, 7YNN: add to 2 registers
+static uint8_t op_7XNN_7XNN(chip8_t *chip8, const block_op_t *op){
+    chip8->V[op->a.X] += op->a.NN;
+    chip8->V[op->b.X] += op->b.NN;
+    return 2;
+}
+
+// 3XNN, 1NNN: jump to NNN unless VX equals NN (block ends after the jump);
+//  when the jump is skipped only 1 instruction ran
+static uint8_t op_3XNN_1NNN(chip8_t *chip8, const block_op_t *op){
+    if (chip8->V[op->a.X] == op->a.NN) return 1;
+    chip8->PC = op->b.NNN;
+    return 2;
+}
+
+// 4XNN, 1NNN: jump to NNN unless VX does not equal NN (block ends after the jump)
+static uint8_t op_4XNN_1NNN(chip8_t *chip8, const block_op_t *op){
+    if (chip8->V[op->a.X] != op->a.NN) return 1;
+    chip8->PC = op->b.NNN;
+    return 2;
+}
+
+// Run 1 block op, returns instructions executed
+static inline uint8_t run_op(chip8_t *chip8, const block_op_t *op){
+    if (op->fn) return op->fn(chip8, op);
+    op->handler(chip8, &op->a);
+    return 1;
+}
+
+
+// True if an instruction has to be the last one in a block
+static bool ends_block(const uint16_t opcode){
+    switch (opcode >> 12){
+        case 0x0: return (opcode & 0xFF) == 0xEE || opcode == 0x00FD; // return, SUPER-CHIP exit rewinds PC
+        case 0x1:                                      // jump
+        case 0x2:                                      // call
+        case 0x3: case 0x4: case 0x5: case 0x9:        // skips
+        case 0xB:                                      // jump + V0
+        case 0xE:                                      // key skips
+            return true;
+        case 0xF:
+            // FX0A rewinds PC while waiting for a key, FX33/FX55 may overwrite translated code
+            return (opcode & 0xFF) == 0x0A || ram_write_length(opcode) > 0;
+        default:
+            return false;
+    }
+}
+
+// Read opcode at addr
+static uint16_t fetch(const chip8_t *chip8, const uint16_t addr){
+    return (chip8->ram[addr] << 8) | chip8->ram[addr+1];
+}
+
+// Translate the block starting at start_pc into the pool
+static block_t *translate_block(chip8_t *chip8, chip8_blocks_t *blocks, const uint16_t start_pc){
+    if (blocks->used == POOL_ENTRIES){
+        // out of space, start over
+        init_blocks(blocks);
+    }
+
+    block_t *block = &blocks->pool[blocks->used];
+    block->start = start_pc;
+    block->inst_count = 0;
+    block->op_count = 0;
+
+    uint16_t pc = start_pc;
+    while (block->op_count < BLOCK_MAX_OPS && (uint32_t)pc + 1 < sizeof chip8->ram){
+        const uint16_t opcode = fetch(chip8, pc);
+        block_op_t *op = &block->ops[block->op_count++];
+        op->a = decode_instruction(opcode);
+        op->handler = lookup_handler(opcode, chip8->quirks);
+        op->fn = NULL;
+        block->inst_count++;
+        pc += 2;
+
+        // try to fuse with the next instruction
+        if ((uint32_t)pc + 1 < sizeof chip8->ram){
+            const uint16_t next = fetch(chip8, pc);
+            op_block_fn_t fused = NULL;
+            const uint16_t family = opcode & 0xF000, next_family = next & 0xF000;
+
+            if (family == 0xA000 && next_family == 0xD000)
+                fused = QUIRK_SPRITE_WRAP(chip8->quirks) ? op_ANNN_DXYN_wrap : op_ANNN_DXYN;
+            else if (family == 0x6000 && next_family == 0x6000) fused = op_6XNN_6XNN;
+            else if (family == 0x7000 && next_family == 0x7000) fused = op_7XNN_7XNN;
+            else if (family == 0x3000 && next_family == 0x1000) fused = op_3XNN_1NNN;
+            else if (family == 0x4000 && next_family == 0x1000) fused = op_4XNN_1NNN;
+
+            if (fused){
+                op->b = decode_instruction(next);
+                op->fn = fused;
+                block->inst_count++;
+                pc += 2;
+                if (ends_block(next)) break;
+                continue;
+            }
+        }
+
+        if (ends_block(opcode)) break;
+    }
+
+    block->end = pc;
+    if (start_pc < blocks->code_low) blocks->code_low = start_pc;
+    if (pc > blocks->code_high) blocks->code_high = pc;
+    block->write_length = ram_write_length(block->ops[block->op_count - 1].a.opcode);
+    blocks->lookup[start_pc / 2] = ++blocks->used; // lookup is 1 based, 0 = not translated
+    return block;
+}
+
+// Throw away every block overlapping RAM[addr] - RAM[addr + length - 1]
+static void invalidate_blocks(chip8_blocks_t *blocks, const uint16_t addr, const uint8_t length){
+    const uint32_t end = (uint32_t)addr + length;
+    if (end <= blocks->code_low || addr >= blocks->code_high) return; // usually data well away from the code
+
+    for (uint16_t i = 0; i < blocks->used; i++){
+        const block_t *block = &blocks->pool[i];
+        if (block->start < end && addr < block->end && blocks->lookup[block->start / 2] == i + 1){
+            blocks->lookup[block->start / 2] = 0;
+            if (blocks->resume_block == i + 1) blocks->resume_block = 0;
+        }
+    }
+}
+
+
+// Clear all translated blocks
+void init_blocks(chip8_blocks_t *blocks){
+    memset(blocks->lookup, 0, sizeof blocks->lookup);
+    blocks->used = 0;
+    blocks->code_low = UINT16_MAX;
+    blocks->code_high = 0;
+    blocks->resume_block = 0;
+}
+
+// Emulate count CHIP8 instructions through translated blocks
+void run_blocks(chip8_t *chip8, chip8_blocks_t *blocks, uint32_t count){
+    while (count){
+        const uint16_t pc = chip8->PC;
+
+        // odd/out of range PCs and code running off the end of RAM go through the reference switch
+        if ((pc & 1) || pc / 2 >= LOOKUP_ENTRIES){
+            const uint16_t opcode = (chip8->ram[pc] << 8) | chip8->ram[pc+1];
+            const uint16_t I = chip8->I;
+            emulate_instruction(chip8);
+            invalidate_blocks(blocks, I, ram_write_length(opcode));
+            count--;
+            continue;
+        }
+
+        // carry on with a block the last call ran out of budget part way through, rather than translating
+        //  a new block from the middle of it (with a small budget, e.g 1 timer tick, that would be every call)
+        block_t *block;
+        const block_op_t *first;
+        uint32_t remaining;
+        if (blocks->resume_block && blocks->resume_pc == pc &&
+            blocks->lookup[blocks->pool[blocks->resume_block - 1].start / 2] == blocks->resume_block){
+            block = &blocks->pool[blocks->resume_block - 1];
+            first = &block->ops[blocks->resume_op];
+            remaining = block->inst_count - (pc - block->start) / 2;
+
+            if (blocks->resume_half){
+                // second instruction of a split superinstruction (never a RAM write)
+                blocks->resume_block = 0;
+                chip8->PC = pc + 2;
+                lookup_handler(first->b.opcode, chip8->quirks)(chip8, &first->b);
+                count--;
+                if (first < &block->ops[block->op_count - 1]){
+                    blocks->resume_pc = chip8->PC;
+                    blocks->resume_block = (block - blocks->pool) + 1;
+                    blocks->resume_op = (first - block->ops) + 1;
+                    blocks->resume_half = false;
+                }
+                continue;
+            }
+        }else{
+            block = blocks->lookup[pc / 2] ? &blocks->pool[blocks->lookup[pc / 2] - 1]
+                                           : translate_block(chip8, blocks, pc);
+            first = block->ops;
+            remaining = block->inst_count;
+        }
+        blocks->resume_block = 0;
+
+        const block_op_t *last = &block->ops[block->op_count - 1];
+
+        // not enough budget left for the rest of the block, run the ops that fit before the last one
+        //  (those never touch PC) and carry on from the instruction after them
+        if (remaining > count){
+            uint32_t executed = 0;
+            const block_op_t *op = first;
+            for (; op < last && executed + (op->fn ? 2 : 1) <= count; op++)
+                executed += run_op(chip8, op);
+
+            bool half = false;
+            if (executed == 0){
+                // next op is a superinstruction with 1 instruction of budget left, run just its first instruction
+                //  (ANNN/6XNN/7XNN, or the skip of a last 3XNN/4XNN + 1NNN which may skip the rest of the block)
+                chip8->PC = pc + 2;
+                lookup_handler(op->a.opcode, chip8->quirks)(chip8, &op->a);
+                count--;
+                if (chip8->PC != pc + 2) continue;
+                half = true;
+            }else{
+                chip8->PC = pc + executed * 2;
+                count -= executed;
+            }
+
+            blocks->resume_pc = chip8->PC;
+            blocks->resume_block = (block - blocks->pool) + 1;
+            blocks->resume_op = op - block->ops;
+            blocks->resume_half = half;
+            continue;
+        }
+
+        // only the last op in a block can read or change PC, so it is updated once up front
+        chip8->PC = block->end;
+        uint32_t executed = 0;
+        for (const block_op_t *op = first; op < last; op++) executed += run_op(chip8, op);
+
+        // last instruction may write over translated code
+        const uint16_t I = chip8->I;
+        executed += run_op(chip8, last);
+        if (block->write_length) invalidate_blocks(blocks, I, block->write_length);
+
+        count -= executed;
+    }
+}
@@ -0,0 +1,53 @@
+#include <string.h>
+
+#include "chip8.h"
+#include "chip8_ops.h"
+
+#define CACHE_ENTRIES (sizeof ((chip8_cache_t *)0)->entries / sizeof (decoded_inst_t))
+
+
+// Clear all predecoded instructions
+void init_cache(chip8_cache_t *cache){
+    memset(cache, 0, sizeof *cache);
+}
+
+// Drop cache entries for any instruction overlapping RAM[addr] - RAM[addr + length - 1]
+static void invalidate_cache(chip8_cache_t *cache, const uint16_t addr, const uint8_t length){
+    for (uint32_t a = addr; a < (uint32_t)addr + length; a++){
+        cache->entries[(a / 2) % CACHE_ENTRIES].handler = NULL;
+    }
+}
+
+// Emulate 1 CHIP8 instruction using the predecoded instruction cache
+void emulate_instruction_cached(chip8_t *chip8, chip8_cache_t *cache){
+    // odd addresses can't be cached (they'd overlap the aligned entries), decode those every time.
+    //  They can still write over cached code with FX33/FX55
+    if (chip8->PC & 1){
+        const uint16_t opcode = (chip8->ram[chip8->PC] << 8) | chip8->ram[chip8->PC+1];
+        const uint16_t I = chip8->I;
+        emulate_instruction(chip8);
+        invalidate_cache(cache, I, ram_write_length(opcode));
+        return;
+    }
+
+    decoded_inst_t *entry = &cache->entries[(chip8->PC / 2) % CACHE_ENTRIES];
+    if (!entry->handler){
+        // first time at this address, fetch and decode it once
+        const uint16_t opcode = (chip8->ram[chip8->PC] << 8) | chip8->ram[chip8->PC+1];
+        entry->inst = decode_instruction(opcode);
+        entry->handler = lookup_handler(opcode, chip8->quirks);
+        entry->ram_write_length = ram_write_length(opcode);
+    }
+
+    chip8->PC += 2; // preincrement PC for next opcode -- 2 bytes
+
+    // FX33/FX55 may overwrite code that has already been decoded
+    if (entry->ram_write_length){
+        const decoded_inst_t decoded = *entry; // entry itself may be invalidated
+        invalidate_cache(cache, chip8->I, decoded.ram_write_length);
+        decoded.handler(chip8, &decoded.inst);
+        return;
+    }
+
+    entry->handler(chip8, &entry->inst);
+}
@@ -0,0 +1,943 @@
+#define _POSIX_C_SOURCE 200809L // mmap
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "chip8.h"
+#include "chip8_ops.h"
+#include "chip8_profile.h"
+
+
+// Get the value following option argv[*i], false if it is missing
+static bool get_option_value(const int argc, char **argv, int *i, const char **value){
+    if (*i + 1 >= argc){
+        fprintf(stderr, "Missing value for option %s\n", argv[*i]);
+        return false;
+    }
+    *value = argv[++*i];
+    return true;
+}
+
+// Parse value of an unsigned integer option, false if it is not a number > 0
+static bool parse_uint_option(const char *option, const char *value, uint32_t *out){
+    char *end;
+    const unsigned long parsed = strtoul(value, &end, 0);
+    if (*end != '\0' || parsed == 0 || parsed > UINT32_MAX){
+        fprintf(stderr, "Invalid value for option %s: %s\n", option, value);
+        return false;
+    }
+    *out = parsed;
+    return true;
+}
+
+// Setup initial emulator configuration from passed in args
+bool set_config_from_args(config_t *config, const int argc, char **argv){
+    
+    //set defaults
+    *config = (config_t){
+        .window_width = 64,     // CHIP8 original X resolution
+        .window_height = 32,    // CHIP8 original Y resolution
+        .fg_color = 0xFFFFFFFF, // WHITE
+        .bg_color = 0x000000FF, // BLACK
+        .fg2_color = 0xFF6600FF,   // ORANGE, XO-CHIP second plane
+        .blend_color = 0x662200FF, // BROWN, XO-CHIP both planes
+        .scale_factor = 20,     // Default resolution will be 1280x640
+        .pixel_outlines = true, // Draw pixel outlines by default
+        .inst_per_second = 500, // Number of intructions to emulate in 1 second (clock rate of CPU)
+        .renderer = RENDERER_TEXTURE, // Single texture blit per frame
+        .speed = 1.0f,          // Real time
+        .turbo = false,         // Capped to speed
+        .rewind_kb = 1024,      // ~1 minute of rewind for most games
+        .instances = 1,         // 1 machine per ROM in batch mode
+        .audio_samples = 512,   // ~12ms of audio at 44.1khz
+        .idle_skip = true,      // skip through idle loops
+        .check_interval = 1000, // chip8-difftest compares machines every 2 emulated seconds
+    };
+
+    //override defaults from args
+
+    for (int i=1; i< argc;i++){
+        const char *value;
+
+        if (argv[i][0] != '-'){
+            // not an option (ROM name etc), handled by the caller
+            continue;
+        }else if (strcmp(argv[i], "--rects") == 0){
+            // draw every pixel as its own rect (original renderer)
+            config->renderer = RENDERER_RECTS;
+        }else if (strcmp(argv[i], "--texture") == 0){
+            config->renderer = RENDERER_TEXTURE;
+        }else if (strcmp(argv[i], "--predecode") == 0){
+            // decode each instruction once and cache it by address
+            config->engine = ENGINE_PREDECODE;
+        }else if (strcmp(argv[i], "--blocks") == 0){
+            // translate straight-line code into blocks of (fused) ops
+            config->engine = ENGINE_BLOCKS;
+        }else if (strcmp(argv[i], "--turbo") == 0){
+            // run as fast as possible, timers still tick every emulated 1/60s
+            config->turbo = true;
+        }else if (strcmp(argv[i], "--speed") == 0){
+            // emulated time runs at this multiple of real time, e.g 2 = double speed
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            char *end;
+            config->speed = strtof(value, &end);
+            if (*end != '\0' || !(config->speed > 0.0f)){
+                fprintf(stderr, "Invalid value for option --speed: %s\n", value);
+                return false;
+            }
+        }else if (strcmp(argv[i], "--ips") == 0){
+            // CHIP8 "clock rate", instructions per second
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            if (!parse_uint_option("--ips", value, &config->inst_per_second)) return false;
+        }else if (strcmp(argv[i], "--scale") == 0){
+            // window size in multiples of the CHIP8 resolution
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            if (!parse_uint_option("--scale", value, &config->scale_factor)) return false;
+        }else if (strcmp(argv[i], "--batch") == 0){
+            // run every ROM in a directory/list file headless, in parallel
+            if (!get_option_value(argc, argv, &i, &config->batch_path)) return false;
+        }else if (strcmp(argv[i], "--threads") == 0){
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            if (!parse_uint_option("--threads", value, &config->threads)) return false;
+        }else if (strcmp(argv[i], "--instructions") == 0){
+            // headless instruction budget per ROM
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            char *end;
+            config->max_instructions = strtoull(value, &end, 0);
+            if (*end != '\0' || config->max_instructions == 0){
+                fprintf(stderr, "Invalid value for option --instructions: %s\n", value);
+                return false;
+            }
+        }else if (strcmp(argv[i], "--rewind-memory") == 0){
+            // rewind buffer budget in KiB
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            if (!parse_uint_option("--rewind-memory", value, &config->rewind_kb)) return false;
+        }else if (strcmp(argv[i], "--seed") == 0){
+            // fixed random number seed, for reproducible runs
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            char *end;
+            config->seed = strtoull(value, &end, 0);
+            if (*end != '\0' || value[0] == '\0'){
+                fprintf(stderr, "Invalid value for option --seed: %s\n", value);
+                return false;
+            }
+            config->fixed_seed = true;
+        }else if (strcmp(argv[i], "--record") == 0){
+            // record keypad input to a movie file
+            if (!get_option_value(argc, argv, &i, &config->record_path)) return false;
+        }else if (strcmp(argv[i], "--replay") == 0){
+            // headless: replay keypad input from a movie file
+            if (!get_option_value(argc, argv, &i, &config->replay_path)) return false;
+        }else if (strcmp(argv[i], "--bench") == 0){
+            config->bench = true;
+        }else if (strcmp(argv[i], "--vsync") == 0){
+            config->vsync = true;
+        }else if (strcmp(argv[i], "--no-outlines") == 0){
+            config->pixel_outlines = false;
+        }else if (strcmp(argv[i], "--no-idle-skip") == 0){
+            // run idle loops instruction by instruction, e.g to time the engines on them
+            config->idle_skip = false;
+        }else if (strcmp(argv[i], "--hexdump") == 0){
+            // print the RAM after loading the ROM instead of running it
+            config->hexdump = true;
+        }else if (strcmp(argv[i], "--disasm") == 0){
+            // print the ROM as assembly instead of running it
+            config->disasm = true;
+        }else if (strcmp(argv[i], "--audio-buffer") == 0){
+            // audio buffer size in samples, latency vs underruns
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            if (!parse_uint_option("--audio-buffer", value, &config->audio_samples)) return false;
+            if (config->audio_samples > UINT16_MAX){
+                fprintf(stderr, "Invalid value for option --audio-buffer: %s (max %u)\n", value, UINT16_MAX);
+                return false;
+            }
+        }else if (strcmp(argv[i], "--instances") == 0){
+            // batch mode: run each ROM this many times, loaded once and cloned, with seeds seed, seed + 1...
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            if (!parse_uint_option("--instances", value, &config->instances)) return false;
+        }else if (strcmp(argv[i], "--quirks") == 0){
+            // instruction behaviour profile, instead of the one the ROM's file extension implies
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            if (!parse_quirks(value, &config->quirks)){
+                fprintf(stderr, "Invalid value for option --quirks: %s (default, chip8, schip or xochip)\n", value);
+                return false;
+            }
+            config->fixed_quirks = true;
+        }else if (strcmp(argv[i], "--shm") == 0){
+            // export the machine to this POSIX shared memory object, e.g /chip8, for external agents
+            if (!get_option_value(argc, argv, &i, &config->shm_name)) return false;
+        }else if (strcmp(argv[i], "--stream") == 0){
+            // send the display to chip8-viewer spectators on this UDP port
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            if (!parse_uint_option("--stream", value, &config->stream_port)) return false;
+            if (config->stream_port > UINT16_MAX){
+                fprintf(stderr, "Invalid value for option --stream: %s (max %u)\n", value, UINT16_MAX);
+                return false;
+            }
+        }else if (strcmp(argv[i], "--check-interval") == 0){
+            // chip8-difftest: instructions between comparisons, a mismatch is bisected within 1 interval
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            if (!parse_uint_option("--check-interval", value, &config->check_interval)) return false;
+        }else if (strcmp(argv[i], "--fuzz") == 0){
+            // chip8-difftest: cross-check this many random opcode ROMs instead of a ROM file
+            if (!get_option_value(argc, argv, &i, &value)) return false;
+            if (!parse_uint_option("--fuzz", value, &config->fuzz_roms)) return false;
+        }else if (strcmp(argv[i], "--golden") == 0){
+            // headless: regression test the ROMs in a golden hash file
+            if (!get_option_value(argc, argv, &i, &config->golden_path)) return false;
+        }else if (strcmp(argv[i], "--update-golden") == 0){
+            config->update_golden = true;
+        }else if (strcmp(argv[i], "--png-dir") == 0){
+            // headless: where PNGs of mismatched golden frames go
+            if (!get_option_value(argc, argv, &i, &config->png_dir)) return false;
+        }else{
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    // at least 1 instruction per emulated frame
+    if (config->inst_per_second < 60) config->inst_per_second = 60;
+
+#if defined(DEBUG) || defined(CHIP8_PROFILE)
+    // the instruction trace and profile are recorded by the reference switch, the other engines would leave
+    //  holes in them
+    if (config->engine != ENGINE_INTERPRETER){
+        fprintf(stderr, "%s build: counting every instruction needs the interpreter, ignoring --predecode/--blocks\n",
+    #ifdef DEBUG
+                "DEBUG"
+    #else
+                "PROFILE"
+    #endif
+                );
+        config->engine = ENGINE_INTERPRETER;
+    }
+#endif
+
+    return true;
+
+}
+
+
+// Initialise CHIP8 machine with a ROM image already in memory
+bool init_chip8_buffer(chip8_t *chip8, const char rom_name[], const uint8_t *rom, const size_t rom_size){
+    const uint32_t entry_point = 0x200; // CHIP8 ROM will be loaded to 0x200
+    const uint8_t font[] = {
+        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+        0x20, 0x60, 0x20, 0x20, 0x70, // 1
+        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+        0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+        0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+        0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+        0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+    };
+    // SUPER-CHIP 8x10 digits for FX30, XO-CHIP adds A-F
+    const uint8_t big_font[] = {
+        0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+        0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+        0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+        0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+        0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+        0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+        0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+        0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+    };
+
+    // Load fonts
+    memcpy(&chip8->ram[0], font, sizeof(font));
+    memcpy(&chip8->ram[CHIP8_BIG_FONT], big_font, sizeof(big_font));
+
+    // Load ROM to chip8 memory
+    const size_t max_size = sizeof chip8->ram - entry_point;
+    if (rom_size > max_size){
+        fprintf(stderr, "ROM %s is too big! ROM size: %zu, Max size allowed: %zu \n", rom_name, rom_size, max_size);
+        return false;
+    }
+    if (rom_size) memcpy(&chip8->ram[entry_point], rom, rom_size);
+    chip8->rom_size = rom_size;
+    chip8->quirks = quirks_for_rom(rom_name);
+
+    //set chip8 machine defaults
+    chip8->state = RUNNING;     // Default machine state to on/running 
+    chip8->PC = entry_point;    // start pc at ROM entry point
+    chip8->rom_name = rom_name;
+    chip8->stack_ptr = &chip8->stack[0];
+    chip8->dirty_rows = DIRTY_ALL_ROWS; // draw first frame
+    chip8->hires = false;       // 64x32 until the ROM asks for 128x64
+    chip8->planes = 1;          // XO-CHIP ROMs select their planes, everything else only ever draws plane 0
+    chip8->cycles = 0;
+    chip8->timer_ticks = 0;
+    seed_chip8(chip8, 0);       // deterministic unless reseeded
+
+    return true; // success
+}
+
+// Initialise CHIP8 machine and load ROM file into memory
+bool init_chip8(chip8_t *chip8, const char rom_name[]){
+    // Open ROM file
+    const int rom = open(rom_name, O_RDONLY);
+    struct stat info;
+    if (rom < 0 || fstat(rom, &info) != 0 || !S_ISREG(info.st_mode)){
+        fprintf(stderr, "ROM File %s is invalid or does not exist\n", rom_name);
+        if (rom >= 0) close(rom);
+        return false;
+    }
+
+    // get/check rom size
+    const size_t rom_size = info.st_size;
+    const size_t max_size = sizeof chip8->ram - 0x200; // biggest ROM that fits above the 0x200 entry point
+    if (rom_size > max_size){
+        fprintf(stderr, "ROM File %s is too big! ROM size: %zu, Max size allowed: %zu \n", rom_name, rom_size, max_size);
+        close(rom);
+        return false;
+    }
+    if (rom_size == 0){
+        close(rom);
+        return init_chip8_buffer(chip8, rom_name, NULL, 0);
+    }
+
+    // map the file and copy it straight into RAM, no stdio buffering or seeking
+    void *data = mmap(NULL, rom_size, PROT_READ, MAP_PRIVATE, rom, 0);
+    close(rom);
+    if (data == MAP_FAILED){
+        fprintf(stderr, "Could not read ROM file %s into CHIP8 memory\n", rom_name);
+        return false;
+    }
+
+    const bool ok = init_chip8_buffer(chip8, rom_name, data, rom_size);
+    munmap(data, rom_size);
+    return ok;
+}
+
+// Quirk profile names, in quirks_t order
+static const char *const quirk_names[QUIRKS_COUNT] = {"default", "chip8", "schip", "xochip"};
+
+// Quirk profile for a ROM file name: .sc8 is SUPER-CHIP, .xo8 XO-CHIP, anything else QUIRKS_DEFAULT
+quirks_t quirks_for_rom(const char rom_name[]){
+    const char *ext = strrchr(rom_name, '.');
+    if (ext && strcmp(ext, ".sc8") == 0) return QUIRKS_SCHIP;
+    if (ext && strcmp(ext, ".xo8") == 0) return QUIRKS_XOCHIP;
+    return QUIRKS_DEFAULT;
+}
+
+// Quirk profile by name, false if there's no such profile
+bool parse_quirks(const char *name, quirks_t *quirks){
+    for (uint32_t i = 0; i < QUIRKS_COUNT; i++){
+        if (strcmp(name, quirk_names[i]) == 0){
+            *quirks = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Name of a quirk profile
+const char *quirks_name(const quirks_t quirks){
+    return quirks < QUIRKS_COUNT ? quirk_names[quirks] : "unknown";
+}
+
+// Copy a loaded (or running) machine into another, e.g. to start many instances of a ROM loaded once
+void clone_chip8(chip8_t *clone, const chip8_t *chip8){
+    *clone = *chip8;
+    clone->stack_ptr = clone->stack + (chip8->stack_ptr - chip8->stack); // point into the clone's own stack
+    clone->trace = NULL; // a trace ring belongs to 1 machine
+}
+
+
+// Seed the machine's random number generator
+void seed_chip8(chip8_t *chip8, const uint64_t seed){
+    // splitmix64 the seed so similar seeds give unrelated sequences, xorshift state must not be 0
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    chip8->rng_state = z ? z : 1;
+}
+
+
+#ifdef DEBUG
+// Record the instruction about to run in the machine's trace ring, a few stores instead of a printf
+static inline void trace_instruction(const chip8_t *chip8){
+    chip8_trace_t *trace = chip8->trace;
+    if (!trace) return;
+
+    chip8_trace_entry_t *entry = &trace->entries[trace->count & (CHIP8_TRACE_ENTRIES - 1)];
+    entry->sequence = trace->count++;
+    entry->PC = chip8->PC - 2;
+    entry->opcode = chip8->inst.opcode;
+    entry->I = chip8->I;
+    entry->return_address = chip8->stack_ptr > chip8->stack ? chip8->stack_ptr[-1] : 0;
+    uint16_t keys = 0;
+    for (uint8_t i = 0; i < 16; i++) keys |= chip8->keypad[i] << i;
+    entry->keys = keys;
+    entry->delay_timer = chip8->delay_timer;
+    entry->sound_timer = chip8->sound_timer;
+    memcpy(entry->V, chip8->V, sizeof entry->V);
+}
+#endif
+
+
+// Emulate 1 CHIP8 instruction under a quirk profile. Always inlined with a constant profile, so each profile
+//  gets its own copy of the switch with the QUIRK_* checks folded away
+static ALWAYS_INLINE void execute_instruction(chip8_t *chip8, const quirks_t quirks){
+    PROFILE_START(chip8);
+
+    // since x86 is little endian and chip 8 is big endian
+    // get next opcode from ROM/ram
+    chip8->inst.opcode = (chip8->ram[chip8->PC] << 8) | chip8 -> ram[chip8->PC+1];
+    chip8->PC +=2; // preincrement PC for next opcode -- 2 bytes 
+
+    // fill out current instruction format
+    // DXYN
+    chip8->inst.NNN = chip8->inst.opcode & 0x0FFF;
+    chip8->inst.NN = chip8->inst.opcode & 0x0FF;
+    chip8->inst.N = chip8->inst.opcode & 0x0F;
+    chip8->inst.X = (chip8->inst.opcode >> 8) & 0x0F; // right bit shift by 8 to get bits 9-12 
+    chip8->inst.Y = (chip8->inst.opcode >> 4) & 0x0F; // right bit shift by 4 to get bits 5-8
+
+    #ifdef DEBUG
+        trace_instruction(chip8);
+    #endif
+
+
+    //emulate opcode 
+    switch ((chip8->inst.opcode >> 12) & 0x0F){ // get top 4 MSBs
+        case 0x00:
+            if ( chip8->inst.NN == 0xE0){
+                //0x00E0: clear screen (the planes selected with FN01)
+                clear_planes(chip8);
+            } else if (chip8->inst.NN == 0xEE){
+                // 0x0EEE: return from subroutine
+                // Set PC to  last address on subroutine stack ("pop" it off the stack )
+                //  so next opcode is retrieved from that address
+                chip8->PC = *--chip8->stack_ptr;
+            } else if ((chip8->inst.NNN & 0xFF0) == 0x0C0){
+                // 0x00CN (SUPER-CHIP): scroll down N rows
+                scroll_rows(chip8, chip8->inst.N);
+            } else if ((chip8->inst.NNN & 0xFF0) == 0x0D0){
+                // 0x00DN (XO-CHIP): scroll up N rows
+                scroll_rows(chip8, -chip8->inst.N);
+            } else if (chip8->inst.NNN == 0x0FB || chip8->inst.NNN == 0x0FC){
+                // 0x00FB/0x00FC (SUPER-CHIP): scroll right/left 4 pixels
+                scroll_columns(chip8, chip8->inst.NNN == 0x0FB);
+            } else if (chip8->inst.NNN == 0x0FD){
+                // 0x00FD (SUPER-CHIP): exit, i.e keep running this instruction, is_halted sees that as halted
+                chip8->PC -= 2;
+            } else if (chip8->inst.NNN == 0x0FE || chip8->inst.NNN == 0x0FF){
+                // 0x00FE/0x00FF (SUPER-CHIP): 64x32/128x64, clears the screen
+                set_resolution(chip8, chip8->inst.NNN == 0x0FF);
+            } else{
+                // unimplemented/invalid opcode, may be 0xNNN for calling machine code routine for RCA1802
+            }
+            break;
+        case 0x01:
+            // 0x1NNN: Jumps to address NNN
+            chip8->PC = chip8->inst.NNN; // set PC so that next opcode is from NNN
+            break;
+        case 0x02:
+            // 0x2NNN: Call subroutine at NNN
+            // store current address to return to on subroutine stack ("push" it on the stack)
+            //   and set PC to subroutine address so next opcode is gotten from there
+            *chip8->stack_ptr++ = chip8->PC; 
+            chip8->PC = chip8->inst.NNN;
+            break;
+        case 0x03:
+            // 0x3XNN: Skips next instruction if VX equals NN
+            if (chip8->V[chip8->inst.X] == chip8->inst.NN){
+                chip8->PC+=2;   //skip next opcode/instruction
+            }
+            break;
+        case 0x04:
+            // 0x4XNN: Skips next instruction if VX does not equal NN
+            if (chip8->V[chip8->inst.X] != chip8->inst.NN){
+                chip8->PC+=2;   //skip next opcode/instruction
+            }
+            break;
+        case 0x05:
+            // 0x5XY0: Skips next instruction if VX equals VY#
+            if (chip8->V[chip8->inst.X] == chip8->V[chip8->inst.Y]){
+                chip8->PC+=2;   //skip next opcode/instruction
+            }
+            break;
+        case 0x06:
+            // 0x06NN: Set register VX to NN
+            chip8->V[chip8->inst.X] = chip8->inst.NN;
+            break;
+        case 0x07:
+            // 0x07XNN: Set register VX += NN
+            chip8->V[chip8->inst.X] += chip8->inst.NN;
+            break;
+        case 0x08:
+            switch(chip8->inst.N){
+                case 0:
+                    // 0x8XY0: set register VX = VY 
+                    chip8->V[chip8->inst.X] = chip8->V[chip8->inst.Y]; 
+                    break;
+                case 1:
+                    // 0x8XY1: set register VX to VX ORd with VY
+                    chip8->V[chip8->inst.X] |= chip8->V[chip8->inst.Y]; 
+                    break;
+                case 2:
+                    // 0x8XY2: set register VX to VX ANDd with VY
+                    chip8->V[chip8->inst.X] &= chip8->V[chip8->inst.Y]; 
+                    break;
+                case 3:
+                    // 0x8XY3: set register VX to VX XORd with VY
+                    chip8->V[chip8->inst.X] ^= chip8->V[chip8->inst.Y]; 
+                    break;
+                case 4:
+                    // 0x8XY4: set register VX to VX + VY, set VF to 1 if carry 
+                    if((uint16_t)chip8->V[chip8->inst.X] + chip8->V[chip8->inst.Y] > 255){
+                        chip8->V[0xF] = 1;
+                    }else{
+                        chip8->V[0xF] = 0;
+                    }
+                    chip8->V[chip8->inst.X] += chip8->V[chip8->inst.Y]; 
+                    break;
+                case 5:
+                    // 0x8XY5: set register VX to VX - VY, set VF to 1 if there is not a borrow (result is +ve/0)
+                    if(chip8->V[chip8->inst.X] >= chip8->V[chip8->inst.Y]){
+                        chip8->V[0xF] = 1;
+                    }else{
+                        chip8->V[0xF] = 0;
+                    }
+                    chip8->V[chip8->inst.X] -= chip8->V[chip8->inst.Y]; 
+                    break;
+                case 6:
+                    // 0x8XY6: right shift VX by 1, store LSB of VX before shift to VF;
+                    //  CHIP8 and XO-CHIP shift VY into VX instead
+                    if (QUIRK_SHIFT_VY(quirks)){
+                        const uint8_t value = chip8->V[chip8->inst.Y];
+                        chip8->V[chip8->inst.X] = value >> 1;
+                        chip8->V[0xF] = value & 1;
+                        break;
+                    }
+                    chip8->V[0xF] = chip8->V[chip8->inst.X] & 1;
+                    chip8->V[chip8->inst.X] >>= 1;
+                    break;
+                case 7:
+                    // 0x8XY7: set register VX to VY - VX, set VF to 1 if there is not a borrow (result is +ve/0)
+                    if(chip8->V[chip8->inst.X] <= chip8->V[chip8->inst.Y]){
+                        chip8->V[0xF] = 1;
+                    }else{
+                        chip8->V[0xF] = 0;
+                    }
+                    chip8->V[chip8->inst.X] = chip8->V[chip8->inst.Y] - chip8->V[chip8->inst.X]; 
+                    break;
+                case 0xE:
+                    // 0x8XYE: left shift VX by 1, store MSB of VX before shift to VF; again VY for CHIP8/XO-CHIP
+                    if (QUIRK_SHIFT_VY(quirks)){
+                        const uint8_t value = chip8->V[chip8->inst.Y];
+                        chip8->V[chip8->inst.X] = value << 1;
+                        chip8->V[0xF] = value >> 7;
+                        break;
+                    }
+                    chip8->V[0xF] = ((chip8->V[chip8->inst.X]) & 0x80) >> 7;
+                    chip8->V[chip8->inst.X] <<= 1;
+                    break;
+                default:
+                    // unimplemented opcode
+                    break;
+            }
+            break;
+        case 0x09:
+            // 0x9XY0: Skips the next instruction if VX != VY
+            if (chip8->V[chip8->inst.X] != chip8->V[chip8->inst.Y]){
+                chip8->PC+=2;
+            }
+            break;
+        case 0x0A:
+            // 0xANNN: Set index register I to NNN
+            chip8->I  = chip8->inst.NNN;
+            break;
+        case 0x0B:
+            // 0xBNNN: Jumps to the address NNN plux V0; SCHIP's BXNN jumps to XNN plus VX
+            chip8->PC = chip8->V[QUIRK_JUMP_VX(quirks) ? chip8->inst.X : 0x0] + chip8->inst.NNN;
+            break;
+        case 0x0C:
+            // 0xCXNN: Sets register VX = random byte & NN (bitwise AND)
+            chip8->V[chip8->inst.X] = random_byte(chip8) & chip8->inst.NN;
+            break;
+        case 0x0D:
+            // 0xDXYN: Draw N height sprite at coordinates X,Y; read from mem location I;
+            // screen pixels are xor'd with sprite bits 
+            // VF (carry flag) is set if any screen pixels are set off; useful for 
+            // collision detections and other stuff
+            // DXY0 is a SUPER-CHIP 16x16 sprite, XO-CHIP sprites wrap around the edges instead of clipping;
+            //  the same packed row code every engine uses, in chip8_ops.h
+            draw_sprite(chip8, &chip8->inst, QUIRK_SPRITE_WRAP(quirks));
+            break;
+
+        case 0xE:
+            if (chip8->inst.NN == 0x9E){
+                // 0xEX9E: skip next instruction if key in VX is pressed 
+                if (chip8->keypad[chip8->V[chip8->inst.X]]){
+                    chip8->PC+=2;
+                }
+
+                
+
+            }else if(chip8->inst.NN == 0xA1){
+                // 0xEX9E: skip next instruction if key in VX is not pressed
+                if (!chip8->keypad[chip8->V[chip8->inst.X]]){
+                    chip8->PC+=2;
+                }
+
+
+            }
+            break;
+        
+        case 0xF:
+            switch(chip8->inst.NN){
+                case 0x01:
+                    // 0xFN01 (XO-CHIP): select the planes to draw/clear/scroll, N is a bitmap
+                    chip8->planes = chip8->inst.X & ((1u << CHIP8_PLANES) - 1);
+                    break;
+
+                case 0x0A:
+                    // 0xFX0A: VX = getkey(); Await until a keypress, and store in VX
+                    bool any_key_pressed = false;
+                    for (uint8_t i=0; i < sizeof chip8->keypad;i++){
+                        if (chip8->keypad[i]){
+                            chip8->V[chip8->inst.X]  = i; // i = key (offset into keypad array)
+                            any_key_pressed = true;
+                            break;
+                        }
+                    }
+                    // if no key has been pressed, 
+                    //  keep getting the current the opcode and running this instruction
+                    if (!any_key_pressed){
+                        chip8->PC-=2; 
+                    }
+                    break;
+
+                case 0x1E:
+                    // 0FX1E: I+= VX; Add VX to register I. For non-Amiga CHIP8, does not affect VF 
+                    chip8->I += chip8->V[chip8->inst.X];
+                    break;
+                
+                case 0x07:
+                    // 0xFX07: set VX to the value of delay timer
+                    chip8->V[chip8->inst.X] = chip8->delay_timer;
+                    break;
+
+                case 0x15:
+                    // 0xFX15: set delay timer to value of VX
+                    chip8->delay_timer = chip8->V[chip8->inst.X];
+                    break;
+                
+                case 0x18:
+                    // 0xFX18: set delay timer to value of VX
+                    chip8->sound_timer = chip8->V[chip8->inst.X];
+                    break;
+
+                case 0x29:
+                    // 0xFX29: set register I to sprite location in memory for character in VX (0x0-0xF)
+                    chip8->I = chip8->V[chip8->inst.X] * 5;
+                    break;
+
+                case 0x30:
+                    // 0xFX30 (SUPER-CHIP): set register I to the 8x10 big font digit in VX
+                    chip8->I = CHIP8_BIG_FONT + (chip8->V[chip8->inst.X] & 0xF) * 10;
+                    break;
+                
+                case 0x33:
+                    // 0xFX33: Store BCD (binary coded decimal) representation of VX at memory offset from I;
+                    //      I = hundred's place, I + 1 = ten's place, I + 2 = one's place
+                    uint8_t bcd = chip8->V[chip8->inst.X];
+                    chip8->ram[chip8->I + 2] = bcd % 10;
+                    bcd /= 10;
+                    chip8->ram[chip8->I + 1] = bcd % 10; 
+                    bcd /= 10;
+                    chip8->ram[chip8->I] = bcd;
+                    break;
+
+                case 0x55:
+                    // 0xFX55: Register dump V0-VF inclusive to memory offset from I;
+                    // SCHIP does not increment I, CHIP8 does increment I
+                    for (uint8_t i =0; i <= chip8->inst.X; i++) {
+                        chip8->ram[chip8->I + i] = chip8 ->V[i];
+                    }
+                    if (QUIRK_INCREMENT_I(quirks)) chip8->I += chip8->inst.X + 1;
+                    break;
+
+                case 0x65:
+                    // 0xFX65: Register load V0-VF from memory offset from I;
+                    // SCHIP does not increment I, CHIP8 does increment I
+                    for (uint8_t i =0; i <= chip8->inst.X; i++) {
+                        chip8 ->V[i] = chip8->ram[chip8->I + i];
+                    }
+                    if (QUIRK_INCREMENT_I(quirks)) chip8->I += chip8->inst.X + 1;
+                    break;
+
+                case 0x75:
+                    // 0xFX75 (SUPER-CHIP): save V0-VX to the user flags
+                    memcpy(chip8->flags, chip8->V, chip8->inst.X + 1);
+                    break;
+
+                case 0x85:
+                    // 0xFX85 (SUPER-CHIP): load V0-VX from the user flags
+                    memcpy(chip8->V, chip8->flags, chip8->inst.X + 1);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        
+        default:
+            break; //unimplemented or invalid opcode
+    }
+
+    PROFILE_END(chip8);
+}
+
+// Emulate 1 CHIP8 instruction
+void emulate_instruction(chip8_t *chip8){
+    switch (chip8->quirks){
+        case QUIRKS_CHIP8:  execute_instruction(chip8, QUIRKS_CHIP8); break;
+        case QUIRKS_SCHIP:  execute_instruction(chip8, QUIRKS_SCHIP); break;
+        case QUIRKS_XOCHIP: execute_instruction(chip8, QUIRKS_XOCHIP); break;
+        default:            execute_instruction(chip8, QUIRKS_DEFAULT); break;
+    }
+}
+
+// Run count instructions through the reference switch, the profile is picked once for all of them
+void run_reference(chip8_t *chip8, uint32_t count){
+    switch (chip8->quirks){
+        case QUIRKS_CHIP8:  while (count--) execute_instruction(chip8, QUIRKS_CHIP8); break;
+        case QUIRKS_SCHIP:  while (count--) execute_instruction(chip8, QUIRKS_SCHIP); break;
+        case QUIRKS_XOCHIP: while (count--) execute_instruction(chip8, QUIRKS_XOCHIP); break;
+        default:            while (count--) execute_instruction(chip8, QUIRKS_DEFAULT); break;
+    }
+}
+
+// Setup an execution engine with empty caches
+void init_engine(chip8_engine_t *engine, const engine_type_t type){
+    engine->type = type;
+    engine->idle_wait = 0;
+    engine->idle_backoff = 1;
+    if (type == ENGINE_PREDECODE) init_cache(&engine->cache);
+    if (type == ENGINE_BLOCKS) init_blocks(&engine->blocks);
+}
+
+// Emulate count CHIP8 instructions with the given execution engine
+void run_engine(chip8_t *chip8, chip8_engine_t *engine, uint32_t count){
+    switch (engine->type){
+        case ENGINE_PREDECODE:
+            while (count--) emulate_instruction_cached(chip8, &engine->cache);
+            break;
+        case ENGINE_BLOCKS:
+            run_blocks(chip8, &engine->blocks, count);
+            break;
+        case ENGINE_REFERENCE:
+            run_reference(chip8, count);
+            break;
+        default:
+            run_instructions(chip8, count);
+            break;
+    }
+}
+
+// Scheduler: emulated time is counted in instructions (cycles), at inst_per_second cycles per emulated second.
+//  Timer tick N is due once N/60 of an emulated second has passed, i.e at cycle N * inst_per_second / 60,
+//  so the timers run at exactly 60hz of emulated time whatever the clock rate or render rate is
+
+// Cycle count the next 60hz timer tick is due at
+static uint64_t next_tick_cycle(const chip8_t *chip8, const config_t config){
+    return (chip8->timer_ticks + 1) * config.inst_per_second / 60;
+}
+
+// Idle loops
+//  Lots of ROMs spend most of their time in a tight loop waiting for the delay timer (FX07, 3XNN, 1NNN),
+//  waiting for a key (FX0A runs itself again) or jumping to themselves at the end. If a pass through the
+//  loop only reads the machine and writes V/I, and comes back to where it started with V/I unchanged, every
+//  other pass will do exactly the same until a timer tick or a keypad change. So those passes can be
+//  counted instead of run, and if the loop doesn't even look at the timers, across timer ticks too.
+//  Input only changes between run_cycles calls so it never interrupts a skip.
+
+#define IDLE_MAX_LOOP 16       // longest loop (instructions) looked for
+#define IDLE_MAX_BACKOFF 64    // most run_cycles chunks between probes while nothing is found
+
+// True if an instruction can't change anything a loop pass is compared on (RAM, display, stack, timers,
+//  random state). *reads_timers is set if it reads a timer
+static bool idle_safe(const uint16_t opcode, bool *reads_timers){
+    switch (opcode >> 12){
+        case 0x0:
+            return opcode == 0x00FD;      // SUPER-CHIP exit just runs itself again
+        case 0x1: case 0x3: case 0x4: case 0x5: case 0x6: case 0x7:
+        case 0x8: case 0x9: case 0xA: case 0xB: case 0xE:
+            return true;
+        case 0xF:
+            switch (opcode & 0xFF){
+                case 0x07: *reads_timers = true; return true;
+                case 0x0A: case 0x1E: case 0x29: case 0x30: case 0x65: case 0x85: return true;
+                default: return false;    // FX15/FX18 set timers, FX33/FX55 write RAM
+            }
+        default:
+            return false;                 // 00E0/DXYN draw, 2NNN/00EE use the stack, CXNN the random state
+    }
+}
+
+// Run up to limit instructions looking for an idle loop from the current PC. Returns the instructions run
+//  (for real, on the selected engine like any others, so they count), *loop is the loop length if one was
+//  found and 0 if not
+static uint32_t probe_idle_loop(chip8_t *chip8, chip8_engine_t *engine, const uint32_t limit, uint32_t *loop,
+                                bool *reads_timers){
+    const uint16_t start_pc = chip8->PC;
+    const uint16_t start_I = chip8->I;
+    uint8_t start_V[16];
+    memcpy(start_V, chip8->V, sizeof start_V);
+
+    *loop = 0;
+    *reads_timers = false;
+    bool safe = true;
+    uint32_t executed = 0;
+    while (executed < limit && chip8->PC + 1u < sizeof chip8->ram){
+        safe &= idle_safe((chip8->ram[chip8->PC] << 8) | chip8->ram[chip8->PC+1], reads_timers);
+        run_engine(chip8, engine, 1);
+        executed++;
+        if (!safe) break;
+        if (chip8->PC == start_pc){
+            if (chip8->I == start_I && memcmp(chip8->V, start_V, sizeof start_V) == 0) *loop = executed;
+            break;
+        }
+    }
+    return executed;
+}
+
+// Jump emulated time forward by cycles (a whole number of idle loop passes that don't read the timers),
+//  ticking the timers as many times as they would have been
+static void skip_idle_cycles(chip8_t *chip8, const config_t config, const uint64_t cycles){
+    chip8->cycles += cycles;
+
+    // ticks due by now: the last tick N with N * inst_per_second / 60 <= cycles
+    const uint64_t ticks = (60 * (chip8->cycles + 1) - 1) / config.inst_per_second;
+    const uint64_t passed = ticks - chip8->timer_ticks;
+    chip8->delay_timer = chip8->delay_timer > passed ? chip8->delay_timer - passed : 0;
+    chip8->sound_timer = chip8->sound_timer > passed ? chip8->sound_timer - passed : 0;
+    chip8->timer_ticks = ticks;
+}
+
+// Emulate exactly count instructions, ticking the timers whenever emulated time crosses a 1/60s boundary
+void run_cycles(chip8_t *chip8, chip8_engine_t *engine, const config_t config, uint64_t count){
+    while (count){
+        const uint64_t tick_at = next_tick_cycle(chip8, config);
+
+        // run up to the next timer tick or the end of the budget, whichever comes first
+        uint64_t run = tick_at - chip8->cycles;
+        if (run > count) run = count;
+        if (run > UINT32_MAX) run = UINT32_MAX;
+
+        // every so often (every chunk while idle loops keep turning up) check for one before running the chunk
+        if (config.idle_skip && run > 1 && engine->idle_wait-- == 0){
+            uint32_t loop;
+            bool reads_timers;
+            const uint32_t executed = probe_idle_loop(chip8, engine, run < IDLE_MAX_LOOP ? run : IDLE_MAX_LOOP,
+                                                      &loop, &reads_timers);
+            chip8->cycles += executed;
+            count -= executed;
+            run -= executed;
+
+            if (!loop){
+                engine->idle_wait = engine->idle_backoff;
+                if (engine->idle_backoff < IDLE_MAX_BACKOFF) engine->idle_backoff *= 2;
+            }else{
+                engine->idle_wait = 0;
+                engine->idle_backoff = 1;
+                if (!reads_timers){
+                    // stuck until input changes: skip all the whole passes left in the budget, ticks and all
+                    const uint64_t skip = count / loop * loop;
+                    skip_idle_cycles(chip8, config, skip);
+                    count -= skip;
+                    continue;
+                }
+
+                // waiting on a timer: skip the whole passes before the next tick
+                const uint64_t skip = run / loop * loop;
+                chip8->cycles += skip;
+                count -= skip;
+                run -= skip;
+            }
+        }
+
+        run_engine(chip8, engine, run);
+        chip8->cycles += run;
+        count -= run;
+
+        if (chip8->cycles == tick_at){
+            update_timers(chip8);
+            chip8->timer_ticks++;
+        }
+    }
+}
+
+// Emulate until the next 60hz timer tick (1 emulated frame)
+void run_frame(chip8_t *chip8, chip8_engine_t *engine, const config_t config){
+    run_cycles(chip8, engine, config, next_tick_cycle(chip8, config) - chip8->cycles);
+}
+
+// True if the machine can't make progress on its own
+bool is_halted(const chip8_t *chip8){
+    if (chip8->PC + 1u >= sizeof chip8->ram) return false;
+    const uint16_t opcode = (chip8->ram[chip8->PC] << 8) | chip8->ram[chip8->PC+1];
+
+    // 1NNN jumping to its own address, the usual "end of program" loop
+    if ((opcode & 0xF000) == 0x1000 && (opcode & 0x0FFF) == chip8->PC) return true;
+
+    // SUPER-CHIP 00FD exit runs itself forever
+    if (opcode == 0x00FD) return true;
+
+    // FX0A with no key held will wait forever unless someone presses a key
+    if ((opcode & 0xF0FF) == 0xF00A){
+        for (uint8_t i = 0; i < sizeof chip8->keypad; i++){
+            if (chip8->keypad[i]) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Fast non-cryptographic (FNV-1a) hash of the framebuffer
+uint64_t hash_display(const chip8_t *chip8){
+    uint64_t hash = 0xCBF29CE484222325ull; // FNV offset basis
+    // 1 packed word (64 pixels) at a time rather than the usual byte at a time, it only needs to be stable.
+    //  Only the area the current resolution uses, of each plane
+    const uint32_t height = display_height(chip8), words = display_width(chip8) / 64;
+    for (uint32_t plane = 0; plane < CHIP8_PLANES; plane++){
+        for (uint32_t y = 0; y < height; y++){
+            for (uint32_t word = 0; word < words; word++){
+                hash ^= chip8->display[plane][y][word];
+                hash *= 0x100000001B3ull;      // FNV prime
+            }
+        }
+    }
+    return hash;
+}
+
+// Update CHIP8 delay and sound timers every 60hz (the frontend plays sound while sound_timer > 0)
+void update_timers(chip8_t* chip8){
+    if (chip8->delay_timer > 0) chip8->delay_timer--;
+    if (chip8->sound_timer > 0) chip8->sound_timer--;
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+
+#include "chip8.h"
+
+/* Disassembler
+    Opcodes to the usual (Cowgod style) CHIP8 assembly mnemonics, plus hexdump/disassembly listings of a
+    loaded machine for the --hexdump/--disasm options. Words that aren't instructions (sprites, data)
+    disassemble as ".word", there is no way to tell code from data without running it.
+*/
+
+
+// Disassemble 1 instruction into text, e.g "LD VA, 0x05"
+void disassemble(const uint16_t opcode, char *text, const size_t size){
+    const uint16_t NNN = opcode & 0x0FFF;
+    const uint8_t NN = opcode & 0xFF, N = opcode & 0xF, X = (opcode >> 8) & 0xF, Y = (opcode >> 4) & 0xF;
+
+    switch (opcode >> 12){
+        case 0x0:
+            if (opcode == 0x00E0) snprintf(text, size, "CLS");
+            else if (opcode == 0x00EE) snprintf(text, size, "RET");
+            else if ((opcode & 0xFFF0) == 0x00C0) snprintf(text, size, "SCD %u", N);    // SUPER-CHIP
+            else if ((opcode & 0xFFF0) == 0x00D0) snprintf(text, size, "SCU %u", N);    // XO-CHIP
+            else if (opcode == 0x00FB) snprintf(text, size, "SCR");
+            else if (opcode == 0x00FC) snprintf(text, size, "SCL");
+            else if (opcode == 0x00FD) snprintf(text, size, "EXIT");
+            else if (opcode == 0x00FE) snprintf(text, size, "LOW");
+            else if (opcode == 0x00FF) snprintf(text, size, "HIGH");
+            else snprintf(text, size, "SYS 0x%03X", NNN); // machine code routine, ignored
+            return;
+        case 0x1: snprintf(text, size, "JP 0x%03X", NNN); return;
+        case 0x2: snprintf(text, size, "CALL 0x%03X", NNN); return;
+        case 0x3: snprintf(text, size, "SE V%X, 0x%02X", X, NN); return;
+        case 0x4: snprintf(text, size, "SNE V%X, 0x%02X", X, NN); return;
+        case 0x5:
+            if (N == 0){snprintf(text, size, "SE V%X, V%X", X, Y); return;}
+            break;
+        case 0x6: snprintf(text, size, "LD V%X, 0x%02X", X, NN); return;
+        case 0x7: snprintf(text, size, "ADD V%X, 0x%02X", X, NN); return;
+        case 0x8: {
+            static const char *const alu[16] = {
+                [0x0] = "LD", [0x1] = "OR", [0x2] = "AND", [0x3] = "XOR",
+                [0x4] = "ADD", [0x5] = "SUB", [0x6] = "SHR", [0x7] = "SUBN", [0xE] = "SHL",
+            };
+            if (alu[N]){snprintf(text, size, "%s V%X, V%X", alu[N], X, Y); return;}
+            break;
+        }
+        case 0x9:
+            if (N == 0){snprintf(text, size, "SNE V%X, V%X", X, Y); return;}
+            break;
+        case 0xA: snprintf(text, size, "LD I, 0x%03X", NNN); return;
+        case 0xB: snprintf(text, size, "JP V0, 0x%03X", NNN); return;
+        case 0xC: snprintf(text, size, "RND V%X, 0x%02X", X, NN); return;
+        case 0xD: snprintf(text, size, "DRW V%X, V%X, %u", X, Y, N); return;
+        case 0xE:
+            if (NN == 0x9E){snprintf(text, size, "SKP V%X", X); return;}
+            if (NN == 0xA1){snprintf(text, size, "SKNP V%X", X); return;}
+            break;
+        case 0xF:
+            switch (NN){
+                case 0x01: snprintf(text, size, "PLANE %u", X); return;    // XO-CHIP
+                case 0x07: snprintf(text, size, "LD V%X, DT", X); return;
+                case 0x0A: snprintf(text, size, "LD V%X, K", X); return;
+                case 0x15: snprintf(text, size, "LD DT, V%X", X); return;
+                case 0x18: snprintf(text, size, "LD ST, V%X", X); return;
+                case 0x1E: snprintf(text, size, "ADD I, V%X", X); return;
+                case 0x29: snprintf(text, size, "LD F, V%X", X); return;
+                case 0x30: snprintf(text, size, "LD HF, V%X", X); return;  // SUPER-CHIP
+                case 0x33: snprintf(text, size, "LD B, V%X", X); return;
+                case 0x55: snprintf(text, size, "LD [I], V%X", X); return;
+                case 0x65: snprintf(text, size, "LD V%X, [I]", X); return;
+                case 0x75: snprintf(text, size, "LD R, V%X", X); return;   // SUPER-CHIP
+                case 0x85: snprintf(text, size, "LD V%X, R", X); return;
+                default: break;
+            }
+            break;
+    }
+    snprintf(text, size, ".word 0x%04X", opcode);
+}
+
+// Print the RAM as a hexdump, 16 bytes per line
+void print_hexdump(const chip8_t *chip8){
+    for (uint32_t addr = 0; addr < sizeof chip8->ram; addr += 16){
+        printf("0x%03X:", addr);
+        for (uint32_t i = 0; i < 16; i++) printf(" %02X", chip8->ram[addr + i]);
+        printf("  |");
+        for (uint32_t i = 0; i < 16; i++){
+            const uint8_t byte = chip8->ram[addr + i];
+            putchar(byte >= 0x20 && byte < 0x7F ? byte : '.');
+        }
+        printf("|\n");
+    }
+}
+
+// Print a disassembly of the loaded ROM, 1 instruction per line with its address and opcode
+void print_disassembly(const chip8_t *chip8){
+    printf("; %s, %u bytes\n", chip8->rom_name, chip8->rom_size);
+    const uint32_t end = 0x200 + chip8->rom_size;
+    for (uint32_t addr = 0x200; addr < end; addr += 2){
+        // an odd sized ROM ends in half an instruction, the byte after it is 0
+        const uint16_t opcode = (chip8->ram[addr] << 8) | (addr + 1 < end ? chip8->ram[addr + 1] : 0);
+        char text[32];
+        disassemble(opcode, text, sizeof text);
+        printf("0x%03X  %04X  %s\n", addr, opcode, text);
+    }
+}
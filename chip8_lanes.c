@@ -0,0 +1,299 @@
+#include <string.h>
+
+#include "chip8.h"
+#include "chip8_ops.h"
+
+/* Lockstep lanes
+    Every step runs exactly 1 instruction on every lane. Lanes are grouped by the opcode they are about to run
+    (whatever their PC), and each group runs together: common instructions (1NNN, skips, 6XNN, 7XNN, 8XY*, ANNN)
+    are done across the whole group with masked vector ops, anything else (and odd groups) goes lane by lane
+    through emulate_instruction. With identical ROMs lanes mostly stay together so most steps are 1 group.
+
+    SIMD uses GCC/clang vector extensions, which compile down to SSE2/AVX2/NEON for whatever the target is
+    (e.g. build with CFLAGS+=-march=native for AVX2); other compilers always run lanes through the scalar path.
+*/
+
+// Copy lane's V/I/PC into its chip8_t
+static void store_lane(chip8_lanes_t *lanes, const uint32_t lane){
+    chip8_t *chip8 = &lanes->machines[lane];
+    for (uint8_t x = 0; x < 16; x++) chip8->V[x] = lanes->V[x][lane];
+    chip8->I = lanes->I[lane];
+    chip8->PC = lanes->PC[lane];
+}
+
+// Copy lane's V/I/PC from its chip8_t
+static void load_lane(chip8_lanes_t *lanes, const uint32_t lane){
+    const chip8_t *chip8 = &lanes->machines[lane];
+    for (uint8_t x = 0; x < 16; x++) lanes->V[x][lane] = chip8->V[x];
+    lanes->I[lane] = chip8->I;
+    lanes->PC[lane] = chip8->PC;
+}
+
+// Run 1 instruction on each lane in lanes_mask (bit N = lane N) through the reference switch
+static void run_scalar(chip8_lanes_t *lanes, const uint32_t lanes_mask){
+    for (uint32_t lane = 0; lane < lanes->count; lane++){
+        if (!((lanes_mask >> lane) & 1)) continue;
+
+        store_lane(lanes, lane);
+        emulate_instruction(&lanes->machines[lane]);
+        load_lane(lanes, lane);
+    }
+}
+
+
+#ifdef __GNUC__
+
+// vectors only ever go between static functions in this file, so returning them with a different ABI
+//  with/without -mavx doesn't matter
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+typedef uint8_t lane_u8_t __attribute__((vector_size(CHIP8_LANES)));
+typedef int8_t lane_i8_t __attribute__((vector_size(CHIP8_LANES)));
+typedef uint16_t lane_u16_t __attribute__((vector_size(CHIP8_LANES * 2)));
+typedef int16_t lane_i16_t __attribute__((vector_size(CHIP8_LANES * 2)));
+
+// SoA arrays aren't guaranteed to be vector aligned, memcpy compiles to unaligned vector loads/stores
+static inline lane_u8_t load_v(const chip8_lanes_t *lanes, const uint8_t x){
+    lane_u8_t v;
+    memcpy(&v, lanes->V[x], sizeof v);
+    return v;
+}
+
+static inline lane_u16_t load_u16(const uint16_t *array){
+    lane_u16_t v;
+    memcpy(&v, array, sizeof v);
+    return v;
+}
+
+// 8 bit lane mask (0x00/0xFF per lane) from a bitmap
+static inline lane_u8_t mask_from_bits(const uint32_t bits){
+    lane_u8_t mask;
+    for (uint32_t lane = 0; lane < CHIP8_LANES; lane++) mask[lane] = (bits >> lane) & 1 ? 0xFF : 0x00;
+    return mask;
+}
+
+// Vectors are only passed by value as return values, the stores/widening are macros so no vector is ever
+//  passed as a parameter (GCC warns about the wide vector ABI differing with/without -mavx otherwise)
+
+// VX = value in masked lanes only
+#define STORE_V(lanes, x, value, mask) do { \
+        const lane_u8_t v_ = (load_v(lanes, x) & ~(mask)) | ((value) & (mask)); \
+        memcpy((lanes)->V[x], &v_, sizeof v_); \
+    } while (0)
+
+// array = value in masked lanes only
+#define STORE_U16(array, value, mask) do { \
+        const lane_u16_t v_ = (load_u16(array) & ~(mask)) | ((value) & (mask)); \
+        memcpy(array, &v_, sizeof v_); \
+    } while (0)
+
+// Widen an 8 bit lane mask/flag to 16 bits, 0xFF -> 0xFFFF
+#define WIDEN(v) ((lane_u16_t)__builtin_convertvector((lane_i8_t)(v), lane_i16_t))
+
+// True if opcode has a vector implementation
+static bool is_vector_op(const uint16_t opcode){
+    switch (opcode >> 12){
+        case 0x1: case 0x3: case 0x4: case 0x5: case 0x6: case 0x7: case 0x8: case 0x9: case 0xA:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Run 1 instruction (opcode) across the lanes in mask, mirrors emulate_instruction step for step,
+//  including the order VF and VX are written in for 8XY* with X or Y = F; lanes_mask bit N = lane N.
+//  shift_vy is the lanes' QUIRK_SHIFT_VY, a constant wherever this is inlined
+static ALWAYS_INLINE void run_vector(chip8_lanes_t *lanes, const uint16_t opcode, const uint32_t lanes_mask,
+                                     const bool shift_vy){
+    const lane_u8_t mask = mask_from_bits(lanes_mask);
+    const uint8_t X = (opcode >> 8) & 0x0F, Y = (opcode >> 4) & 0x0F, N = opcode & 0x0F, NN = opcode & 0xFF;
+    const uint16_t NNN = opcode & 0x0FFF;
+    const lane_u16_t mask16 = WIDEN(mask);
+
+    // PC += 2 ahead of executing, like the fetch in emulate_instruction
+    lane_u16_t pc = load_u16(lanes->PC) + 2;
+    lane_u8_t vx = load_v(lanes, X), vy = load_v(lanes, Y);
+    lane_u8_t skip = {0};    // 0xFF in lanes skipping the next instruction
+
+    switch (opcode >> 12){
+        case 0x1:
+            // 0x1NNN: jump to address NNN
+            pc = (lane_u16_t){0} + NNN;
+            break;
+
+        case 0x3:
+            // 0x3XNN: skip next instruction if VX equals NN
+            skip = (lane_u8_t)(vx == NN);
+            break;
+
+        case 0x4:
+            // 0x4XNN: skip next instruction if VX does not equal NN
+            skip = (lane_u8_t)(vx != NN);
+            break;
+
+        case 0x5:
+            // 0x5XY0: skip next instruction if VX equals VY
+            skip = (lane_u8_t)(vx == vy);
+            break;
+
+        case 0x6:
+            // 0x6XNN: VX = NN
+            STORE_V(lanes, X, (lane_u8_t){0} + NN, mask);
+            break;
+
+        case 0x7:
+            // 0x7XNN: VX += NN
+            STORE_V(lanes, X, vx + NN, mask);
+            break;
+
+        case 0x8:
+            switch (N){
+                case 0: STORE_V(lanes, X, vy, mask); break;         // 0x8XY0: VX = VY
+                case 1: STORE_V(lanes, X, vx | vy, mask); break;    // 0x8XY1: VX |= VY
+                case 2: STORE_V(lanes, X, vx & vy, mask); break;    // 0x8XY2: VX &= VY
+                case 3: STORE_V(lanes, X, vx ^ vy, mask); break;    // 0x8XY3: VX ^= VY
+
+                // flags are written first, then VX is recomputed from the registers as they are now
+                case 4:
+                    // 0x8XY4: VX += VY, VF = carry
+                    STORE_V(lanes, 0xF, (lane_u8_t)((lane_u8_t)(vx + vy) < vx) & 1, mask);
+                    STORE_V(lanes, X, load_v(lanes, X) + load_v(lanes, Y), mask);
+                    break;
+                case 5:
+                    // 0x8XY5: VX -= VY, VF = not borrow
+                    STORE_V(lanes, 0xF, (lane_u8_t)(vx >= vy) & 1, mask);
+                    STORE_V(lanes, X, load_v(lanes, X) - load_v(lanes, Y), mask);
+                    break;
+                case 6:
+                    // 0x8XY6: VF = LSB of VX, VX >>= 1 (VX = VY >> 1, then VF = LSB of VY)
+                    if (shift_vy){
+                        STORE_V(lanes, X, vy >> 1, mask);
+                        STORE_V(lanes, 0xF, vy & 1, mask);
+                        break;
+                    }
+                    STORE_V(lanes, 0xF, vx & 1, mask);
+                    STORE_V(lanes, X, load_v(lanes, X) >> 1, mask);
+                    break;
+                case 7:
+                    // 0x8XY7: VX = VY - VX, VF = not borrow
+                    STORE_V(lanes, 0xF, (lane_u8_t)(vx <= vy) & 1, mask);
+                    STORE_V(lanes, X, load_v(lanes, Y) - load_v(lanes, X), mask);
+                    break;
+                case 0xE:
+                    // 0x8XYE: VF = MSB of VX, VX <<= 1 (VX = VY << 1, then VF = MSB of VY)
+                    if (shift_vy){
+                        STORE_V(lanes, X, vy << 1, mask);
+                        STORE_V(lanes, 0xF, vy >> 7, mask);
+                        break;
+                    }
+                    STORE_V(lanes, 0xF, vx >> 7, mask);
+                    STORE_V(lanes, X, load_v(lanes, X) << 1, mask);
+                    break;
+                default:
+                    break; // unimplemented opcode
+            }
+            break;
+
+        case 0x9:
+            // 0x9XY0: skip next instruction if VX does not equal VY
+            skip = (lane_u8_t)(vx != vy);
+            break;
+
+        case 0xA:
+            // 0xANNN: I = NNN
+            STORE_U16(lanes->I, (lane_u16_t){0} + NNN, mask16);
+            break;
+    }
+
+    STORE_U16(lanes->PC, pc + (WIDEN(skip) & 2), mask16);
+}
+
+#endif // __GNUC__
+
+
+// Run 1 instruction on every lane, shift_vy as in run_vector
+static ALWAYS_INLINE void step_lanes(chip8_lanes_t *lanes, const bool shift_vy){
+    uint16_t opcodes[CHIP8_LANES];
+    uint32_t pending = lanes->count == 32 ? 0xFFFFFFFFu : (1u << lanes->count) - 1;
+
+    for (uint32_t lane = 0; lane < lanes->count; lane++){
+        const uint16_t pc = lanes->PC[lane];
+        const uint8_t *ram = lanes->machines[lane].ram;
+        // PC right at the end of RAM is left to the reference switch
+        if (pc + 1u >= sizeof lanes->machines[lane].ram){
+            run_scalar(lanes, 1u << lane);
+            pending &= ~(1u << lane);
+            opcodes[lane] = 0;
+            continue;
+        }
+        opcodes[lane] = (ram[pc] << 8) | ram[pc+1];
+    }
+
+    while (pending){
+        // group every pending lane running the same opcode as the first one
+        uint32_t first = 0;
+        while (!((pending >> first) & 1)) first++;
+        const uint16_t opcode = opcodes[first];
+        uint32_t group = 0;
+        for (uint32_t lane = 0; lane < lanes->count; lane++)
+            if (opcodes[lane] == opcode) group |= 1u << lane;
+        group &= pending;
+        pending &= ~group;
+
+#ifdef __GNUC__
+        if (is_vector_op(opcode)){
+            run_vector(lanes, opcode, group, shift_vy);
+            continue;
+        }
+#else
+        (void)shift_vy;
+#endif
+        run_scalar(lanes, group);
+    }
+}
+
+
+// Setup count lanes as copies of machine
+void init_lanes(chip8_lanes_t *lanes, const chip8_t *machine, const uint32_t count){
+    lanes->count = count < 1 ? 1 : count > CHIP8_LANES ? CHIP8_LANES : count;
+    for (uint32_t lane = 0; lane < lanes->count; lane++){
+        chip8_t *chip8 = &lanes->machines[lane];
+        *chip8 = *machine;
+        chip8->stack_ptr = chip8->stack + (machine->stack_ptr - machine->stack); // point at this lane's own stack
+        load_lane(lanes, lane);
+    }
+}
+
+// Emulate count instructions on every lane in lockstep, timers tick exactly as in run_cycles
+void run_lanes(chip8_lanes_t *lanes, const config_t config, uint64_t count){
+    while (count){
+        // lanes stay in lockstep so lane 0's emulated time is everyone's
+        const chip8_t *first = &lanes->machines[0];
+        const uint64_t tick_at = (first->timer_ticks + 1) * config.inst_per_second / 60;
+
+        uint64_t run = tick_at - first->cycles;
+        if (run > count) run = count;
+        count -= run;
+
+        // every lane runs the same ROM under the same quirk profile, pick the specialised step once
+        if (QUIRK_SHIFT_VY(first->quirks)) for (uint64_t i = 0; i < run; i++) step_lanes(lanes, true);
+        else for (uint64_t i = 0; i < run; i++) step_lanes(lanes, false);
+
+        for (uint32_t lane = 0; lane < lanes->count; lane++){
+            chip8_t *chip8 = &lanes->machines[lane];
+            chip8->cycles += run;
+            if (chip8->cycles == tick_at){
+                update_timers(chip8);
+                chip8->timer_ticks++;
+            }
+        }
+    }
+}
+
+// Copy a lane's V/I/PC back into its chip8_t and return it
+chip8_t *sync_lane(chip8_lanes_t *lanes, const uint32_t lane){
+    store_lane(lanes, lane);
+    return &lanes->machines[lane];
+}
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "chip8.h"
+
+/* Movies (input recordings)
+    A movie is the keypad state every time it changed, tagged with the emulated instruction count it changed at.
+    Input only ever changes between run_cycles calls, so replaying the changes at the same cycle counts with the
+    same seed and clock rate reproduces the run exactly, with no event loop or real time involved.
+
+    File format, all little endian:
+        "C8MV", u32 version, u64 seed, u64 length (cycles), u32 inst_per_second, u32 event count
+        then per event: cycles since the previous event as a LEB128 varint, u16 keypad bitmap
+    Most events are a few bytes.
+*/
+
+#define MOVIE_MAGIC 0x564D3843u  // "C8MV" in little endian
+#define MOVIE_VERSION 1
+
+
+// Keypad as a bitmap, bit N = key N
+static uint16_t keypad_bits(const chip8_t *chip8){
+    uint16_t keys = 0;
+    for (uint8_t i = 0; i < sizeof chip8->keypad; i++) keys |= (uint16_t)chip8->keypad[i] << i;
+    return keys;
+}
+
+// Little endian integer writes/reads
+static void put_uint(uint8_t **out, uint64_t value, const uint8_t bytes){
+    for (uint8_t i = 0; i < bytes; i++, value >>= 8) *(*out)++ = value & 0xFF;
+}
+
+static uint64_t get_uint(const uint8_t **in, const uint8_t bytes){
+    uint64_t value = 0;
+    for (uint8_t i = 0; i < bytes; i++) value |= (uint64_t)*(*in)++ << (i * 8);
+    return value;
+}
+
+
+// Start an empty movie for recording a run with this seed/config
+void init_movie(chip8_movie_t *movie, const uint64_t seed, const config_t config){
+    *movie = (chip8_movie_t){
+        .seed = seed,
+        .inst_per_second = config.inst_per_second,
+    };
+}
+
+// Record the keypad if it changed
+bool record_keypad(chip8_movie_t *movie, const chip8_t *chip8){
+    const uint16_t keys = keypad_bits(chip8);
+    const uint16_t last = movie->count ? movie->events[movie->count - 1].keys : 0;
+    if (keys == last) return true;
+
+    // several changes with no instructions run in between (e.g. while paused), only the last one matters
+    if (movie->count && movie->events[movie->count - 1].cycle == chip8->cycles){
+        movie->events[movie->count - 1].keys = keys;
+        if (movie->count == 1 ? keys == 0 : keys == movie->events[movie->count - 2].keys) movie->count--;
+        return true;
+    }
+
+    if (movie->count == movie->capacity){
+        const uint32_t capacity = movie->capacity ? movie->capacity * 2 : 256;
+        movie_event_t *events = realloc(movie->events, capacity * sizeof *events);
+        if (!events){
+            fprintf(stderr, "Out of memory recording movie\n");
+            return false;
+        }
+        movie->events = events;
+        movie->capacity = capacity;
+    }
+    movie->events[movie->count++] = (movie_event_t){.cycle = chip8->cycles, .keys = keys};
+    return true;
+}
+
+// Write a recorded movie to a file
+bool save_movie(chip8_movie_t *movie, const uint64_t length, const char *path){
+    movie->length = length;
+
+    // header + worst case 10 byte varint and 2 byte keys per event
+    uint8_t *buffer = malloc(32 + (size_t)movie->count * 12);
+    if (!buffer){
+        fprintf(stderr, "Out of memory saving movie\n");
+        return false;
+    }
+
+    uint8_t *out = buffer;
+    put_uint(&out, MOVIE_MAGIC, 4);
+    put_uint(&out, MOVIE_VERSION, 4);
+    put_uint(&out, movie->seed, 8);
+    put_uint(&out, movie->length, 8);
+    put_uint(&out, movie->inst_per_second, 4);
+    put_uint(&out, movie->count, 4);
+
+    uint64_t cycle = 0;
+    for (uint32_t i = 0; i < movie->count; i++){
+        uint64_t delta = movie->events[i].cycle - cycle;
+        cycle = movie->events[i].cycle;
+        do {
+            *out++ = (delta & 0x7F) | (delta > 0x7F ? 0x80 : 0);
+            delta >>= 7;
+        } while (delta);
+        put_uint(&out, movie->events[i].keys, 2);
+    }
+
+    FILE *file = fopen(path, "wb");
+    bool ok = file && fwrite(buffer, out - buffer, 1, file) == 1;
+    if (file && fclose(file) != 0) ok = false;
+    free(buffer);
+
+    if (!ok) fprintf(stderr, "Could not write movie file %s\n", path);
+    return ok;
+}
+
+// Read a movie file for replaying
+bool load_movie(chip8_movie_t *movie, const char *path){
+    *movie = (chip8_movie_t){0};
+
+    FILE *file = fopen(path, "rb");
+    if (!file){
+        fprintf(stderr, "Movie file %s is invalid or does not exist\n", path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    rewind(file);
+
+    uint8_t *buffer = size > 0 ? malloc(size) : NULL;
+    const bool read = buffer && fread(buffer, size, 1, file) == 1;
+    fclose(file);
+    if (!read || size < 32){
+        fprintf(stderr, "Could not read movie file %s\n", path);
+        free(buffer);
+        return false;
+    }
+
+    const uint8_t *in = buffer, *end = buffer + size;
+    const uint32_t magic = get_uint(&in, 4), version = get_uint(&in, 4);
+    if (magic != MOVIE_MAGIC || version != MOVIE_VERSION){
+        fprintf(stderr, "%s is not a version %u CHIP8 movie\n", path, MOVIE_VERSION);
+        free(buffer);
+        return false;
+    }
+    movie->seed = get_uint(&in, 8);
+    movie->length = get_uint(&in, 8);
+    movie->inst_per_second = get_uint(&in, 4);
+    const uint32_t count = get_uint(&in, 4);
+
+    movie->events = malloc((count ? count : 1) * sizeof *movie->events);
+    if (!movie->events){
+        fprintf(stderr, "Out of memory loading movie %s\n", path);
+        free(buffer);
+        return false;
+    }
+    movie->capacity = count;
+
+    uint64_t cycle = 0;
+    for (uint32_t i = 0; i < count; i++){
+        uint64_t delta = 0;
+        uint8_t shift = 0, byte;
+        do {
+            if (in == end || shift > 63) goto truncated;
+            byte = *in++;
+            delta |= (uint64_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        if (end - in < 2) goto truncated;
+
+        cycle += delta;
+        movie->events[i] = (movie_event_t){.cycle = cycle, .keys = get_uint(&in, 2)};
+        movie->count++;
+    }
+
+    free(buffer);
+    return true;
+
+truncated:
+    fprintf(stderr, "Movie file %s is truncated\n", path);
+    free(buffer);
+    free_movie(movie);
+    return false;
+}
+
+// Free a movie's events
+void free_movie(chip8_movie_t *movie){
+    free(movie->events);
+    movie->events = NULL;
+    movie->count = movie->capacity = movie->next = 0;
+}
+
+// Emulate count instructions, setting the keypad from the movie at exactly the recorded cycles
+void run_movie(chip8_t *chip8, chip8_engine_t *engine, const config_t config, chip8_movie_t *movie, uint64_t count){
+    while (count){
+        // apply every event that is due now
+        while (movie->next < movie->count && movie->events[movie->next].cycle <= chip8->cycles){
+            const uint16_t keys = movie->events[movie->next++].keys;
+            for (uint8_t i = 0; i < sizeof chip8->keypad; i++) chip8->keypad[i] = (keys >> i) & 1;
+        }
+
+        // then run up to the next one
+        uint64_t run = count;
+        if (movie->next < movie->count && movie->events[movie->next].cycle - chip8->cycles < run)
+            run = movie->events[movie->next].cycle - chip8->cycles;
+
+        run_cycles(chip8, engine, config, run);
+        count -= run;
+    }
+}
@@ -0,0 +1,560 @@
+#ifndef CHIP8_OPS_H
+#define CHIP8_OPS_H
+
+/* CHIP8 opcode handlers
+    One small function per opcode, shared by the faster execution engines (predecoded cache, ...).
+    The switch in emulate_instruction stays the reference implementation; these must behave exactly the same.
+    Handlers run with PC already incremented past the instruction, same as the switch.
+    Internal to the core, not part of the public chip8.h API.
+
+    Instructions the quirk profiles disagree on have 1 handler per behaviour (op_8XY6/op_8XY6_vy...),
+    lookup_handler picks the profile's one at decode time so handlers never check the profile themselves.
+
+    The SUPER-CHIP/XO-CHIP display instructions (00CN/00DN/00FB-00FF, DXY0, FN01, FX30/FX75/FX85) work under
+    every profile, none of them mean anything else to a plain CHIP8 program. The display helpers further down
+    are shared with the reference switch, so every engine draws and scrolls the packed rows the same way.
+*/
+
+#include <string.h>
+
+#include "chip8.h"
+
+#ifdef __GNUC__
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#define NEVER_INLINE __attribute__((noinline))
+#else
+#define ALWAYS_INLINE inline
+#define NEVER_INLINE
+#endif
+
+// Behaviours of each quirk profile, these fold away wherever the profile is a compile time constant
+#define QUIRK_SHIFT_VY(quirks) ((quirks) == QUIRKS_CHIP8 || (quirks) == QUIRKS_XOCHIP)    // 8XY6/8XYE shift VY into VX
+#define QUIRK_INCREMENT_I(quirks) ((quirks) == QUIRKS_CHIP8 || (quirks) == QUIRKS_XOCHIP) // FX55/FX65 I += X + 1
+#define QUIRK_JUMP_VX(quirks) ((quirks) == QUIRKS_SCHIP)                                  // BXNN jumps to XNN + VX
+#define QUIRK_SPRITE_WRAP(quirks) ((quirks) == QUIRKS_XOCHIP)                             // DXYN wraps at the edges
+
+
+// SUPER-CHIP big font, 8x10 digits 0-F for FX30, loaded right after the 5 byte font
+#define CHIP8_BIG_FONT 0x50
+
+// Clear the planes selected by FN01 (00E0)
+static inline void clear_planes(chip8_t *chip8){
+    for (uint8_t plane = 0; plane < CHIP8_PLANES; plane++){
+        if ((chip8->planes >> plane) & 1) memset(chip8->display[plane], 0, sizeof chip8->display[plane]);
+    }
+    chip8->dirty_rows = DIRTY_ALL_ROWS;
+}
+
+// Switch between 64x32 and 128x64 (00FE/00FF). Every plane is cleared, like XO-CHIP and modern SUPER-CHIP
+//  do, so nothing drawn in the other resolution is left outside the area the new one uses
+static inline void set_resolution(chip8_t *chip8, const bool hires){
+    chip8->hires = hires;
+    memset(chip8->display, 0, sizeof chip8->display);
+    chip8->dirty_rows = DIRTY_ALL_ROWS;
+}
+
+// Scroll the selected planes down (rows > 0, 00CN) or up (rows < 0, XO-CHIP 00DN) by whole rows of the
+//  current resolution: 1 memmove of the packed rows per plane, the rows scrolled in are blank
+static inline void scroll_rows(chip8_t *chip8, const int8_t rows){
+    const uint32_t height = display_height(chip8);
+    const uint32_t count = rows < 0 ? -rows : rows;
+    for (uint8_t plane = 0; plane < CHIP8_PLANES; plane++){
+        if (!((chip8->planes >> plane) & 1)) continue;
+        uint64_t (*display)[CHIP8_ROW_WORDS] = chip8->display[plane];
+        if (rows > 0){
+            memmove(display[count], display[0], (height - count) * sizeof display[0]);
+            memset(display[0], 0, count * sizeof display[0]);
+        }else{
+            memmove(display[0], display[count], (height - count) * sizeof display[0]);
+            memset(display[height - count], 0, count * sizeof display[0]);
+        }
+    }
+    chip8->dirty_rows = DIRTY_ALL_ROWS;
+}
+
+// Scroll the selected planes 4 pixels right (00FB) or left (00FC): a shift per packed word, carrying the bits
+//  that cross from one word of a 128x64 row into the other. Pixels pushed past the edge are gone
+static inline void scroll_columns(chip8_t *chip8, const bool right){
+    const uint32_t height = display_height(chip8);
+    for (uint8_t plane = 0; plane < CHIP8_PLANES; plane++){
+        if (!((chip8->planes >> plane) & 1)) continue;
+        for (uint32_t y = 0; y < height; y++){
+            uint64_t *row = chip8->display[plane][y];
+            if (!chip8->hires){
+                row[0] = right ? row[0] >> 4 : row[0] << 4;   // 64 pixels, word 1 stays blank
+            }else if (right){
+                row[1] = (row[1] >> 4) | (row[0] << 60);
+                row[0] >>= 4;
+            }else{
+                row[0] = (row[0] << 4) | (row[1] >> 60);
+                row[1] <<= 4;
+            }
+        }
+    }
+    chip8->dirty_rows |= height == 64 ? DIRTY_ALL_ROWS : (1ull << height) - 1;
+}
+
+// 0x00E0: clear screen (the selected planes)
+static inline void op_00E0(chip8_t *chip8, const instruction_t *inst){
+    (void)inst;
+    clear_planes(chip8);
+}
+
+// 0x00CN (SUPER-CHIP): scroll down N rows
+static inline void op_00CN(chip8_t *chip8, const instruction_t *inst){
+    scroll_rows(chip8, inst->N);
+}
+
+// 0x00DN (XO-CHIP): scroll up N rows
+static inline void op_00DN(chip8_t *chip8, const instruction_t *inst){
+    scroll_rows(chip8, -inst->N);
+}
+
+// 0x00FB (SUPER-CHIP): scroll right 4 pixels
+static inline void op_00FB(chip8_t *chip8, const instruction_t *inst){
+    (void)inst;
+    scroll_columns(chip8, true);
+}
+
+// 0x00FC (SUPER-CHIP): scroll left 4 pixels
+static inline void op_00FC(chip8_t *chip8, const instruction_t *inst){
+    (void)inst;
+    scroll_columns(chip8, false);
+}
+
+// 0x00FD (SUPER-CHIP): exit the interpreter. Runs itself again forever, which is_halted reports as halted
+static inline void op_00FD(chip8_t *chip8, const instruction_t *inst){
+    (void)inst;
+    chip8->PC -= 2;
+}
+
+// 0x00FE (SUPER-CHIP): 64x32
+static inline void op_00FE(chip8_t *chip8, const instruction_t *inst){
+    (void)inst;
+    set_resolution(chip8, false);
+}
+
+// 0x00FF (SUPER-CHIP): 128x64
+static inline void op_00FF(chip8_t *chip8, const instruction_t *inst){
+    (void)inst;
+    set_resolution(chip8, true);
+}
+
+// 0x00EE: return from subroutine
+static inline void op_00EE(chip8_t *chip8, const instruction_t *inst){
+    (void)inst;
+    chip8->PC = *--chip8->stack_ptr;
+}
+
+// unimplemented/invalid opcode, may be 0xNNN for calling machine code routine for RCA1802
+static inline void op_nop(chip8_t *chip8, const instruction_t *inst){
+    (void)chip8;
+    (void)inst;
+}
+
+// 0x1NNN: Jumps to address NNN
+static inline void op_1NNN(chip8_t *chip8, const instruction_t *inst){
+    chip8->PC = inst->NNN;
+}
+
+// 0x2NNN: Call subroutine at NNN
+static inline void op_2NNN(chip8_t *chip8, const instruction_t *inst){
+    *chip8->stack_ptr++ = chip8->PC;
+    chip8->PC = inst->NNN;
+}
+
+// 0x3XNN: Skips next instruction if VX equals NN
+static inline void op_3XNN(chip8_t *chip8, const instruction_t *inst){
+    if (chip8->V[inst->X] == inst->NN) chip8->PC += 2;
+}
+
+// 0x4XNN: Skips next instruction if VX does not equal NN
+static inline void op_4XNN(chip8_t *chip8, const instruction_t *inst){
+    if (chip8->V[inst->X] != inst->NN) chip8->PC += 2;
+}
+
+// 0x5XY0: Skips next instruction if VX equals VY
+static inline void op_5XY0(chip8_t *chip8, const instruction_t *inst){
+    if (chip8->V[inst->X] == chip8->V[inst->Y]) chip8->PC += 2;
+}
+
+// 0x6XNN: Set register VX to NN
+static inline void op_6XNN(chip8_t *chip8, const instruction_t *inst){
+    chip8->V[inst->X] = inst->NN;
+}
+
+// 0x7XNN: Set register VX += NN
+static inline void op_7XNN(chip8_t *chip8, const instruction_t *inst){
+    chip8->V[inst->X] += inst->NN;
+}
+
+// 0x8XY0: set register VX = VY
+static inline void op_8XY0(chip8_t *chip8, const instruction_t *inst){
+    chip8->V[inst->X] = chip8->V[inst->Y];
+}
+
+// 0x8XY1: set register VX to VX ORd with VY
+static inline void op_8XY1(chip8_t *chip8, const instruction_t *inst){
+    chip8->V[inst->X] |= chip8->V[inst->Y];
+}
+
+// 0x8XY2: set register VX to VX ANDd with VY
+static inline void op_8XY2(chip8_t *chip8, const instruction_t *inst){
+    chip8->V[inst->X] &= chip8->V[inst->Y];
+}
+
+// 0x8XY3: set register VX to VX XORd with VY
+static inline void op_8XY3(chip8_t *chip8, const instruction_t *inst){
+    chip8->V[inst->X] ^= chip8->V[inst->Y];
+}
+
+// 0x8XY4: set register VX to VX + VY, set VF to 1 if carry
+static inline void op_8XY4(chip8_t *chip8, const instruction_t *inst){
+    const bool carry = (uint16_t)chip8->V[inst->X] + chip8->V[inst->Y] > 255;
+    chip8->V[0xF] = carry;
+    chip8->V[inst->X] += chip8->V[inst->Y];
+}
+
+// 0x8XY5: set register VX to VX - VY, set VF to 1 if there is not a borrow (result is +ve/0)
+static inline void op_8XY5(chip8_t *chip8, const instruction_t *inst){
+    const bool no_borrow = chip8->V[inst->X] >= chip8->V[inst->Y];
+    chip8->V[0xF] = no_borrow;
+    chip8->V[inst->X] -= chip8->V[inst->Y];
+}
+
+// 0x8XY6: right shift VX by 1, store LSB of VX before shift to VF
+static inline void op_8XY6(chip8_t *chip8, const instruction_t *inst){
+    chip8->V[0xF] = chip8->V[inst->X] & 1;
+    chip8->V[inst->X] >>= 1;
+}
+
+// 0x8XY6 (QUIRK_SHIFT_VY): VX = VY >> 1, LSB of VY to VF (last, so it wins when X is F)
+static inline void op_8XY6_vy(chip8_t *chip8, const instruction_t *inst){
+    const uint8_t value = chip8->V[inst->Y];
+    chip8->V[inst->X] = value >> 1;
+    chip8->V[0xF] = value & 1;
+}
+
+// 0x8XY7: set register VX to VY - VX, set VF to 1 if there is not a borrow (result is +ve/0)
+static inline void op_8XY7(chip8_t *chip8, const instruction_t *inst){
+    const bool no_borrow = chip8->V[inst->X] <= chip8->V[inst->Y];
+    chip8->V[0xF] = no_borrow;
+    chip8->V[inst->X] = chip8->V[inst->Y] - chip8->V[inst->X];
+}
+
+// 0x8XYE: left shift VX by 1, store MSB of VX before shift to VF
+static inline void op_8XYE(chip8_t *chip8, const instruction_t *inst){
+    chip8->V[0xF] = (chip8->V[inst->X] & 0x80) >> 7;
+    chip8->V[inst->X] <<= 1;
+}
+
+// 0x8XYE (QUIRK_SHIFT_VY): VX = VY << 1, MSB of VY to VF
+static inline void op_8XYE_vy(chip8_t *chip8, const instruction_t *inst){
+    const uint8_t value = chip8->V[inst->Y];
+    chip8->V[inst->X] = value << 1;
+    chip8->V[0xF] = value >> 7;
+}
+
+// 0x9XY0: Skips the next instruction if VX != VY
+static inline void op_9XY0(chip8_t *chip8, const instruction_t *inst){
+    if (chip8->V[inst->X] != chip8->V[inst->Y]) chip8->PC += 2;
+}
+
+// 0xANNN: Set index register I to NNN
+static inline void op_ANNN(chip8_t *chip8, const instruction_t *inst){
+    chip8->I = inst->NNN;
+}
+
+// 0xBNNN: Jumps to the address NNN plus V0
+static inline void op_BNNN(chip8_t *chip8, const instruction_t *inst){
+    chip8->PC = chip8->V[0x0] + inst->NNN;
+}
+
+// 0xBXNN (QUIRK_JUMP_VX): Jumps to the address XNN plus VX
+static inline void op_BXNN(chip8_t *chip8, const instruction_t *inst){
+    chip8->PC = chip8->V[inst->X] + inst->NNN;
+}
+
+// 0xCXNN: Sets register VX = random byte & NN (bitwise AND)
+static inline void op_CXNN(chip8_t *chip8, const instruction_t *inst){
+    chip8->V[inst->X] = random_byte(chip8) & inst->NN;
+}
+
+// XOR 1 sprite row (up to 16 pixels in the top bits of sprite, MSB first) into display row y at X_coord,
+//  clipped at the right edge or wrapped around it. Returns the sprite bits that landed on pixels already on
+static ALWAYS_INLINE uint64_t draw_row(chip8_t *chip8, uint64_t *row, const uint8_t y, const uint64_t sprite,
+                                       const uint8_t X_coord, const bool hires, const bool wrap){
+    // line the sprite up with the row's words; wrapping is a rotate instead of a shift, bits pushed off the
+    //  right come back in on the left
+    uint64_t left, right = 0;
+    if (!hires){
+        left = !wrap ? sprite >> X_coord :
+               X_coord ? (sprite >> X_coord) | (sprite << (CHIP8_WIDTH - X_coord)) : sprite;
+    }else if (X_coord < 64){
+        left = sprite >> X_coord;
+        right = X_coord ? sprite << (64 - X_coord) : 0;
+    }else{
+        right = sprite >> (X_coord - 64);
+        left = wrap && X_coord > 64 ? sprite << (CHIP8_HIRES_WIDTH - X_coord) : 0;
+    }
+
+    const uint64_t collision = (row[0] & left) | (row[1] & right);
+    row[0] ^= left;
+    row[1] ^= right;
+    // only rows with set sprite bits change the display
+    chip8->dirty_rows |= (uint64_t)((left | right) != 0) << y;
+    return collision;
+}
+
+// Draw N height sprite at VX,VY from I in 64x32 with only plane 0 selected, what nearly every CHIP8 ROM
+//  draws: 8 pixels wide into word 0 of each row, clipped at the right/bottom edges or wrapped around them
+static ALWAYS_INLINE void draw_sprite_lores(chip8_t *chip8, const instruction_t *inst, const bool wrap){
+    const uint8_t X_coord = chip8->V[inst->X] % CHIP8_WIDTH;
+    const uint8_t Y_coord = chip8->V[inst->Y] % CHIP8_HEIGHT;
+    const uint8_t rows = wrap || inst->N < CHIP8_HEIGHT - Y_coord ? inst->N : CHIP8_HEIGHT - Y_coord;
+
+    uint64_t collision = 0;
+    for (uint8_t i = 0; i < rows; i++){
+        const uint64_t sprite = (uint64_t)chip8->ram[chip8->I + i] << 56;
+        const uint8_t y = wrap ? (Y_coord + i) % CHIP8_HEIGHT : Y_coord + i;
+        collision |= draw_row(chip8, chip8->display[0][y], y, sprite, X_coord, false, wrap);
+    }
+
+    chip8->V[0xF] = collision != 0;
+}
+
+// Draw N height sprite (DXY0: 16x16) at VX,VY from I into every selected plane in the current resolution.
+//  With 2 XO-CHIP planes selected the second plane's sprite follows the first one's in memory
+static NEVER_INLINE void draw_sprite_planes(chip8_t *chip8, const instruction_t *inst, const bool wrap){
+    const bool hires = chip8->hires;
+    const uint8_t width = hires ? CHIP8_HIRES_WIDTH : CHIP8_WIDTH;
+    const uint8_t height = hires ? CHIP8_HIRES_HEIGHT : CHIP8_HEIGHT;
+    // both resolutions are powers of 2, masks instead of a division by a width only known at runtime
+    const uint8_t X_coord = chip8->V[inst->X] & (width - 1);
+    const uint8_t Y_coord = chip8->V[inst->Y] & (height - 1);
+    const bool big = inst->N == 0;
+    const uint8_t sprite_rows = big ? 16 : inst->N;
+    const uint8_t rows = wrap || sprite_rows < height - Y_coord ? sprite_rows : height - Y_coord;
+
+    uint64_t collision = 0;
+    uint16_t address = chip8->I;
+    for (uint8_t plane = 0; plane < CHIP8_PLANES; plane++){
+        if (!((chip8->planes >> plane) & 1)) continue;
+        for (uint8_t i = 0; i < rows; i++){
+            // MSB is the leftmost pixel, 2 bytes per row for 16x16
+            const uint64_t sprite = big ? (uint64_t)((chip8->ram[address + 2*i] << 8) | chip8->ram[address + 2*i + 1]) << 48
+                                        : (uint64_t)chip8->ram[address + i] << 56;
+            const uint8_t y = wrap ? (Y_coord + i) & (height - 1) : Y_coord + i;
+            collision |= draw_row(chip8, chip8->display[plane][y], y, sprite, X_coord, hires, wrap);
+        }
+        address += big ? 32 : sprite_rows;
+    }
+
+    chip8->V[0xF] = collision != 0;
+}
+
+// Draw N height sprite (DXY0: 16x16) at VX,VY from I, clipped at the right/bottom edges or wrapped around
+//  them. The starting position always wraps
+static ALWAYS_INLINE void draw_sprite(chip8_t *chip8, const instruction_t *inst, const bool wrap){
+    if (!chip8->hires && chip8->planes == 1 && inst->N) draw_sprite_lores(chip8, inst, wrap);
+    else draw_sprite_planes(chip8, inst, wrap);
+}
+
+// 0xDXYN: Draw N height sprite at coordinates X,Y; read from mem location I;
+//  see draw_sprite for the packed row XOR and clipping
+static inline void op_DXYN(chip8_t *chip8, const instruction_t *inst){
+    draw_sprite(chip8, inst, false);
+}
+
+// 0xDXYN (QUIRK_SPRITE_WRAP): same, but the sprite wraps around the edges
+static inline void op_DXYN_wrap(chip8_t *chip8, const instruction_t *inst){
+    draw_sprite(chip8, inst, true);
+}
+
+// 0xEX9E: skip next instruction if key in VX is pressed
+static inline void op_EX9E(chip8_t *chip8, const instruction_t *inst){
+    if (chip8->keypad[chip8->V[inst->X]]) chip8->PC += 2;
+}
+
+// 0xEXA1: skip next instruction if key in VX is not pressed
+static inline void op_EXA1(chip8_t *chip8, const instruction_t *inst){
+    if (!chip8->keypad[chip8->V[inst->X]]) chip8->PC += 2;
+}
+
+// 0xFN01 (XO-CHIP): select the planes N (bitmap) that drawing, clearing and scrolling work on
+static inline void op_FN01(chip8_t *chip8, const instruction_t *inst){
+    chip8->planes = inst->X & ((1u << CHIP8_PLANES) - 1);
+}
+
+// 0xFX07: set VX to the value of delay timer
+static inline void op_FX07(chip8_t *chip8, const instruction_t *inst){
+    chip8->V[inst->X] = chip8->delay_timer;
+}
+
+// 0xFX0A: VX = getkey(); Await until a keypress, and store in VX
+static inline void op_FX0A(chip8_t *chip8, const instruction_t *inst){
+    for (uint8_t i = 0; i < sizeof chip8->keypad; i++){
+        if (chip8->keypad[i]){
+            chip8->V[inst->X] = i; // i = key (offset into keypad array)
+            return;
+        }
+    }
+    // no key pressed, run this instruction again
+    chip8->PC -= 2;
+}
+
+// 0xFX15: set delay timer to value of VX
+static inline void op_FX15(chip8_t *chip8, const instruction_t *inst){
+    chip8->delay_timer = chip8->V[inst->X];
+}
+
+// 0xFX18: set sound timer to value of VX
+static inline void op_FX18(chip8_t *chip8, const instruction_t *inst){
+    chip8->sound_timer = chip8->V[inst->X];
+}
+
+// 0xFX1E: I += VX; does not affect VF
+static inline void op_FX1E(chip8_t *chip8, const instruction_t *inst){
+    chip8->I += chip8->V[inst->X];
+}
+
+// 0xFX29: set register I to sprite location in memory for character in VX (0x0-0xF)
+static inline void op_FX29(chip8_t *chip8, const instruction_t *inst){
+    chip8->I = chip8->V[inst->X] * 5;
+}
+
+// 0xFX30 (SUPER-CHIP): set register I to the big font sprite (8x10) for the digit in VX
+static inline void op_FX30(chip8_t *chip8, const instruction_t *inst){
+    chip8->I = CHIP8_BIG_FONT + (chip8->V[inst->X] & 0xF) * 10;
+}
+
+// 0xFX33: Store BCD representation of VX at I (hundreds), I+1 (tens), I+2 (ones)
+static inline void op_FX33(chip8_t *chip8, const instruction_t *inst){
+    uint8_t bcd = chip8->V[inst->X];
+    chip8->ram[chip8->I + 2] = bcd % 10;
+    bcd /= 10;
+    chip8->ram[chip8->I + 1] = bcd % 10;
+    bcd /= 10;
+    chip8->ram[chip8->I] = bcd;
+}
+
+// 0xFX55: Register dump V0-VX inclusive to memory offset from I, I is not incremented
+static inline void op_FX55(chip8_t *chip8, const instruction_t *inst){
+    for (uint8_t i = 0; i <= inst->X; i++) chip8->ram[chip8->I + i] = chip8->V[i];
+}
+
+// 0xFX55 (QUIRK_INCREMENT_I): same, then I points past the last register stored
+static inline void op_FX55_inc(chip8_t *chip8, const instruction_t *inst){
+    op_FX55(chip8, inst);
+    chip8->I += inst->X + 1;
+}
+
+// 0xFX65: Register load V0-VX inclusive from memory offset from I, I is not incremented
+static inline void op_FX65(chip8_t *chip8, const instruction_t *inst){
+    for (uint8_t i = 0; i <= inst->X; i++) chip8->V[i] = chip8->ram[chip8->I + i];
+}
+
+// 0xFX65 (QUIRK_INCREMENT_I): same, then I points past the last register loaded
+static inline void op_FX65_inc(chip8_t *chip8, const instruction_t *inst){
+    op_FX65(chip8, inst);
+    chip8->I += inst->X + 1;
+}
+
+// 0xFX75 (SUPER-CHIP): save V0-VX inclusive to the user flags
+static inline void op_FX75(chip8_t *chip8, const instruction_t *inst){
+    memcpy(chip8->flags, chip8->V, inst->X + 1);
+}
+
+// 0xFX85 (SUPER-CHIP): load V0-VX inclusive from the user flags
+static inline void op_FX85(chip8_t *chip8, const instruction_t *inst){
+    memcpy(chip8->V, chip8->flags, inst->X + 1);
+}
+
+
+// Fill out instruction format fields from a raw opcode
+static inline instruction_t decode_instruction(const uint16_t opcode){
+    return (instruction_t){
+        .opcode = opcode,
+        .NNN = opcode & 0x0FFF,
+        .NN = opcode & 0x0FF,
+        .N = opcode & 0x0F,
+        .X = (opcode >> 8) & 0x0F,
+        .Y = (opcode >> 4) & 0x0F,
+    };
+}
+
+// Find the handler for an opcode under a quirk profile, same decoding rules as the emulate_instruction switch
+static inline op_handler_t lookup_handler(const uint16_t opcode, const quirks_t quirks){
+    const uint8_t NN = opcode & 0xFF;
+
+    switch (opcode >> 12){
+        case 0x0:
+            if (NN == 0xE0) return op_00E0;
+            if (NN == 0xEE) return op_00EE;
+            if ((opcode & 0x0FF0) == 0x00C0) return op_00CN;
+            if ((opcode & 0x0FF0) == 0x00D0) return op_00DN;
+            switch (opcode & 0x0FFF){
+                case 0x0FB: return op_00FB;
+                case 0x0FC: return op_00FC;
+                case 0x0FD: return op_00FD;
+                case 0x0FE: return op_00FE;
+                case 0x0FF: return op_00FF;
+                default:    return op_nop;
+            }
+        case 0x1: return op_1NNN;
+        case 0x2: return op_2NNN;
+        case 0x3: return op_3XNN;
+        case 0x4: return op_4XNN;
+        case 0x5: return op_5XY0;
+        case 0x6: return op_6XNN;
+        case 0x7: return op_7XNN;
+        case 0x8:
+            switch (opcode & 0x0F){
+                case 0x0: return op_8XY0;
+                case 0x1: return op_8XY1;
+                case 0x2: return op_8XY2;
+                case 0x3: return op_8XY3;
+                case 0x4: return op_8XY4;
+                case 0x5: return op_8XY5;
+                case 0x6: return QUIRK_SHIFT_VY(quirks) ? op_8XY6_vy : op_8XY6;
+                case 0x7: return op_8XY7;
+                case 0xE: return QUIRK_SHIFT_VY(quirks) ? op_8XYE_vy : op_8XYE;
+                default:  return op_nop;
+            }
+        case 0x9: return op_9XY0;
+        case 0xA: return op_ANNN;
+        case 0xB: return QUIRK_JUMP_VX(quirks) ? op_BXNN : op_BNNN;
+        case 0xC: return op_CXNN;
+        case 0xD: return QUIRK_SPRITE_WRAP(quirks) ? op_DXYN_wrap : op_DXYN;
+        case 0xE:
+            if (NN == 0x9E) return op_EX9E;
+            if (NN == 0xA1) return op_EXA1;
+            return op_nop;
+        default: // 0xF
+            switch (NN){
+                case 0x01: return op_FN01;
+                case 0x07: return op_FX07;
+                case 0x0A: return op_FX0A;
+                case 0x15: return op_FX15;
+                case 0x18: return op_FX18;
+                case 0x1E: return op_FX1E;
+                case 0x29: return op_FX29;
+                case 0x30: return op_FX30;
+                case 0x33: return op_FX33;
+                case 0x55: return QUIRK_INCREMENT_I(quirks) ? op_FX55_inc : op_FX55;
+                case 0x65: return QUIRK_INCREMENT_I(quirks) ? op_FX65_inc : op_FX65;
+                case 0x75: return op_FX75;
+                case 0x85: return op_FX85;
+                default:   return op_nop;
+            }
+    }
+}
+
+// Number of RAM bytes from I an opcode writes (FX33/FX55), 0 for everything else
+static inline uint8_t ram_write_length(const uint16_t opcode){
+    if ((opcode & 0xF0FF) == 0xF033) return 3;
+    if ((opcode & 0xF0FF) == 0xF055) return ((opcode >> 8) & 0x0F) + 1;
+    return 0;
+}
+
+#endif // CHIP8_OPS_H
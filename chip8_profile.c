@@ -0,0 +1,131 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#include "chip8_profile.h"
+
+/* Profile counters
+    Opcodes are counted by their pattern (e.g all 8XY4 together): key is family * 256 + sub, where sub is
+    NN for the 0/E/F families, N for the 8 family and 0 for the rest.
+    Each thread gets its own counters on first use, pushed onto a lock-free list so the exit dump can sum them.
+*/
+
+#define PROFILE_TOP_PCS 20  // hottest addresses to print
+
+typedef struct profile profile_t;
+struct profile {
+    uint64_t counts[16 * 256];
+    uint64_t ticks[16 * 256];
+    uint64_t pc_hits[4096];
+    profile_t *next;
+};
+
+static _Atomic(profile_t *) profiles;
+static _Thread_local profile_t *profile;
+
+static void dump_profile(void);
+
+
+// Pattern key of an opcode
+static uint16_t opcode_key(const uint16_t opcode){
+    const uint8_t family = opcode >> 12;
+    uint8_t sub = 0;
+    if (family == 0x0 || family == 0xE || family == 0xF) sub = opcode & 0xFF;
+    else if (family == 0x8) sub = opcode & 0xF;
+    return family * 256 + sub;
+}
+
+// Opcode pattern name of a key, e.g "8XY4", "FX33", "DXYN"
+static void key_name(const uint16_t key, char name[5]){
+    static const char *const patterns[16] = {
+        "0???", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+        "8XY?", "9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX??", "FX??",
+    };
+    const uint8_t family = key >> 8, sub = key & 0xFF;
+    snprintf(name, 5, "%s", patterns[family]);
+    if (family == 0x0) snprintf(name, 5, "00%02X", sub);
+    else if (family == 0x8) name[3] = "0123456789ABCDEF"[sub];
+    else if (family == 0xE || family == 0xF) snprintf(name, 5, "%XX%02X", family, sub);
+}
+
+// Record 1 executed instruction
+void profile_instruction(const uint16_t pc, const uint16_t opcode, const uint64_t ticks){
+    if (!profile){
+        profile = calloc(1, sizeof *profile);
+        if (!profile){
+            fprintf(stderr, "Out of memory for profile counters\n");
+            exit(EXIT_FAILURE);
+        }
+
+        // first thread in sets up the dump
+        profile_t *head = atomic_load(&profiles);
+        if (!head) atexit(dump_profile);
+        do profile->next = head; while (!atomic_compare_exchange_weak(&profiles, &head, profile));
+    }
+
+    const uint16_t key = opcode_key(opcode);
+    profile->counts[key]++;
+    profile->ticks[key] += ticks;
+    profile->pc_hits[pc & 0xFFF]++;
+}
+
+static int compare_desc(const void *a, const void *b){
+    const uint64_t x = **(const uint64_t *const *)a, y = **(const uint64_t *const *)b;
+    return (x < y) - (x > y);
+}
+
+// Sum every thread's counters and print them, busiest first
+static void dump_profile(void){
+    static profile_t total;
+    for (profile_t *p = atomic_load(&profiles); p; p = p->next){
+        for (uint32_t i = 0; i < 16 * 256; i++){
+            total.counts[i] += p->counts[i];
+            total.ticks[i] += p->ticks[i];
+        }
+        for (uint32_t i = 0; i < 4096; i++) total.pc_hits[i] += p->pc_hits[i];
+    }
+
+    uint64_t instructions = 0, ticks = 0;
+    for (uint32_t i = 0; i < 16 * 256; i++){
+        instructions += total.counts[i];
+        ticks += total.ticks[i];
+    }
+    if (instructions == 0) return;
+
+#if defined(__x86_64__) || defined(__i386__)
+    const char *unit = "TSC ticks";
+#else
+    const char *unit = "ns";
+#endif
+
+    // sort pointers to the counters so the index (key/address) can be recovered from the pointer
+    static const uint64_t *order[4096];
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < 16 * 256; i++) if (total.counts[i]) order[used++] = &total.counts[i];
+    qsort(order, used, sizeof order[0], compare_desc);
+
+    fprintf(stderr, "\nProfile: %llu instructions, %llu %s\n", (unsigned long long)instructions,
+            (unsigned long long)ticks, unit);
+    fprintf(stderr, "%-6s %14s %7s %16s %10s %7s\n", "opcode", "count", "count%", unit, "per inst", "time%");
+    for (uint32_t i = 0; i < used; i++){
+        const uint16_t key = order[i] - total.counts;
+        char name[5];
+        key_name(key, name);
+        fprintf(stderr, "%-6s %14llu %6.2f%% %16llu %10.1f %6.2f%%\n", name, (unsigned long long)total.counts[key],
+                100.0 * total.counts[key] / instructions, (unsigned long long)total.ticks[key],
+                (double)total.ticks[key] / total.counts[key], ticks ? 100.0 * total.ticks[key] / ticks : 0.0);
+    }
+
+    used = 0;
+    for (uint32_t i = 0; i < 4096; i++) if (total.pc_hits[i]) order[used++] = &total.pc_hits[i];
+    qsort(order, used, sizeof order[0], compare_desc);
+
+    fprintf(stderr, "\nHottest PCs (%u addresses executed):\n%-6s %14s %7s\n", used, "PC", "count", "count%");
+    for (uint32_t i = 0; i < used && i < PROFILE_TOP_PCS; i++){
+        const uint16_t pc = order[i] - total.pc_hits;
+        fprintf(stderr, "0x%03X  %14llu %6.2f%%\n", pc, (unsigned long long)total.pc_hits[pc],
+                100.0 * total.pc_hits[pc] / instructions);
+    }
+}
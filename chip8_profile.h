@@ -0,0 +1,47 @@
+#ifndef CHIP8_PROFILE_H
+#define CHIP8_PROFILE_H
+
+/* Opt-in profiling (make PROFILE=1)
+    Counts every instruction emulate_instruction runs per opcode, with the host time it took, plus a hit count
+    per PC address, and prints the lot to stderr on exit. Counters are per thread so the batch runner doesn't
+    fight over them. Without CHIP8_PROFILE the macros are empty and nothing here is compiled in.
+    Internal to the core, not part of the public chip8.h API.
+*/
+
+#ifdef CHIP8_PROFILE
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+// Host timestamp: TSC ticks on x86 (a few cycles to read), nanoseconds elsewhere
+static inline uint64_t profile_ticks(void){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+// Record 1 executed instruction
+void profile_instruction(const uint16_t pc, const uint16_t opcode, const uint64_t ticks);
+
+#define PROFILE_START(chip8) \
+    const uint64_t profile_start_ = profile_ticks(); \
+    const uint16_t profile_pc_ = (chip8)->PC
+#define PROFILE_END(chip8) profile_instruction(profile_pc_, (chip8)->inst.opcode, profile_ticks() - profile_start_)
+
+#else
+
+#define PROFILE_START(chip8)
+#define PROFILE_END(chip8)
+
+#endif // CHIP8_PROFILE
+
+#endif // CHIP8_PROFILE_H
@@ -0,0 +1,204 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+
+/* Rewind buffer
+    Every REWIND_KEYFRAME_INTERVAL pushes a full snapshot (keyframe) is stored, in between each frame is stored as
+    a delta: the snapshot XORed with the keyframe, run length encoded as (unchanged bytes, changed bytes, XORed bytes...)
+    runs. RAM and the display barely change between frames so most deltas are a few dozen bytes.
+    Entries go in a byte ring with the oldest keyframe (and the deltas that need it) dropped whenever space runs out.
+*/
+
+#define REWIND_KEYFRAME_INTERVAL 60     // 1 keyframe per second at 60 pushes a second
+#define REWIND_MIN_LITERAL_GAP 4        // unchanged bytes needed to end a literal run, shorter gaps are cheaper inline
+#define SNAPSHOT_SIZE (sizeof(chip8_snapshot_t))
+
+// Every delta holds at least 1 (skip, literal) run header, entries are never empty
+#define RUN_HEADER_SIZE 4
+
+
+// Encode cur as a delta against base into out, returns bytes written or 0 if it would be bigger than a keyframe
+static uint32_t encode_delta(const uint8_t *base, const uint8_t *cur, uint8_t *out){
+    uint32_t pos = 0, size = 0;
+
+    while (pos < SNAPSHOT_SIZE){
+        // unchanged bytes
+        uint32_t skip = 0;
+        while (pos + skip < SNAPSHOT_SIZE && skip < UINT16_MAX && base[pos + skip] == cur[pos + skip]) skip++;
+        pos += skip;
+
+        // changed bytes, up to the next real run of unchanged ones
+        uint32_t literal = 0, gap = 0;
+        while (pos + literal + gap < SNAPSHOT_SIZE && literal + gap < UINT16_MAX){
+            if (base[pos + literal + gap] == cur[pos + literal + gap]){
+                if (++gap == REWIND_MIN_LITERAL_GAP) break;
+            }else{
+                literal += gap + 1;
+                gap = 0;
+            }
+        }
+
+        if (size + RUN_HEADER_SIZE + literal >= SNAPSHOT_SIZE) return 0;
+        out[size++] = skip & 0xFF;
+        out[size++] = skip >> 8;
+        out[size++] = literal & 0xFF;
+        out[size++] = literal >> 8;
+        for (uint32_t i = 0; i < literal; i++) out[size++] = base[pos + i] ^ cur[pos + i];
+        pos += literal;
+    }
+
+    if (size == 0){
+        // nothing changed at all, 1 empty run
+        memset(out, 0, RUN_HEADER_SIZE);
+        size = RUN_HEADER_SIZE;
+    }
+    return size;
+}
+
+// Apply a delta to base (a copy of its keyframe)
+static void decode_delta(uint8_t *base, const uint8_t *delta, const uint32_t size){
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i + RUN_HEADER_SIZE <= size; ){
+        pos += delta[i] | (delta[i+1] << 8);
+        const uint32_t literal = delta[i+2] | (delta[i+3] << 8);
+        i += RUN_HEADER_SIZE;
+        for (uint32_t j = 0; j < literal; j++) base[pos++] ^= delta[i++];
+    }
+}
+
+
+// Index of the entry n places after the oldest
+static uint32_t entry_index(const chip8_rewind_t *rewind, const uint32_t n){
+    return (rewind->first + n) % rewind->max_entries;
+}
+
+// Drop the oldest keyframe and every delta depending on it
+static void drop_oldest(chip8_rewind_t *rewind){
+    do {
+        rewind->first = entry_index(rewind, 1);
+        rewind->count--;
+    } while (rewind->count && !rewind->entries[rewind->first].keyframe);
+}
+
+// Find room for size bytes, dropping old entries as needed; returns the offset to write at
+static uint32_t reserve(chip8_rewind_t *rewind, const uint32_t size){
+    for (;;){
+        if (rewind->count == 0) return 0;
+        if (rewind->count == rewind->max_entries){
+            drop_oldest(rewind);
+            continue;
+        }
+
+        const uint32_t tail = rewind->entries[rewind->first].offset;
+        const rewind_entry_t *newest = &rewind->entries[entry_index(rewind, rewind->count - 1)];
+        const uint32_t head = newest->offset + newest->size;
+
+        if (newest->offset >= tail){
+            // live data is 1 contiguous span, free space is after it and before it
+            if (head + size <= rewind->capacity) return head;
+            if (size <= tail) return 0;
+        }else{
+            // live data wraps around the end of the buffer, free space is the gap in the middle
+            if (head + size <= tail) return head;
+        }
+        drop_oldest(rewind);
+    }
+}
+
+// Append an entry at offset (from reserve)
+static void add_entry(chip8_rewind_t *rewind, const uint32_t offset, const uint8_t *bytes, const uint32_t size,
+                      const bool keyframe){
+    memcpy(&rewind->data[offset], bytes, size);
+    rewind->entries[entry_index(rewind, rewind->count++)] = (rewind_entry_t){
+        .offset = offset,
+        .size = size,
+        .keyframe = keyframe,
+    };
+}
+
+
+// Allocate a rewind buffer using about budget_bytes of memory in total
+bool init_rewind(chip8_rewind_t *rewind, const uint32_t budget_bytes){
+    // entries are bookkeeping inside the budget, sized for deltas of around 32 bytes on average
+    const uint32_t max_entries = budget_bytes / (32 + sizeof(rewind_entry_t));
+
+    *rewind = (chip8_rewind_t){0};
+    if (max_entries < 2 || budget_bytes - max_entries * sizeof(rewind_entry_t) < SNAPSHOT_SIZE * 2){
+        return false; // too small for a keyframe and then some
+    }
+
+    rewind->max_entries = max_entries;
+    rewind->capacity = budget_bytes - max_entries * sizeof(rewind_entry_t);
+    rewind->data = malloc(rewind->capacity);
+    rewind->entries = malloc(max_entries * sizeof *rewind->entries);
+    if (!rewind->data || !rewind->entries){
+        free_rewind(rewind);
+        return false;
+    }
+    return true;
+}
+
+// Free a rewind buffer
+void free_rewind(chip8_rewind_t *rewind){
+    free(rewind->data);
+    free(rewind->entries);
+    *rewind = (chip8_rewind_t){0};
+}
+
+// Record the current machine state
+void push_rewind(chip8_rewind_t *rewind, const chip8_t *chip8){
+    chip8_snapshot_t snapshot;
+    save_snapshot(chip8, &snapshot);
+
+    // delta against the newest keyframe if there is one to go against
+    if (rewind->count && rewind->since_keyframe < REWIND_KEYFRAME_INTERVAL){
+        uint8_t delta[SNAPSHOT_SIZE];
+        const uint32_t size = encode_delta((const uint8_t *)&rewind->keyframe, (const uint8_t *)&snapshot, delta);
+
+        // the keyframe may get dropped making room, in which case fall through and start a new one
+        if (size){
+            const uint32_t offset = reserve(rewind, size);
+            if (rewind->count){
+                add_entry(rewind, offset, delta, size, false);
+                rewind->since_keyframe++;
+                return;
+            }
+        }
+    }
+
+    add_entry(rewind, reserve(rewind, SNAPSHOT_SIZE), (const uint8_t *)&snapshot, SNAPSHOT_SIZE, true);
+    rewind->keyframe = snapshot;
+    rewind->since_keyframe = 0;
+}
+
+// Step back 1 push: drop the newest state (where the machine is now) and restore the one before it
+bool pop_rewind(chip8_rewind_t *rewind, chip8_t *chip8){
+    if (rewind->count < 2) return false;
+
+    // drop the newest entry
+    const bool dropped_keyframe = rewind->entries[entry_index(rewind, --rewind->count)].keyframe;
+    if (dropped_keyframe){
+        // entries before it are against the previous keyframe, the oldest entry is always a keyframe
+        for (uint32_t n = rewind->count; n-- > 0; ){
+            const rewind_entry_t *previous = &rewind->entries[entry_index(rewind, n)];
+            if (previous->keyframe){
+                memcpy(&rewind->keyframe, &rewind->data[previous->offset], SNAPSHOT_SIZE);
+                break;
+            }
+        }
+        // start a new keyframe on the next push rather than adding to an old second
+        rewind->since_keyframe = REWIND_KEYFRAME_INTERVAL;
+    }
+
+    // restore the entry before it, which stays in the buffer as the newest
+    const rewind_entry_t *entry = &rewind->entries[entry_index(rewind, rewind->count - 1)];
+    chip8_snapshot_t snapshot;
+    if (entry->keyframe){
+        memcpy(&snapshot, &rewind->data[entry->offset], SNAPSHOT_SIZE);
+    }else{
+        snapshot = rewind->keyframe;
+        decode_delta((uint8_t *)&snapshot, &rewind->data[entry->offset], entry->size);
+    }
+    return load_snapshot(chip8, &snapshot);
+}
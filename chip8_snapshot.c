@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "chip8.h"
+
+/* Save states
+    A snapshot is plain old data, so saving/restoring is a handful of memcpys (well under a microsecond)
+    and writing one to disk is a single fwrite of the struct. The stack pointer is stored as an index
+    so a snapshot can be restored into any chip8_t, not just the one it came from.
+*/
+
+// layout is the file format, catch accidental padding/size changes at compile time
+_Static_assert(sizeof(chip8_snapshot_t) == 4 + 4 + 8 + 8 + 8 + 8 * CHIP8_PLANES * CHIP8_HIRES_HEIGHT * CHIP8_ROW_WORDS +
+               2 * 12 + 2 + 2 + 4096 + 16 + 16 + 16 + 5 + 7,
+               "chip8_snapshot_t has padding, it is written to disk as is");
+
+
+// Copy machine state into an in-memory snapshot
+void save_snapshot(const chip8_t *chip8, chip8_snapshot_t *snapshot){
+    snapshot->magic = CHIP8_SNAPSHOT_MAGIC;
+    snapshot->version = CHIP8_SNAPSHOT_VERSION;
+    snapshot->cycles = chip8->cycles;
+    snapshot->timer_ticks = chip8->timer_ticks;
+    snapshot->rng_state = chip8->rng_state;
+    memcpy(snapshot->display, chip8->display, sizeof snapshot->display);
+    memcpy(snapshot->stack, chip8->stack, sizeof snapshot->stack);
+    snapshot->I = chip8->I;
+    snapshot->PC = chip8->PC;
+    memcpy(snapshot->ram, chip8->ram, sizeof snapshot->ram);
+    memcpy(snapshot->V, chip8->V, sizeof snapshot->V);
+    for (uint8_t i = 0; i < sizeof snapshot->keypad; i++) snapshot->keypad[i] = chip8->keypad[i];
+    memcpy(snapshot->flags, chip8->flags, sizeof snapshot->flags);
+    snapshot->stack_index = chip8->stack_ptr - chip8->stack;
+    snapshot->delay_timer = chip8->delay_timer;
+    snapshot->sound_timer = chip8->sound_timer;
+    snapshot->hires = chip8->hires;
+    snapshot->planes = chip8->planes;
+    memset(snapshot->reserved, 0, sizeof snapshot->reserved);
+}
+
+// Restore machine state from a snapshot, false if it isn't a valid snapshot of this version
+bool load_snapshot(chip8_t *chip8, const chip8_snapshot_t *snapshot){
+    if (snapshot->magic != CHIP8_SNAPSHOT_MAGIC){
+        fprintf(stderr, "Not a CHIP8 snapshot\n");
+        return false;
+    }
+    if (snapshot->version != CHIP8_SNAPSHOT_VERSION){
+        fprintf(stderr, "Unsupported snapshot version %u, expected %u\n", snapshot->version, CHIP8_SNAPSHOT_VERSION);
+        return false;
+    }
+    if (snapshot->stack_index > sizeof chip8->stack / sizeof chip8->stack[0]){
+        fprintf(stderr, "Snapshot stack index %u is out of range\n", snapshot->stack_index);
+        return false;
+    }
+
+    chip8->cycles = snapshot->cycles;
+    chip8->timer_ticks = snapshot->timer_ticks;
+    chip8->rng_state = snapshot->rng_state ? snapshot->rng_state : 1;
+    memcpy(chip8->display, snapshot->display, sizeof chip8->display);
+    memcpy(chip8->stack, snapshot->stack, sizeof chip8->stack);
+    chip8->I = snapshot->I;
+    chip8->PC = snapshot->PC;
+    memcpy(chip8->ram, snapshot->ram, sizeof chip8->ram);
+    memcpy(chip8->V, snapshot->V, sizeof chip8->V);
+    for (uint8_t i = 0; i < sizeof chip8->keypad; i++) chip8->keypad[i] = snapshot->keypad[i] != 0;
+    memcpy(chip8->flags, snapshot->flags, sizeof chip8->flags);
+    chip8->stack_ptr = &chip8->stack[snapshot->stack_index];
+    chip8->delay_timer = snapshot->delay_timer;
+    chip8->sound_timer = snapshot->sound_timer;
+    chip8->hires = snapshot->hires != 0;
+    chip8->planes = snapshot->planes & ((1u << CHIP8_PLANES) - 1);
+    chip8->dirty_rows = DIRTY_ALL_ROWS; // whole display may have changed
+    return true;
+}
+
+// Save a snapshot to a file
+bool save_snapshot_file(const chip8_t *chip8, const char *path){
+    chip8_snapshot_t snapshot;
+    save_snapshot(chip8, &snapshot);
+
+    FILE *file = fopen(path, "wb");
+    if (!file){
+        fprintf(stderr, "Could not open snapshot file %s for writing\n", path);
+        return false;
+    }
+
+    const bool ok = fwrite(&snapshot, sizeof snapshot, 1, file) == 1;
+    if (fclose(file) != 0 || !ok){
+        fprintf(stderr, "Could not write snapshot file %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Load a snapshot from a file
+bool load_snapshot_file(chip8_t *chip8, const char *path){
+    FILE *file = fopen(path, "rb");
+    if (!file){
+        fprintf(stderr, "Snapshot file %s is invalid or does not exist\n", path);
+        return false;
+    }
+
+    chip8_snapshot_t snapshot;
+    const bool ok = fread(&snapshot, sizeof snapshot, 1, file) == 1;
+    fclose(file);
+    if (!ok){
+        fprintf(stderr, "Could not read snapshot file %s\n", path);
+        return false;
+    }
+    return load_snapshot(chip8, &snapshot);
+}
@@ -0,0 +1,163 @@
+#include <stdint.h>
+
+#include "chip8.h"
+#include "chip8_ops.h"
+
+/* Alternative dispatch engine for running many instructions back to back
+    Built with CHIP8_THREADED_DISPATCH (make DISPATCH=threaded): a 64K entry table maps every possible
+    opcode straight to its handler, and with GCC each handler jumps directly to the next one through a
+    computed goto ("threaded code") instead of returning to a central switch.
+    Without the flag run_instructions runs the reference switch in a loop, so the two can be benchmarked
+    against each other. Each quirk profile has its own opcode table, picked once per call.
+    DEBUG and PROFILE builds always use the reference switch, it's where every instruction gets traced/counted.
+*/
+
+#if defined(CHIP8_THREADED_DISPATCH) && !defined(DEBUG) && !defined(CHIP8_PROFILE)
+
+// every handler lookup_handler can return, position in this array is the opcode's index in op_index
+static const op_handler_t handlers[] = {
+    op_nop, op_00E0, op_00EE, op_1NNN, op_2NNN, op_3XNN, op_4XNN, op_5XY0, op_6XNN, op_7XNN,
+    op_8XY0, op_8XY1, op_8XY2, op_8XY3, op_8XY4, op_8XY5, op_8XY6, op_8XY7, op_8XYE,
+    op_9XY0, op_ANNN, op_BNNN, op_CXNN, op_DXYN, op_EX9E, op_EXA1,
+    op_FX07, op_FX0A, op_FX15, op_FX18, op_FX1E, op_FX29, op_FX33, op_FX55, op_FX65,
+    op_8XY6_vy, op_8XYE_vy, op_BXNN, op_DXYN_wrap, op_FX55_inc, op_FX65_inc, // quirk variants
+    op_00CN, op_00DN, op_00FB, op_00FC, op_00FD, op_00FE, op_00FF, op_FN01, op_FX30, op_FX75, op_FX85, // SCHIP/XO-CHIP
+};
+
+// handler index for all 65536 opcodes, per quirk profile
+static uint8_t op_index[QUIRKS_COUNT][0x10000];
+
+// Fill out op_index from the same decoding rules as everything else, runs once when the program starts
+#ifdef __GNUC__
+__attribute__((constructor))
+#endif
+static void init_op_index(void){
+    for (uint32_t quirks = 0; quirks < QUIRKS_COUNT; quirks++){
+        for (uint32_t opcode = 0; opcode < 0x10000; opcode++){
+            const op_handler_t handler = lookup_handler(opcode, quirks);
+            for (uint8_t i = 0; i < sizeof handlers / sizeof handlers[0]; i++){
+                if (handlers[i] == handler){
+                    op_index[quirks][opcode] = i;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+#ifdef __GNUC__
+
+// Run count instructions, each handler dispatches straight to the next
+void run_instructions(chip8_t *chip8, uint32_t count){
+    // same order as handlers[]
+    static void *const labels[] = {
+        &&nop, &&do_00E0, &&do_00EE, &&do_1NNN, &&do_2NNN, &&do_3XNN, &&do_4XNN, &&do_5XY0, &&do_6XNN, &&do_7XNN,
+        &&do_8XY0, &&do_8XY1, &&do_8XY2, &&do_8XY3, &&do_8XY4, &&do_8XY5, &&do_8XY6, &&do_8XY7, &&do_8XYE,
+        &&do_9XY0, &&do_ANNN, &&do_BNNN, &&do_CXNN, &&do_DXYN, &&do_EX9E, &&do_EXA1,
+        &&do_FX07, &&do_FX0A, &&do_FX15, &&do_FX18, &&do_FX1E, &&do_FX29, &&do_FX33, &&do_FX55, &&do_FX65,
+        &&do_8XY6_vy, &&do_8XYE_vy, &&do_BXNN, &&do_DXYN_wrap, &&do_FX55_inc, &&do_FX65_inc,
+        &&do_00CN, &&do_00DN, &&do_00FB, &&do_00FC, &&do_00FD, &&do_00FE, &&do_00FF,
+        &&do_FN01, &&do_FX30, &&do_FX75, &&do_FX85,
+    };
+    _Static_assert(sizeof labels / sizeof labels[0] == sizeof handlers / sizeof handlers[0],
+                   "labels[] and handlers[] must line up");
+
+    const uint8_t *index = op_index[chip8->quirks < QUIRKS_COUNT ? chip8->quirks : QUIRKS_DEFAULT];
+    instruction_t inst;
+
+    // fetch/decode next instruction and jump to its handler, or leave once count instructions have run
+    #define DISPATCH() do { \
+        if (count-- == 0) return; \
+        const uint16_t opcode = (chip8->ram[chip8->PC] << 8) | chip8->ram[chip8->PC+1]; \
+        chip8->PC += 2; \
+        inst = decode_instruction(opcode); \
+        goto *labels[index[opcode]]; \
+    } while (0)
+
+    DISPATCH();
+
+    nop:     DISPATCH();
+    do_00E0: op_00E0(chip8, &inst); DISPATCH();
+    do_00EE: op_00EE(chip8, &inst); DISPATCH();
+    do_1NNN: op_1NNN(chip8, &inst); DISPATCH();
+    do_2NNN: op_2NNN(chip8, &inst); DISPATCH();
+    do_3XNN: op_3XNN(chip8, &inst); DISPATCH();
+    do_4XNN: op_4XNN(chip8, &inst); DISPATCH();
+    do_5XY0: op_5XY0(chip8, &inst); DISPATCH();
+    do_6XNN: op_6XNN(chip8, &inst); DISPATCH();
+    do_7XNN: op_7XNN(chip8, &inst); DISPATCH();
+    do_8XY0: op_8XY0(chip8, &inst); DISPATCH();
+    do_8XY1: op_8XY1(chip8, &inst); DISPATCH();
+    do_8XY2: op_8XY2(chip8, &inst); DISPATCH();
+    do_8XY3: op_8XY3(chip8, &inst); DISPATCH();
+    do_8XY4: op_8XY4(chip8, &inst); DISPATCH();
+    do_8XY5: op_8XY5(chip8, &inst); DISPATCH();
+    do_8XY6: op_8XY6(chip8, &inst); DISPATCH();
+    do_8XY7: op_8XY7(chip8, &inst); DISPATCH();
+    do_8XYE: op_8XYE(chip8, &inst); DISPATCH();
+    do_9XY0: op_9XY0(chip8, &inst); DISPATCH();
+    do_ANNN: op_ANNN(chip8, &inst); DISPATCH();
+    do_BNNN: op_BNNN(chip8, &inst); DISPATCH();
+    do_CXNN: op_CXNN(chip8, &inst); DISPATCH();
+    do_DXYN: op_DXYN(chip8, &inst); DISPATCH();
+    do_EX9E: op_EX9E(chip8, &inst); DISPATCH();
+    do_EXA1: op_EXA1(chip8, &inst); DISPATCH();
+    do_FX07: op_FX07(chip8, &inst); DISPATCH();
+    do_FX0A: op_FX0A(chip8, &inst); DISPATCH();
+    do_FX15: op_FX15(chip8, &inst); DISPATCH();
+    do_FX18: op_FX18(chip8, &inst); DISPATCH();
+    do_FX1E: op_FX1E(chip8, &inst); DISPATCH();
+    do_FX29: op_FX29(chip8, &inst); DISPATCH();
+    do_FX33: op_FX33(chip8, &inst); DISPATCH();
+    do_FX55: op_FX55(chip8, &inst); DISPATCH();
+    do_FX65: op_FX65(chip8, &inst); DISPATCH();
+    do_8XY6_vy:   op_8XY6_vy(chip8, &inst); DISPATCH();
+    do_8XYE_vy:   op_8XYE_vy(chip8, &inst); DISPATCH();
+    do_BXNN:      op_BXNN(chip8, &inst); DISPATCH();
+    do_DXYN_wrap: op_DXYN_wrap(chip8, &inst); DISPATCH();
+    do_FX55_inc:  op_FX55_inc(chip8, &inst); DISPATCH();
+    do_FX65_inc:  op_FX65_inc(chip8, &inst); DISPATCH();
+    do_00CN: op_00CN(chip8, &inst); DISPATCH();
+    do_00DN: op_00DN(chip8, &inst); DISPATCH();
+    do_00FB: op_00FB(chip8, &inst); DISPATCH();
+    do_00FC: op_00FC(chip8, &inst); DISPATCH();
+    do_00FD: op_00FD(chip8, &inst); DISPATCH();
+    do_00FE: op_00FE(chip8, &inst); DISPATCH();
+    do_00FF: op_00FF(chip8, &inst); DISPATCH();
+    do_FN01: op_FN01(chip8, &inst); DISPATCH();
+    do_FX30: op_FX30(chip8, &inst); DISPATCH();
+    do_FX75: op_FX75(chip8, &inst); DISPATCH();
+    do_FX85: op_FX85(chip8, &inst); DISPATCH();
+
+    #undef DISPATCH
+}
+
+#else
+
+// Run count instructions through the function pointer table (no computed goto outside of GCC/clang)
+void run_instructions(chip8_t *chip8, uint32_t count){
+    static bool initialised = false;
+    if (!initialised){
+        init_op_index();
+        initialised = true;
+    }
+
+    const uint8_t *index = op_index[chip8->quirks < QUIRKS_COUNT ? chip8->quirks : QUIRKS_DEFAULT];
+    while (count--){
+        const uint16_t opcode = (chip8->ram[chip8->PC] << 8) | chip8->ram[chip8->PC+1];
+        chip8->PC += 2;
+        const instruction_t inst = decode_instruction(opcode);
+        handlers[index[opcode]](chip8, &inst);
+    }
+}
+
+#endif // __GNUC__
+
+#else
+
+// Run count instructions through the reference switch
+void run_instructions(chip8_t *chip8, uint32_t count){
+    run_reference(chip8, count);
+}
+
+#endif // CHIP8_THREADED_DISPATCH && !DEBUG && !CHIP8_PROFILE
@@ -0,0 +1,45 @@
+#include <stdio.h>
+
+#include "chip8.h"
+
+/* Instruction trace
+    DEBUG builds of emulate_instruction store every instruction (PC, opcode and the registers it ran with) in a
+    ring of fixed size entries attached to the machine, which costs about as much as the instruction itself.
+    Saving the ring writes a small header and the entries oldest first in native byte order, the
+    chip8-trace tool turns that back into the old one line per instruction descriptions.
+*/
+
+// entries are written to disk as is
+_Static_assert(sizeof(chip8_trace_entry_t) == 4 + 2 * 5 + 2 + 16, "chip8_trace_entry_t has padding");
+
+
+// Empty a trace ring
+void init_trace(chip8_trace_t *trace){
+    trace->count = 0;
+}
+
+// Write the entries in a trace ring to a file oldest first
+bool save_trace_file(const chip8_trace_t *trace, const char *path){
+    FILE *file = fopen(path, "wb");
+    if (!file){
+        fprintf(stderr, "Could not open trace file %s for writing\n", path);
+        return false;
+    }
+
+    // header: magic, version, entry count
+    const uint32_t header[2] = {CHIP8_TRACE_MAGIC, CHIP8_TRACE_VERSION};
+    const uint64_t count = trace->count < CHIP8_TRACE_ENTRIES ? trace->count : CHIP8_TRACE_ENTRIES;
+    bool ok = fwrite(header, sizeof header, 1, file) == 1 && fwrite(&count, sizeof count, 1, file) == 1;
+
+    // oldest entry is at the write position once the ring has wrapped, 2 runs either side of it
+    const uint32_t first = (trace->count - count) & (CHIP8_TRACE_ENTRIES - 1);
+    const uint32_t tail = count < CHIP8_TRACE_ENTRIES - first ? count : CHIP8_TRACE_ENTRIES - first;
+    if (ok && tail) ok = fwrite(&trace->entries[first], sizeof trace->entries[0], tail, file) == tail;
+    if (ok && count > tail) ok = fwrite(trace->entries, sizeof trace->entries[0], count - tail, file) == count - tail;
+
+    if (fclose(file) != 0 || !ok){
+        fprintf(stderr, "Could not write trace file %s\n", path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,509 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Engine differential tester
+    Runs a ROM on the reference switch (ENGINE_REFERENCE, no idle skipping) and on every other engine side by
+    side, with the same seed and keypad input, and compares a hash of each machine against the reference's
+    every --check-interval instructions. Each side is checkpointed (machine and engine caches) before an
+    interval, so when one disagrees the interval is replayed from the checkpoint, bisecting down to the first
+    instruction whose result differs, and that instruction is printed with every field that came out different.
+
+    --fuzz n does the same for n generated ROMs of random opcodes under every quirk profile. A ROM that
+    disagrees is written out as difftest-<seed>.ch8 so it can be rerun (and bisected) on its own.
+*/
+
+#include "chip8.h"
+
+#define DIFFTEST_DEFAULT_SECONDS 10     // emulated seconds per ROM without [instructions]/--instructions
+#define DIFFTEST_FUZZ_INSTRUCTIONS 20000
+#define DIFFTEST_FUZZ_CODE 0x700        // bytes of random opcodes, 0x200-0x8FF; 0x900 up is their data
+#define DIFFTEST_FUZZ_DATA 0x900
+
+// One machine under test, run by an engine or as a single lockstep lane
+typedef struct {
+    const char *name;
+    engine_type_t type;
+    bool lanes;                 // run_lanes instead of run_cycles
+    bool idle_skip;
+    chip8_t machine;            // engine sides, the lane's chip8_t is in lanes
+    chip8_engine_t engine;
+    chip8_lanes_t lanes_state;
+    chip8_t checkpoint;         // machine and engine as they were at the start of the current interval
+    chip8_engine_t checkpoint_engine;
+} side_t;
+
+// sides[0] is the reference everything is compared with
+static side_t sides[] = {
+    {.name = "reference", .type = ENGINE_REFERENCE},
+    {.name = "interpreter", .type = ENGINE_INTERPRETER, .idle_skip = true},
+    {.name = "predecode", .type = ENGINE_PREDECODE, .idle_skip = true},
+    {.name = "blocks", .type = ENGINE_BLOCKS, .idle_skip = true},
+    {.name = "lanes", .lanes = true},
+};
+#define SIDES (sizeof sides / sizeof sides[0])
+
+
+// xorshift64, for fuzz ROMs and keypad input. Kept apart from the machines' own random state
+static uint64_t next_random(uint64_t *state){
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// Nonzero random state from a seed
+static uint64_t random_state(const uint64_t seed){
+    return seed * 0x9E3779B97F4A7C15ull | 1;
+}
+
+// The machine a side is running, lanes are synced back into their chip8_t first
+static chip8_t *side_machine(side_t *side){
+    return side->lanes ? sync_lane(&side->lanes_state, 0) : &side->machine;
+}
+
+// Start a side on a copy of machine with empty caches
+static void start_side(side_t *side, const chip8_t *machine){
+    if (side->lanes){
+        init_lanes(&side->lanes_state, machine, 1);
+    }else{
+        clone_chip8(&side->machine, machine);
+        init_engine(&side->engine, side->type);
+    }
+}
+
+// Remember where a side is, caches and all, so an interval can be replayed exactly
+static void save_checkpoint(side_t *side){
+    clone_chip8(&side->checkpoint, side_machine(side));
+    if (!side->lanes) side->checkpoint_engine = side->engine;
+}
+
+static void restore_checkpoint(side_t *side){
+    if (side->lanes){
+        init_lanes(&side->lanes_state, &side->checkpoint, 1); // lanes keep no state outside the machines
+    }else{
+        clone_chip8(&side->machine, &side->checkpoint);
+        side->engine = side->checkpoint_engine;
+    }
+}
+
+// Hold keys (bit N = key N) from now on
+static void set_side_keys(side_t *side, const uint16_t keys){
+    chip8_t *chip8 = side->lanes ? &side->lanes_state.machines[0] : &side->machine;
+    for (uint8_t i = 0; i < sizeof chip8->keypad; i++) chip8->keypad[i] = (keys >> i) & 1;
+}
+
+// Emulate count instructions on a side, timers ticking as usual
+static void run_side(side_t *side, config_t config, const uint64_t count){
+    if (side->lanes){
+        run_lanes(&side->lanes_state, config, count);
+    }else{
+        config.idle_skip &= side->idle_skip;
+        run_cycles(&side->machine, &side->engine, config, count);
+    }
+}
+
+// FNV-1a over everything an instruction can change, a word at a time like hash_display
+static uint64_t hash_machine(const chip8_t *chip8){
+    uint64_t hash = 0xCBF29CE484222325ull;
+    #define HASH_WORD(word) (hash = (hash ^ (word)) * 0x100000001B3ull)
+
+    for (uint32_t i = 0; i < sizeof chip8->ram; i += 8){
+        uint64_t word;
+        memcpy(&word, &chip8->ram[i], sizeof word);
+        HASH_WORD(word);
+    }
+    const uint64_t *display = &chip8->display[0][0][0];
+    for (uint32_t i = 0; i < sizeof chip8->display / sizeof *display; i++) HASH_WORD(display[i]);
+    for (uint32_t i = 0; i < sizeof chip8->V; i += 8){
+        uint64_t V, flags;
+        memcpy(&V, &chip8->V[i], sizeof V);
+        memcpy(&flags, &chip8->flags[i], sizeof flags);
+        HASH_WORD(V);
+        HASH_WORD(flags);
+    }
+    const uint32_t depth = chip8->stack_ptr - chip8->stack;
+    for (uint32_t i = 0; i < depth; i++) HASH_WORD(chip8->stack[i]);
+    HASH_WORD(((uint64_t)chip8->I << 48) | ((uint64_t)chip8->PC << 32) | ((uint64_t)depth << 24) |
+              ((uint64_t)chip8->delay_timer << 16) | ((uint64_t)chip8->sound_timer << 8) |
+              ((uint64_t)chip8->hires << 4) | chip8->planes);
+    HASH_WORD(chip8->cycles);
+    HASH_WORD(chip8->timer_ticks);
+    HASH_WORD(chip8->rng_state);
+
+    #undef HASH_WORD
+    return hash;
+}
+
+// Print every field where machine differs from the reference's
+static void print_differences(const chip8_t *reference, const chip8_t *machine){
+    #define DIFFERENT_FIELD(name, field, format) \
+        if (reference->field != machine->field) printf("  %s: " format " vs " format "\n", name, \
+                                                        (unsigned long long)reference->field, \
+                                                        (unsigned long long)machine->field)
+    DIFFERENT_FIELD("PC", PC, "0x%03llX");
+    DIFFERENT_FIELD("I", I, "0x%03llX");
+    const char *V_names[16] = {"V0", "V1", "V2", "V3", "V4", "V5", "V6", "V7",
+                               "V8", "V9", "VA", "VB", "VC", "VD", "VE", "VF"};
+    for (uint8_t i = 0; i < 16; i++) DIFFERENT_FIELD(V_names[i], V[i], "0x%02llX");
+    for (uint8_t i = 0; i < 16; i++){
+        if (reference->flags[i] != machine->flags[i])
+            printf("  flags[%u]: 0x%02X vs 0x%02X\n", i, reference->flags[i], machine->flags[i]);
+    }
+    DIFFERENT_FIELD("delay_timer", delay_timer, "%llu");
+    DIFFERENT_FIELD("sound_timer", sound_timer, "%llu");
+    DIFFERENT_FIELD("hires", hires, "%llu");
+    DIFFERENT_FIELD("planes", planes, "%llu");
+    DIFFERENT_FIELD("cycles", cycles, "%llu");
+    DIFFERENT_FIELD("timer_ticks", timer_ticks, "%llu");
+    DIFFERENT_FIELD("rng_state", rng_state, "0x%016llX");
+    #undef DIFFERENT_FIELD
+
+    const long depth = reference->stack_ptr - reference->stack, other_depth = machine->stack_ptr - machine->stack;
+    if (depth != other_depth) printf("  stack depth: %ld vs %ld\n", depth, other_depth);
+    for (long i = 0; i < depth && i < other_depth; i++){
+        if (reference->stack[i] != machine->stack[i])
+            printf("  stack[%ld]: 0x%03X vs 0x%03X\n", i, reference->stack[i], machine->stack[i]);
+    }
+
+    // RAM and display can differ in a lot of places, the first few are enough to go on
+    uint32_t ram_differences = 0;
+    for (uint32_t address = 0; address < sizeof reference->ram; address++){
+        if (reference->ram[address] == machine->ram[address]) continue;
+        if (ram_differences++ < 8) printf("  ram[0x%03X]: 0x%02X vs 0x%02X\n", address, reference->ram[address],
+                                          machine->ram[address]);
+    }
+    if (ram_differences > 8) printf("  ... %u RAM bytes differ\n", ram_differences);
+
+    uint32_t row_differences = 0;
+    for (uint32_t plane = 0; plane < CHIP8_PLANES; plane++){
+        for (uint32_t y = 0; y < CHIP8_HIRES_HEIGHT; y++){
+            for (uint32_t word = 0; word < CHIP8_ROW_WORDS; word++){
+                const uint64_t row = reference->display[plane][y][word], other = machine->display[plane][y][word];
+                if (row != other && row_differences++ < 8)
+                    printf("  display[%u][%u][%u]: %016llX vs %016llX\n", plane, y, word,
+                           (unsigned long long)row, (unsigned long long)other);
+            }
+        }
+    }
+    if (row_differences > 8) printf("  ... %u display words differ\n", row_differences);
+}
+
+// Hash sides after running them, the first side that isn't the reference's, 0 if they all agree
+static uint32_t mismatched_side(void){
+    const uint64_t reference = hash_machine(side_machine(&sides[0]));
+    for (uint32_t i = 1; i < SIDES; i++){
+        if (hash_machine(side_machine(&sides[i])) != reference) return i;
+    }
+    return 0;
+}
+
+// side disagreed with the reference after count instructions from their checkpoints. Binary search for the
+//  first instruction that makes them differ, then print it and what it did differently
+static void bisect(side_t *side, const config_t config, const uint64_t count){
+    side_t *reference = &sides[0];
+
+    // after low - 1 instructions they agree, after high they don't
+    uint64_t low = 1, high = count;
+    while (low < high){
+        const uint64_t middle = low + (high - low) / 2;
+        restore_checkpoint(reference);
+        restore_checkpoint(side);
+        run_side(reference, config, middle);
+        run_side(side, config, middle);
+        if (hash_machine(side_machine(reference)) == hash_machine(side_machine(side))) low = middle + 1;
+        else high = middle;
+    }
+
+    restore_checkpoint(reference);
+    restore_checkpoint(side);
+    run_side(reference, config, low - 1);
+    run_side(side, config, low - 1);
+    const chip8_t *before = side_machine(reference);
+    const uint16_t PC = before->PC;
+    const uint16_t opcode = PC + 1u < sizeof before->ram ? (before->ram[PC] << 8) | before->ram[PC+1] : 0;
+    const uint64_t cycle = before->cycles;
+
+    char text[32];
+    disassemble(opcode, text, sizeof text);
+    run_side(reference, config, 1);
+    run_side(side, config, 1);
+    printf("%s differs from reference at instruction %llu, PC 0x%03X: %04X %s\n", side->name,
+           (unsigned long long)cycle, PC, opcode, text);
+    printf("  (reference vs %s)\n", side->name);
+    print_differences(side_machine(reference), side_machine(side));
+}
+
+// Run every side from machine for count instructions, comparing them every config.check_interval instructions.
+//  Keys come from movie if there is one, otherwise a new random keypad is held every interval. True if every
+//  engine agreed with the reference the whole way, a mismatch is bisected and printed
+static bool cross_check(const chip8_t *machine, const config_t config, const chip8_movie_t *movie,
+                        const uint64_t seed, const uint64_t count){
+    for (uint32_t i = 0; i < SIDES; i++) start_side(&sides[i], machine);
+
+    uint64_t keys_state = random_state(seed);
+    uint32_t next_event = 0;
+    uint64_t done = 0;
+    while (done < count){
+        const uint64_t cycle = side_machine(&sides[0])->cycles;
+
+        // input only changes between intervals, so an interval replays exactly from its checkpoint
+        uint64_t run = count - done < config.check_interval ? count - done : config.check_interval;
+        if (movie){
+            if (next_event < movie->count && movie->events[next_event].cycle <= cycle){
+                uint16_t keys = 0;
+                while (next_event < movie->count && movie->events[next_event].cycle <= cycle)
+                    keys = movie->events[next_event++].keys;
+                for (uint32_t i = 0; i < SIDES; i++) set_side_keys(&sides[i], keys);
+            }
+            if (next_event < movie->count && movie->events[next_event].cycle - cycle < run)
+                run = movie->events[next_event].cycle - cycle;
+        }else{
+            // mostly nothing held, otherwise 1 key, enough to get past FX0A waits and through EX9E/EXA1 paths
+            const uint64_t random = next_random(&keys_state);
+            const uint16_t keys = random & 1 ? (uint16_t)(1u << ((random >> 8) & 0xF)) : 0;
+            for (uint32_t i = 0; i < SIDES; i++) set_side_keys(&sides[i], keys);
+        }
+
+        for (uint32_t i = 0; i < SIDES; i++){
+            save_checkpoint(&sides[i]);
+            run_side(&sides[i], config, run);
+        }
+
+        const uint32_t mismatch = mismatched_side();
+        if (mismatch){
+            bisect(&sides[mismatch], config, run);
+            return false;
+        }
+        done += run;
+    }
+    return true;
+}
+
+
+// Generated code comes in groups of 16 units (2 instructions, 4 bytes each), a few of them at fixed places so
+//  jumps, calls and RAM writes can find them:
+//    patch units, 6XNN/7XNN then anything, whose NN byte memory units write with F055 or FX33 (FX33's other 2
+//      digits turn the instruction after into 0x0?0?, a machine call that does nothing)
+//    odd blocks of 3 units: 1NNN over the block, then 2 instructions at odd addresses (+3, +5) and a way out (+7).
+//      The jump block is entered by 1NNN and jumps back to a unit, often after patching the unit right after
+//      it, which it then jumps to; the call block is entered by 2NNN, has no jumps or calls of its own and
+//      returns with 00EE
+//  so code that has already run gets rewritten, from even and odd addresses, and every engine has to notice
+#define FUZZ_GROUP 64
+#define FUZZ_PATCH 0x10         // offsets in a group
+#define FUZZ_ODD_JUMP 0x20
+#define FUZZ_PATCH_AFTER 0x2C   // the unit after the jump block
+#define FUZZ_ODD_CALL 0x30
+#define FUZZ_ODD_BLOCK 12       // bytes in an odd block
+#define FUZZ_GROUPS (DIFFTEST_FUZZ_CODE / FUZZ_GROUP)
+
+// Start of a random unit to jump to, never one inside an odd block (its bytes aren't instructions there)
+static uint16_t unit_target(const uint64_t random){
+    uint32_t offset = (random % (DIFFTEST_FUZZ_CODE / 4)) * 4;
+    const uint32_t in_group = offset % FUZZ_GROUP;
+    if (in_group > FUZZ_ODD_JUMP && in_group < FUZZ_ODD_JUMP + FUZZ_ODD_BLOCK) offset -= in_group - FUZZ_ODD_JUMP;
+    if (in_group > FUZZ_ODD_CALL && in_group < FUZZ_ODD_CALL + FUZZ_ODD_BLOCK) offset -= in_group - FUZZ_ODD_CALL;
+    return 0x200 + offset;
+}
+
+// Odd address an odd block's code starts at
+static uint16_t odd_target(const uint64_t random, const uint32_t block){
+    return 0x200 + (random % FUZZ_GROUPS) * FUZZ_GROUP + block + 3;
+}
+
+// 6XNN/7XNN for a patch to write the NN of
+static uint16_t patch_opcode(const uint64_t random){
+    return (random & 0x10000 ? 0x6000 : 0x7000) | (random & 0x0FFF);
+}
+
+// FX33 or F055 (F055 writes just the 1 byte) through I = patch
+static void patch_unit(const uint64_t random, const uint16_t patch, uint16_t unit[2]){
+    unit[0] = 0xA000 | patch;
+    unit[1] = random & 1 ? 0xF033 | (random & 0x0F00) : 0xF055;
+}
+
+// Random opcode for a generated program. Programs are units of 2 instructions and have to stay well defined
+//  (the core doesn't bounds check, neither does a real CHIP8): calls only go to call blocks (which can't call,
+//  so they always return), no BNNN or EX9E/EXA1 (they would jump/index anywhere), jumps only go to the start
+//  of a unit or a jump block, and skips are only ever the first instruction of a unit so they always land on
+//  the start of the next. FX33/FX55/FX65 come from memory_unit instead, and nothing else moves I far, so RAM
+//  accesses stay in the data after the code or hit a patch byte. in_call: for a call block
+static uint16_t random_opcode(uint64_t *state, const bool first, const bool in_call){
+    static const uint16_t family_0[] = {0x00E0, 0x00C0, 0x00D0, 0x00FB, 0x00FC, 0x00FE, 0x00FF};
+    static const uint8_t family_F[] = {0x07, 0x0A, 0x15, 0x18, 0x30, 0x75, 0x85, 0x01};
+
+    for (;;){
+        const uint64_t random = next_random(state);
+        const uint16_t opcode = random & 0xFFFF;
+        switch (opcode >> 12){
+            case 0x0:{
+                const uint16_t op = family_0[(random >> 16) % (sizeof family_0 / sizeof family_0[0])];
+                if ((random >> 24) % 64 == 0) return 0x00FD; // rare, it stops the program for good
+                return op == 0x00C0 || op == 0x00D0 ? op | (opcode & 0xF) : op;
+            }
+            case 0x1:
+                if (in_call) continue;
+                if ((random >> 56) % 4 == 0) return 0x1000 | odd_target(random >> 16, FUZZ_ODD_JUMP);
+                return 0x1000 | unit_target(random >> 16);
+            case 0x2:
+                if (in_call) continue;
+                return 0x2000 | odd_target(random >> 16, FUZZ_ODD_CALL);
+            case 0xB: case 0xE:
+                continue;
+            case 0x3: case 0x4: case 0x5: case 0x9:
+                if (!first) continue;
+                return opcode;
+            case 0xA:
+                return 0xA000 | (DIFFTEST_FUZZ_DATA + (random >> 16) % 0x100);
+            case 0xF:
+                return 0xF000 | (opcode & 0x0F00) | family_F[(random >> 16) % sizeof family_F];
+            default:
+                return opcode;
+        }
+    }
+}
+
+// Store/load unit, the RAM access right after the I it goes through is set. 1 in 4 patch the code instead
+static void memory_unit(uint64_t *state, uint16_t unit[2]){
+    static const uint8_t memory_ops[] = {0x33, 0x55, 0x65};
+    const uint64_t random = next_random(state);
+    if ((random >> 40) % 4 == 0){
+        const uint32_t patch = (random >> 44) & 1 ? FUZZ_PATCH : FUZZ_PATCH_AFTER;
+        patch_unit(random, 0x200 + ((random >> 48) % FUZZ_GROUPS) * FUZZ_GROUP + patch + 1, unit);
+        return;
+    }
+    unit[0] = 0xA000 | (DIFFTEST_FUZZ_DATA + (random >> 16) % 0x100);
+    unit[1] = 0xF000 | (random & 0x0F00) | memory_ops[(random >> 32) % sizeof memory_ops];
+}
+
+// Write an opcode big endian at rom[at]
+static void put_opcode(uint8_t rom[DIFFTEST_FUZZ_CODE], const uint32_t at, const uint16_t opcode){
+    rom[at] = opcode >> 8;
+    rom[at + 1] = opcode & 0xFF;
+}
+
+// Fill a ROM with random units, ending in a unit of jumps back to the start
+static void generate_rom(uint8_t rom[DIFFTEST_FUZZ_CODE], const uint64_t seed){
+    uint64_t state = random_state(seed);
+    memset(rom, 0, DIFFTEST_FUZZ_CODE);
+    for (uint32_t i = 0; i < DIFFTEST_FUZZ_CODE; i += 4){
+        uint16_t unit[2] = {0x1200, 0x1200};
+        const uint32_t in_group = i % FUZZ_GROUP;
+        if (i + 4 == DIFFTEST_FUZZ_CODE){
+            // the jumps back
+        }else if (in_group == FUZZ_ODD_JUMP || in_group == FUZZ_ODD_CALL){
+            const bool call = in_group == FUZZ_ODD_CALL;
+            const uint16_t after = 0x200 + i + FUZZ_ODD_BLOCK;
+            uint16_t exit = call ? 0x00EE : 0x1000 | unit_target(next_random(&state));
+            const uint64_t random = next_random(&state);
+            if (!call && random % 2 == 0){
+                patch_unit(random >> 8, after + 1, unit);
+                exit = 0x1000 | after;
+            }else if (call && random % 6 == 0){
+                memory_unit(&state, unit);
+            }else{
+                unit[0] = random_opcode(&state, true, call);
+                unit[1] = random_opcode(&state, false, call);
+            }
+            put_opcode(rom, i, 0x1000 | after);
+            put_opcode(rom, i + 3, unit[0]);
+            put_opcode(rom, i + 5, unit[1]);
+            put_opcode(rom, i + 7, exit);
+            i += FUZZ_ODD_BLOCK - 4;
+            continue;
+        }else if (in_group == FUZZ_PATCH || in_group == FUZZ_PATCH_AFTER){
+            unit[0] = patch_opcode(next_random(&state));
+            unit[1] = random_opcode(&state, false, false);
+        }else if (next_random(&state) % 6 == 0){
+            memory_unit(&state, unit);
+        }else{
+            unit[0] = random_opcode(&state, true, false);
+            unit[1] = random_opcode(&state, false, false);
+        }
+        put_opcode(rom, i, unit[0]);
+        put_opcode(rom, i + 2, unit[1]);
+    }
+}
+
+// --fuzz: cross-check config.fuzz_roms generated ROMs under every quirk profile, seeds seed, seed + 1...
+static bool run_fuzz(const config_t config, const uint64_t instructions){
+    static chip8_t machine; // static, chip8_t is big
+    uint32_t mismatches = 0;
+
+    for (uint32_t n = 0; n < config.fuzz_roms; n++){
+        const uint64_t seed = config.seed + n;
+        uint8_t rom[DIFFTEST_FUZZ_CODE];
+        generate_rom(rom, seed);
+
+        for (quirks_t quirks = 0; quirks < QUIRKS_COUNT; quirks++){
+            if (!init_chip8_buffer(&machine, "fuzz", rom, sizeof rom)) return false;
+            machine.quirks = quirks;
+            seed_chip8(&machine, seed);
+            if (cross_check(&machine, config, NULL, seed, instructions)) continue;
+
+            mismatches++;
+            char path[64];
+            snprintf(path, sizeof path, "difftest-%llu.ch8", (unsigned long long)seed);
+            FILE *file = fopen(path, "wb");
+            if (file && fwrite(rom, sizeof rom, 1, file) == 1){
+                printf("  rerun with: chip8-difftest %s %llu --seed %llu --quirks %s\n", path,
+                       (unsigned long long)instructions, (unsigned long long)seed, quirks_name(quirks));
+            }else{
+                fprintf(stderr, "Could not write %s\n", path);
+            }
+            if (file) fclose(file);
+        }
+    }
+
+    printf("%u random ROMs x %u quirk profiles x %llu instructions: %u mismatches\n", config.fuzz_roms,
+           (uint32_t)QUIRKS_COUNT, (unsigned long long)instructions, mismatches);
+    return mismatches == 0;
+}
+
+
+int main(int argc, char **argv){
+    if (argc < 2){
+        fprintf(stderr, "Usage: %s <rom_name> [instructions] [--replay <movie>] [--check-interval n] [options]\n"
+                        "       %s --fuzz <roms> [--instructions n] [--seed n] [--check-interval n]\n",
+                argv[0], argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    config_t config = {0};
+    if (!set_config_from_args(&config, argc, argv)) {exit(EXIT_FAILURE);}
+
+    // fixed seed either way, a difference has to be reproducible to be any use
+    if (config.fuzz_roms){
+        if (!config.fixed_seed) config.seed = 1;
+        const uint64_t instructions = config.max_instructions ? config.max_instructions : DIFFTEST_FUZZ_INSTRUCTIONS;
+        exit(run_fuzz(config, instructions) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    static chip8_t machine;
+    const char *rom_name = argv[1];
+    if (!init_chip8(&machine, rom_name)) {exit(EXIT_FAILURE);}
+    if (config.fixed_quirks) machine.quirks = config.quirks;
+
+    // --replay: the recorded input, seed and clock rate
+    chip8_movie_t movie = {0};
+    if (config.replay_path){
+        if (!load_movie(&movie, config.replay_path)) {exit(EXIT_FAILURE);}
+        config.seed = movie.seed;
+        config.inst_per_second = movie.inst_per_second;
+    }
+    seed_chip8(&machine, config.seed);
+
+    uint64_t instructions = config.replay_path ? movie.length : (uint64_t)config.inst_per_second * DIFFTEST_DEFAULT_SECONDS;
+    if (config.max_instructions) instructions = config.max_instructions;
+    if (argc > 2 && argv[2][0] != '-') instructions = strtoull(argv[2], NULL, 0);
+
+    const bool agreed = cross_check(&machine, config, config.replay_path ? &movie : NULL, config.seed, instructions);
+    if (agreed){
+        printf("%s (%s): %llu instructions, every engine matches the reference, display %016llx\n", rom_name,
+               quirks_name(machine.quirks), (unsigned long long)instructions,
+               (unsigned long long)hash_display(side_machine(&sides[0])));
+    }
+    free_movie(&movie);
+    exit(agreed ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,315 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime/mkdir
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "golden.h"
+
+#define GOLDEN_SEED 1          // fixed, CXNN has to draw the same frame every run
+#define PNG_WIDTH 512          // mismatched frames are scaled up to 512x256 whatever the resolution
+#define PNG_HEIGHT 256
+
+static const struct {
+    engine_type_t type;
+    const char *name;
+    bool lanes;                // run as a single lockstep lane (run_lanes) instead of by an engine
+} engines[] = {
+    {ENGINE_INTERPRETER, "interpreter", false},
+    {ENGINE_PREDECODE, "predecode", false},
+    {ENGINE_BLOCKS, "blocks", false},
+    {ENGINE_INTERPRETER, "lanes", true},
+};
+#define ENGINES (sizeof engines / sizeof engines[0])
+
+// 1 line of a golden file
+typedef struct {
+    char path[4096];
+    uint64_t instructions;
+    quirks_t quirks;
+    bool has_hash;             // false for a "-" hash, a ROM that was added but never run
+    uint64_t hash;
+} golden_entry_t;
+
+// Milliseconds since some fixed point
+static double now_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+
+// PNG writer, just enough for an 8 bit paletted image with no compression (stored deflate blocks)
+
+// CRC-32 (the zlib/PNG one) of size bytes, carrying on from crc
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, const size_t size){
+    static uint32_t table[256];
+    if (!table[1]){
+        for (uint32_t n = 0; n < 256; n++){
+            uint32_t c = n;
+            for (uint8_t k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void put_u32(uint8_t *out, const uint32_t value){
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+// Write 1 PNG chunk: length, type, data, CRC of type + data
+static bool write_chunk(FILE *file, const char type[4], const uint8_t *data, const uint32_t size){
+    uint8_t header[8];
+    put_u32(header, size);
+    memcpy(header + 4, type, 4);
+    uint8_t crc[4];
+    put_u32(crc, crc32_update(crc32_update(0, header + 4, 4), data, size));
+    return fwrite(header, sizeof header, 1, file) == 1 && (size == 0 || fwrite(data, size, 1, file) == 1) &&
+           fwrite(crc, sizeof crc, 1, file) == 1;
+}
+
+// Write the machine's frame to path as a PNG in the frontend's colours, scaled up to PNG_WIDTH x PNG_HEIGHT
+static bool write_png(const chip8_t *chip8, const config_t config, const char *path){
+    // each row is a filter byte (0, none) then 1 palette index per pixel
+    enum { ROW_BYTES = 1 + PNG_WIDTH, RAW_BYTES = ROW_BYTES * PNG_HEIGHT, BLOCK_BYTES = 65535 };
+    static uint8_t raw[RAW_BYTES];
+    const uint32_t scale = PNG_WIDTH / display_width(chip8);
+    for (uint32_t y = 0; y < PNG_HEIGHT; y++){
+        uint8_t *row = &raw[y * ROW_BYTES];
+        row[0] = 0;
+        for (uint32_t x = 0; x < PNG_WIDTH; x++) row[1 + x] = get_pixel(chip8, x / scale, y / scale);
+    }
+
+    // zlib stream of stored blocks: header, blocks of up to 65535 bytes (final flag, length, ~length), adler32
+    enum { BLOCKS = (RAW_BYTES + BLOCK_BYTES - 1) / BLOCK_BYTES, ZLIB_BYTES = 2 + BLOCKS * 5 + RAW_BYTES + 4 };
+    static uint8_t zlib[ZLIB_BYTES];
+    uint32_t size = 0;
+    zlib[size++] = 0x78;
+    zlib[size++] = 0x01;
+    uint32_t a = 1, b = 0;
+    for (uint32_t offset = 0; offset < RAW_BYTES; offset += BLOCK_BYTES){
+        const uint32_t length = RAW_BYTES - offset < BLOCK_BYTES ? RAW_BYTES - offset : BLOCK_BYTES;
+        zlib[size++] = offset + length == RAW_BYTES;
+        zlib[size++] = length & 0xFF;
+        zlib[size++] = length >> 8;
+        zlib[size++] = ~length & 0xFF;
+        zlib[size++] = (~length >> 8) & 0xFF;
+        memcpy(&zlib[size], &raw[offset], length);
+        size += length;
+        for (uint32_t i = offset; i < offset + length; i++){
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+    }
+    put_u32(&zlib[size], (b << 16) | a);
+    size += 4;
+
+    uint8_t header[13];
+    put_u32(header, PNG_WIDTH);
+    put_u32(header + 4, PNG_HEIGHT);
+    header[8] = 8;   // bit depth
+    header[9] = 3;   // paletted
+    header[10] = header[11] = header[12] = 0; // deflate, adaptive filtering, no interlace
+
+    // palette index = plane bits, like get_pixel: off, plane 1, plane 2, both
+    const uint32_t colours[4] = {config.bg_color, config.fg_color, config.fg2_color, config.blend_color};
+    uint8_t palette[4 * 3];
+    for (uint32_t i = 0; i < 4; i++){
+        palette[i*3] = colours[i] >> 24;
+        palette[i*3 + 1] = colours[i] >> 16;
+        palette[i*3 + 2] = colours[i] >> 8;
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file){
+        fprintf(stderr, "Could not write %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    bool ok = fwrite(signature, sizeof signature, 1, file) == 1 && write_chunk(file, "IHDR", header, sizeof header) &&
+              write_chunk(file, "PLTE", palette, sizeof palette) && write_chunk(file, "IDAT", zlib, size) &&
+              write_chunk(file, "IEND", NULL, 0);
+    ok &= fclose(file) == 0;
+    if (!ok) fprintf(stderr, "Could not write %s\n", path);
+    return ok;
+}
+
+
+// Parse "<rom_path> <instructions> <quirks> <display_hash|->", false if it isn't one
+static bool parse_entry(const char *line, golden_entry_t *entry){
+    unsigned long long instructions;
+    char quirks[32], hash[32];
+    if (sscanf(line, "%4095s %llu %31s %31s", entry->path, &instructions, quirks, hash) != 4) return false;
+    if (instructions == 0 || !parse_quirks(quirks, &entry->quirks)) return false;
+    entry->instructions = instructions;
+
+    entry->has_hash = strcmp(hash, "-") != 0;
+    if (entry->has_hash){
+        char *end;
+        entry->hash = strtoull(hash, &end, 16);
+        if (*end != '\0') return false;
+    }
+    return true;
+}
+
+// True if the directory a ROM path is in exists, i.e a missing ROM is missing from a checked out directory
+static bool rom_dir_exists(const char *path){
+    const char *slash = strrchr(path, '/');
+    if (!slash) return true; // next to the golden file's caller, always there
+    char dir[4096];
+    snprintf(dir, sizeof dir, "%.*s", (int)(slash - path), path);
+    struct stat st;
+    return stat(dir, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Write the frame an engine drew for entry into config.png_dir as <rom>.<quirks>.<engine>.png
+static void write_mismatch(const chip8_t *chip8, const config_t config, const golden_entry_t *entry,
+                           const char *engine){
+    if (mkdir(config.png_dir, 0755) != 0 && errno != EEXIST){
+        fprintf(stderr, "Could not create %s: %s\n", config.png_dir, strerror(errno));
+        return;
+    }
+    const char *name = strrchr(entry->path, '/');
+    name = name ? name + 1 : entry->path;
+    char path[8192];
+    snprintf(path, sizeof path, "%s/%s.%s.%s.png", config.png_dir, name, quirks_name(entry->quirks), engine);
+    if (write_png(chip8, config, path)) printf("  wrote %s\n", path);
+}
+
+// Run entry on every engine. Checking: true if each one drew the golden frame. Updating (no golden hash to
+//  check against): true if they all drew the same one, stored in entry
+static bool check_entry(const config_t config, golden_entry_t *entry, const chip8_t *machine){
+    static chip8_t run;               // static, too big for some stacks
+    static chip8_engine_t engine;
+    static chip8_lanes_t lanes;
+
+    bool ok = true;
+    uint64_t first_hash = 0;
+    for (uint32_t i = 0; i < ENGINES; i++){
+        const chip8_t *chip8 = &run;
+        if (engines[i].lanes){
+            init_lanes(&lanes, machine, 1);
+            run_lanes(&lanes, config, entry->instructions);
+            chip8 = sync_lane(&lanes, 0);
+        }else{
+            clone_chip8(&run, machine);
+            init_engine(&engine, engines[i].type);
+            run_cycles(&run, &engine, config, entry->instructions);
+        }
+
+        const uint64_t hash = hash_display(chip8);
+        if (i == 0) first_hash = hash;
+        const uint64_t expected = config.update_golden ? first_hash : entry->hash;
+        if (hash == expected) continue;
+
+        ok = false;
+        printf("FAIL %s %s %llu: %s drew %016llx, %s %016llx\n", entry->path, quirks_name(entry->quirks),
+               (unsigned long long)entry->instructions, engines[i].name, (unsigned long long)hash,
+               config.update_golden ? "interpreter drew" : "golden is", (unsigned long long)expected);
+        if (config.png_dir) write_mismatch(chip8, config, entry, engines[i].name);
+    }
+
+    if (ok && config.update_golden){
+        entry->hash = first_hash;
+        entry->has_hash = true;
+    }
+    return ok;
+}
+
+
+// Check (or update) every ROM in the golden file
+bool run_golden(const config_t config){
+    FILE *file = fopen(config.golden_path, "r");
+    if (!file){
+        fprintf(stderr, "Golden file %s is invalid or does not exist\n", config.golden_path);
+        return false;
+    }
+
+    // updates go to a copy that replaces the file once every line is written
+    char update_path[4096];
+    FILE *update = NULL;
+    if (config.update_golden){
+        snprintf(update_path, sizeof update_path, "%s.tmp", config.golden_path);
+        if (!(update = fopen(update_path, "w"))){
+            fprintf(stderr, "Could not write %s: %s\n", update_path, strerror(errno));
+            fclose(file);
+            return false;
+        }
+    }
+
+    static chip8_t machine;
+    static golden_entry_t entry;
+    uint32_t passed = 0, failed = 0, skipped = 0, line_number = 0;
+    const double start = now_ms();
+    struct stat st;
+    char line[8192];
+    while (fgets(line, sizeof line, file)){
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        const bool is_entry = line[0] != '\0' && line[0] != '#';
+
+        if (is_entry && !parse_entry(line, &entry)){
+            fprintf(stderr, "%s:%u: expected <rom_path> <instructions> <quirks> <display_hash|->\n",
+                    config.golden_path, line_number);
+            failed++;
+        }else if (is_entry && stat(entry.path, &st) != 0 && !rom_dir_exists(entry.path)){
+            // a test ROM submodule that isn't checked out, not a failure of the emulator
+            printf("SKIP %s (directory not checked out)\n", entry.path);
+            skipped++;
+        }else if (is_entry && stat(entry.path, &st) != 0){
+            printf("FAIL %s: not found\n", entry.path);
+            failed++;
+        }else if (is_entry && !init_chip8(&machine, entry.path)){
+            failed++;
+        }else if (is_entry && !entry.has_hash && !config.update_golden){
+            // an unchecked ROM is not a pass
+            printf("FAIL %s %s %llu: no golden hash yet, run make golden\n", entry.path,
+                   quirks_name(entry.quirks), (unsigned long long)entry.instructions);
+            failed++;
+        }else if (is_entry){
+            machine.quirks = entry.quirks;
+            seed_chip8(&machine, GOLDEN_SEED);
+
+            const double rom_start = now_ms();
+            const bool ok = check_entry(config, &entry, &machine);
+            const double ms = now_ms() - rom_start;
+            if (ok){
+                printf("PASS %s %s %llu %016llx %.2fms\n", entry.path, quirks_name(entry.quirks),
+                       (unsigned long long)entry.instructions, (unsigned long long)entry.hash, ms);
+                passed++;
+            }else{
+                failed++;
+            }
+            if (update && entry.has_hash){
+                fprintf(update, "%s %llu %s %016llx\n", entry.path, (unsigned long long)entry.instructions,
+                        quirks_name(entry.quirks), (unsigned long long)entry.hash);
+                continue;
+            }
+        }
+        if (update) fprintf(update, "%s\n", line); // comments, and entries that weren't (re)hashed, stay as they were
+    }
+    fclose(file);
+
+    bool ok = failed == 0;
+    if (update){
+        ok &= fclose(update) == 0;
+        if (ok && rename(update_path, config.golden_path) != 0){
+            fprintf(stderr, "Could not replace %s: %s\n", config.golden_path, strerror(errno));
+            ok = false;
+        }
+        if (!ok) remove(update_path);
+    }
+
+    printf("%s: %u passed, %u failed, %u skipped in %.2fms\n", config.golden_path, passed, failed, skipped,
+           now_ms() - start);
+    return ok;
+}
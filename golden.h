@@ -0,0 +1,19 @@
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+/* Golden frame regression tests
+    Runs each ROM listed in a golden file headless for its instruction budget on every engine and compares
+    hash_display of the final frame with the hash stored next to it, so test ROMs are checked by a build
+    instead of by eye. Lines are "<rom_path> <instructions> <quirks> <display_hash>", # comments; a hash of
+    - means none yet. Mismatched frames can be written out as PNGs to look at
+*/
+
+#include <stdbool.h>
+
+#include "chip8.h"
+
+// Check every ROM in config.golden_path (or with config.update_golden, rewrite the file with the hashes the
+//  engines agree on), PNGs of mismatches go to config.png_dir. False if anything failed
+bool run_golden(const config_t config);
+
+#endif
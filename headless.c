@@ -0,0 +1,143 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+/* Headless CHIP8 runner
+    Runs a ROM for a fixed number of instructions with no window/audio/SDL at all,
+    then prints the final framebuffer to stdout. Used for ROM regressions on display-less machines
+*/
+
+#include "chip8.h"
+#include "batch.h"
+#include "bench.h"
+#include "golden.h"
+#include "shm.h"
+#include "stream.h"
+
+
+// Print the CHIP8 framebuffer as text in its current resolution, '#' for a pixel that is on and '.' for off;
+//  XO-CHIP pixels only on in the second plane are '+', in both '@'
+void print_display(const chip8_t *chip8){
+    for (uint32_t y = 0; y < display_height(chip8); y++){
+        for (uint32_t x = 0; x < display_width(chip8); x++){
+            putchar(".#+@"[get_pixel(chip8, x, y)]);
+        }
+        putchar('\n');
+    }
+}
+
+
+int main(int argc, char **argv){
+    // default message usage for args
+    if (argc < 2){
+        fprintf(stderr, "Usage: %s <rom_name> [instructions] [options]\n"
+                        "       %s --batch <rom_dir|rom_list> [--threads n] [--instructions n] [--instances n] [options]\n"
+                        "       %s [rom_name] --bench [--batch <rom_dir|rom_list>] [--instructions n] [options]\n"
+                        "       %s <rom_name> [instructions] --shm <name> [options]\n"
+                        "       %s <rom_name> [instructions] --stream <port> [--replay <movie>] [options]\n"
+                        "       %s --golden <golden_file> [--update-golden] [--png-dir <dir>] [options]\n"
+                        "       %s <rom_name> --hexdump|--disasm\n",
+                argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // initialise emulator configuration/options
+    config_t config = {0};
+    if (!set_config_from_args(&config, argc, argv)) {exit(EXIT_FAILURE);}
+
+    // benchmark mode, timings as JSON lines
+    if (config.bench) exit(run_bench(config, argv[1][0] != '-' ? argv[1] : NULL) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    // regression test mode, final frames of test ROMs against their golden hashes
+    if (config.golden_path) exit(run_golden(config) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    // batch mode, many ROMs in parallel with a framebuffer hash printed for each
+    if (config.batch_path) exit(run_batch(config) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    // Initialise CHIP8 machine
+    chip8_t chip8 = {0};
+    const char *rom_name = argv[1];
+    if (!init_chip8(&chip8, rom_name)) {exit(EXIT_FAILURE);}
+    if (config.fixed_quirks) chip8.quirks = config.quirks; // --quirks beats the file extension
+
+    // --hexdump/--disasm: look at the ROM instead of running it
+    if (config.hexdump || config.disasm){
+        if (config.hexdump) print_hexdump(&chip8);
+        if (config.disasm) print_disassembly(&chip8);
+        exit(EXIT_SUCCESS);
+    }
+
+    // --replay: input, seed and clock rate all come from the movie, so the run is exactly the recorded one
+    chip8_movie_t movie = {0};
+    if (config.replay_path){
+        if (!load_movie(&movie, config.replay_path)) {exit(EXIT_FAILURE);}
+        config.seed = movie.seed;
+        config.fixed_seed = true;
+        config.inst_per_second = movie.inst_per_second;
+    }
+
+    // random value seed, fixed with --seed for reproducible runs
+    seed_chip8(&chip8, config.fixed_seed ? config.seed : (uint64_t)time(NULL));
+
+    // number of instructions to run before dumping the framebuffer, default is 10 seconds of emulated time
+    //  (--shm/--stream: no limit, the agent decides when it's done or Ctrl+C)
+    uint64_t instructions = config.replay_path ? movie.length :
+                            config.shm_name || config.stream_port ? UINT64_MAX : (uint64_t)config.inst_per_second * 10;
+    if (config.max_instructions) instructions = config.max_instructions;
+    if (argc > 2 && argv[2][0] != '-') instructions = strtoull(argv[2], NULL, 0);
+
+#ifdef DEBUG
+    // record every instruction, saved next to the ROM for chip8-trace at the end
+    static chip8_trace_t trace;
+    chip8.trace = &trace;
+#endif
+
+    // execution engine for running instructions, selected with --predecode/--blocks
+    static chip8_engine_t engine;
+    init_engine(&engine, config.engine);
+
+    // timers tick every emulated 1/60s along the way
+    if (config.stream_port){
+        // real time for spectators, replaying a movie if there is one
+        stream_export_t stream;
+        if (!init_stream(&stream, config.stream_port)) {exit(EXIT_FAILURE);}
+        run_stream(&chip8, &engine, config, &stream, config.replay_path ? &movie : NULL, instructions);
+        free_stream(&stream);
+        free_movie(&movie);
+    }else if (config.replay_path){
+        // timed, replays are the benchmark workload for comparing engines
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        run_movie(&chip8, &engine, config, &movie, instructions);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        const double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        fprintf(stderr, "Replayed %u input changes over %llu instructions in %.3fs (%.1f MIPS)\n", movie.count,
+                (unsigned long long)instructions, seconds, seconds > 0 ? instructions / seconds / 1e6 : 0.0);
+        free_movie(&movie);
+    }else if (config.shm_name){
+        // lockstep with an external agent, 1 frame per request through shared memory
+        shm_export_t shm = {0};
+        if (!init_shm(&shm, config.shm_name, true)) {exit(EXIT_FAILURE);}
+        run_shm(&chip8, &engine, config, &shm, instructions);
+        free_shm(&shm);
+    }else{
+        run_cycles(&chip8, &engine, config, instructions);
+    }
+
+    putchar('\n');
+    print_display(&chip8);
+
+#ifdef DEBUG
+    char trace_path[4096];
+    snprintf(trace_path, sizeof trace_path, "%s.trace", rom_name);
+    if (save_trace_file(&trace, trace_path)) fprintf(stderr, "Trace of the last %u instructions written to %s\n",
+                                                     trace.count < CHIP8_TRACE_ENTRIES ? (uint32_t)trace.count : CHIP8_TRACE_ENTRIES, trace_path);
+#endif
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,167 @@
+#define _GNU_SOURCE // shm_open/sigaction/syscall
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <limits.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "shm.h"
+
+// the layout is part of the interface, catch anything that would move a field
+_Static_assert(sizeof(chip8_shm_t) == 2128, "chip8_shm_t layout changed, bump CHIP8_SHM_VERSION");
+
+#define SHM_WAIT_NS 100000000L  // longest futex sleep, so signals and quit are noticed within 100ms
+
+static volatile sig_atomic_t stop_requested;
+
+static void request_stop(int signal){
+    (void)signal;
+    stop_requested = 1;
+}
+
+// Sleep while *word == value, or until woken/timed out. Not FUTEX_PRIVATE, the other side is another process
+static void futex_wait(atomic_uint *word, const uint32_t value){
+    const struct timespec timeout = {.tv_sec = 0, .tv_nsec = SHM_WAIT_NS};
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, value, &timeout, NULL, 0);
+}
+
+static void futex_wake(atomic_uint *word){
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+
+// Create (or replace) the shared memory object name (e.g "/chip8") and map it, false on errors
+bool init_shm(shm_export_t *shm, const char *name, const bool lockstep){
+    if (strlen(name) >= sizeof shm->name){
+        fprintf(stderr, "Shared memory name %s is too long\n", name);
+        return false;
+    }
+
+    const int fd = shm_open(name, O_CREAT | O_TRUNC | O_RDWR, 0600);
+    if (fd < 0){
+        fprintf(stderr, "Could not create shared memory %s: %s\n", name, strerror(errno));
+        return false;
+    }
+    if (ftruncate(fd, sizeof(chip8_shm_t)) != 0){
+        fprintf(stderr, "Could not size shared memory %s: %s\n", name, strerror(errno));
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+
+    void *shared = mmap(NULL, sizeof(chip8_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the object alive
+    if (shared == MAP_FAILED){
+        fprintf(stderr, "Could not map shared memory %s: %s\n", name, strerror(errno));
+        shm_unlink(name);
+        return false;
+    }
+
+    shm->shared = shared;
+    strcpy(shm->name, name);
+
+    // fresh from ftruncate the region is all zero, fill in the rest and the magic last so a client that
+    //  opened it early can tell when it's ready
+    chip8_shm_t *region = shm->shared;
+    region->version = CHIP8_SHM_VERSION;
+    region->lockstep = lockstep;
+    atomic_init(&region->sequence, 0);
+    atomic_init(&region->request, 0);
+    atomic_init(&region->keys, 0);
+    atomic_init(&region->quit, 0);
+    atomic_thread_fence(memory_order_release);
+    region->magic = CHIP8_SHM_MAGIC;
+    return true;
+}
+
+// Unmap and remove the shared memory object
+void free_shm(shm_export_t *shm){
+    if (!shm->shared) return;
+    munmap(shm->shared, sizeof(chip8_shm_t));
+    shm_unlink(shm->name);
+    shm->shared = NULL;
+}
+
+// Publish the machine as the next frame and wake any readers waiting for it
+void publish_shm(shm_export_t *shm, const chip8_t *chip8){
+    chip8_shm_t *region = shm->shared;
+
+    // odd sequence: readers that start now or overlap the writes below will retry
+    const uint32_t sequence = atomic_load_explicit(&region->sequence, memory_order_relaxed);
+    atomic_store_explicit(&region->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    region->state = chip8->state;
+    region->frame++;
+    region->cycles = chip8->cycles;
+    memcpy(region->display, chip8->display, sizeof region->display);
+    region->I = chip8->I;
+    region->PC = chip8->PC;
+    region->delay_timer = chip8->delay_timer;
+    region->sound_timer = chip8->sound_timer;
+    memcpy(region->V, chip8->V, sizeof region->V);
+    region->hires = chip8->hires;
+    region->planes = chip8->planes;
+    uint16_t keypad = 0;
+    for (uint32_t i = 0; i < sizeof chip8->keypad; i++) keypad |= (uint16_t)(chip8->keypad[i] << i);
+    region->keypad = keypad;
+
+    atomic_store_explicit(&region->sequence, sequence + 2, memory_order_release);
+    futex_wake(&region->sequence);
+}
+
+// Keypad bitmap the agent wants held
+uint32_t shm_keys(const shm_export_t *shm){
+    return atomic_load_explicit(&shm->shared->keys, memory_order_relaxed) & 0xFFFF;
+}
+
+
+// Headless lockstep: publish the starting state, then run 1 emulated frame per agent request until the agent
+//  asks to quit, SIGINT/SIGTERM, or count instructions have run (UINT64_MAX = no limit)
+bool run_shm(chip8_t *chip8, chip8_engine_t *engine, const config_t config, shm_export_t *shm, const uint64_t count){
+    chip8_shm_t *region = shm->shared;
+
+    // Ctrl+C stops between frames, so the object still gets unlinked
+    struct sigaction action = {.sa_handler = request_stop};
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    fprintf(stderr, "Sharing machine state at %s, waiting for frame requests\n", shm->name);
+    publish_shm(shm, chip8);
+
+    uint32_t frames_run = atomic_load(&region->request); // requests made before we started don't count
+    uint64_t frames = 0;
+    while (!stop_requested && !atomic_load(&region->quit) && chip8->cycles < count){
+        const uint32_t requested = atomic_load_explicit(&region->request, memory_order_acquire);
+        if (requested == frames_run){
+            futex_wait(&region->request, requested);
+            continue;
+        }
+
+        // the keys for this frame are whatever the agent set before requesting it
+        const uint32_t keys = shm_keys(shm);
+        for (uint32_t i = 0; i < sizeof chip8->keypad; i++) chip8->keypad[i] = (keys >> i) & 1;
+
+        run_frame(chip8, engine, config);
+        frames++;
+        frames_run++;
+        publish_shm(shm, chip8);
+    }
+
+    // 1 last frame with state QUIT, so an agent waiting on a frame we'll never run doesn't wait forever
+    chip8->state = QUIT;
+    publish_shm(shm, chip8);
+
+    fprintf(stderr, "Ran %llu frames (%llu instructions) for %s\n", (unsigned long long)frames,
+            (unsigned long long)chip8->cycles, shm->name);
+    return true;
+}
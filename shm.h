@@ -0,0 +1,103 @@
+#ifndef SHM_H
+#define SHM_H
+
+/* Shared memory export
+    Publishes the machine (display, V, I, PC, timers, keypad) into a POSIX shared memory object once per
+    emulated frame, and reads the keypad from it, so an external process (e.g a reinforcement learning agent)
+    can watch and play with no sockets and no copies on its side: it mmaps the object and reads in place.
+
+    Frames are published under a seqlock: sequence is odd while a frame is being written and even once it is
+    complete, a reader copies what it needs and retries if sequence changed meanwhile (chip8_shm_read below).
+    sequence is also a futex word, woken on every frame, so readers can sleep until the next frame instead
+    of polling. In lockstep mode the emulator runs 1 frame per increment of request (also a futex word,
+    the agent wakes it), which makes runs reproducible step by step.
+
+    The layout is fixed (native byte order, no padding) so non-C clients can use the offsets directly
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "chip8.h"
+
+#define CHIP8_SHM_MAGIC 0x4D485338u    // "8SHM" in little endian
+#define CHIP8_SHM_VERSION 2
+
+// Shared region, written by the emulator unless noted
+typedef struct {
+    uint32_t magic;                 // CHIP8_SHM_MAGIC, written last when the region is set up
+    uint32_t version;               // CHIP8_SHM_VERSION
+    atomic_uint sequence;           // seqlock/futex: odd while a frame is written, even when it's consistent
+    atomic_uint request;            // agent: lockstep frame requests, +1 per frame wanted (FUTEX_WAKE it)
+    atomic_uint keys;               // agent: keypad bitmap, bit N = key N held
+    atomic_uint quit;               // agent: nonzero asks the emulator to stop
+    uint32_t lockstep;              // emulator only runs frames that were requested
+    uint32_t state;                 // emulator_state_t, QUIT in the last frame before the emulator stops
+    uint64_t frame;                 // frames published so far
+    uint64_t cycles;                // instructions executed so far
+    uint64_t display[CHIP8_PLANES][CHIP8_HIRES_HEIGHT][CHIP8_ROW_WORDS]; // same layout as chip8_t's
+    uint16_t I;
+    uint16_t PC;
+    uint16_t keypad;                // keypad bitmap the frame ran with
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint8_t V[16];
+    uint8_t hires;                  // 1 = 128x64, 0 = 64x32 in the top left of display
+    uint8_t planes;                 // XO-CHIP planes selected
+    uint8_t reserved[6];            // always 0
+} chip8_shm_t;
+
+// Export handle, the emulator side of a shared region
+typedef struct {
+    chip8_shm_t *shared;
+    char name[256];                 // shm_open name, unlinked again on close
+} shm_export_t;
+
+// Create (or replace) the shared memory object name (e.g "/chip8") and map it, false on errors
+bool init_shm(shm_export_t *shm, const char *name, const bool lockstep);
+
+// Unmap and remove the shared memory object
+void free_shm(shm_export_t *shm);
+
+// Publish the machine as the next frame and wake any readers waiting for it
+void publish_shm(shm_export_t *shm, const chip8_t *chip8);
+
+// Keypad bitmap the agent wants held
+uint32_t shm_keys(const shm_export_t *shm);
+
+// Headless lockstep: publish the starting state, then run 1 emulated frame per agent request until the agent
+//  asks to quit, SIGINT/SIGTERM, or count instructions have run (UINT64_MAX = no limit)
+bool run_shm(chip8_t *chip8, chip8_engine_t *engine, const config_t config, shm_export_t *shm, const uint64_t count);
+
+
+// Reader side, for C clients that map the region themselves
+
+// Copy a consistent frame out of the region: retries while the emulator is half way through writing one
+static inline void chip8_shm_read(const chip8_shm_t *shared, chip8_shm_t *frame){
+    for (;;){
+        const uint32_t before = atomic_load_explicit(&shared->sequence, memory_order_acquire);
+        if (before & 1) continue; // being written
+        frame->frame = shared->frame;
+        frame->cycles = shared->cycles;
+        frame->state = shared->state;
+        for (uint32_t plane = 0; plane < CHIP8_PLANES; plane++){
+            for (uint32_t y = 0; y < CHIP8_HIRES_HEIGHT; y++){
+                for (uint32_t word = 0; word < CHIP8_ROW_WORDS; word++)
+                    frame->display[plane][y][word] = shared->display[plane][y][word];
+            }
+        }
+        frame->hires = shared->hires;
+        frame->planes = shared->planes;
+        frame->I = shared->I;
+        frame->PC = shared->PC;
+        frame->keypad = shared->keypad;
+        frame->delay_timer = shared->delay_timer;
+        frame->sound_timer = shared->sound_timer;
+        for (uint32_t i = 0; i < 16; i++) frame->V[i] = shared->V[i];
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&shared->sequence, memory_order_relaxed) == before) return;
+    }
+}
+
+#endif
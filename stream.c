@@ -0,0 +1,283 @@
+#define _GNU_SOURCE // sigaction/clock_nanosleep/SOCK_NONBLOCK
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "stream.h"
+
+#define STREAM_MAX_PARTS 4      // packets an update can take, a whole 128x64 display in both planes fits
+
+// every row of both planes at their worst has to fit in STREAM_MAX_PARTS packets, each of which has at least
+//  a row's worth of room left over once it can't take the next row
+_Static_assert(STREAM_MAX_PARTS * (CHIP8_STREAM_MAX_PACKET - CHIP8_STREAM_HEADER_SIZE - CHIP8_STREAM_MAX_ROW + 1) >=
+               CHIP8_PLANES * CHIP8_HIRES_HEIGHT * CHIP8_STREAM_MAX_ROW, "STREAM_MAX_PARTS too small");
+
+// An update being put together, split into datagrams at row boundaries
+typedef struct {
+    uint8_t data[STREAM_MAX_PARTS][CHIP8_STREAM_MAX_PACKET];
+    uint32_t size[STREAM_MAX_PARTS];
+    uint32_t count;
+} stream_packets_t;
+
+static volatile sig_atomic_t stop_requested;
+
+static void request_stop(int signal){
+    (void)signal;
+    stop_requested = 1;
+}
+
+static uint64_t monotonic_ms(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void put_le32(uint8_t *bytes, const uint32_t value){
+    for (uint32_t i = 0; i < 4; i++) bytes[i] = value >> (i * 8);
+}
+
+
+// Listen for viewers on UDP port (all interfaces), false on errors
+bool init_stream(stream_export_t *stream, const uint16_t port){
+    *stream = (stream_export_t){.socket = -1, .port = port};
+
+    const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (fd < 0){
+        fprintf(stderr, "Could not create stream socket: %s\n", strerror(errno));
+        return false;
+    }
+
+    const struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(fd, (const struct sockaddr *)&address, sizeof address) != 0){
+        fprintf(stderr, "Could not listen for viewers on UDP port %u: %s\n", port, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    stream->socket = fd;
+    return true;
+}
+
+// Close the socket, viewers just stop getting updates
+void free_stream(stream_export_t *stream){
+    if (stream->socket < 0) return;
+    close(stream->socket);
+    stream->socket = -1;
+}
+
+// Register/refresh the viewers that said hello since the last frame, and forget the ones that went quiet
+static void take_hellos(stream_export_t *stream, const uint64_t now){
+    uint8_t hello[CHIP8_STREAM_HELLO_SIZE + 1]; // 1 spare, so longer datagrams can be told apart and ignored
+    struct sockaddr_in from;
+    socklen_t from_size = sizeof from;
+    ssize_t size;
+    while ((size = recvfrom(stream->socket, hello, sizeof hello, 0, (struct sockaddr *)&from, &from_size)) >= 0){
+        from_size = sizeof from;
+        if (size != CHIP8_STREAM_HELLO_SIZE || chip8_stream_le32(hello) != CHIP8_STREAM_HELLO_MAGIC) continue;
+
+        stream_viewer_t *viewer = NULL;
+        for (uint32_t i = 0; i < stream->viewer_count && !viewer; i++){
+            if (stream->viewers[i].address == from.sin_addr.s_addr && stream->viewers[i].port == from.sin_port)
+                viewer = &stream->viewers[i];
+        }
+        if (!viewer){
+            if (stream->viewer_count == STREAM_MAX_VIEWERS) continue; // full, it'll keep trying
+            viewer = &stream->viewers[stream->viewer_count++];
+            *viewer = (stream_viewer_t){.address = from.sin_addr.s_addr, .port = from.sin_port,
+                                        .wants_keyframe = true};
+            if (stream->viewer_count > stream->most_viewers) stream->most_viewers = stream->viewer_count;
+            fprintf(stderr, "Viewer %s:%u joined, %u watching\n", inet_ntoa(from.sin_addr), ntohs(from.sin_port),
+                    stream->viewer_count);
+        }
+        viewer->last_hello_ms = now;
+        if (hello[4] & CHIP8_STREAM_WANT_KEYFRAME) viewer->wants_keyframe = true;
+    }
+
+    for (uint32_t i = 0; i < stream->viewer_count;){
+        if (now - stream->viewers[i].last_hello_ms < STREAM_VIEWER_TIMEOUT_MS){
+            i++;
+            continue;
+        }
+        const struct in_addr address = {.s_addr = stream->viewers[i].address};
+        const uint16_t port = stream->viewers[i].port;
+        stream->viewers[i] = stream->viewers[--stream->viewer_count];
+        fprintf(stderr, "Viewer %s:%u left, %u watching\n", inet_ntoa(address), ntohs(port), stream->viewer_count);
+    }
+}
+
+// Append 1 row to an update, encoded as the XOR of row and old (NULL = blank). Nothing if they're the same
+static void encode_row(stream_packets_t *packets, const uint8_t id, const uint8_t *row, const uint8_t *old,
+                       const uint32_t width){
+    uint8_t encoded[CHIP8_STREAM_MAX_ROW] = {id, 0};
+    uint32_t size = 2;
+    for (uint32_t x = 0, from = 0; x < width;){
+        if (row[x] == (old ? old[x] : 0)){
+            x++;
+            continue;
+        }
+
+        // a run: the unchanged bytes since the last one, then every changed byte up to the next unchanged one
+        uint32_t end = x;
+        while (end < width && row[end] != (old ? old[end] : 0)) end++;
+        encoded[size++] = (x - from) << 4 | (end - x - 1);
+        for (; x < end; x++) encoded[size++] = row[x] ^ (old ? old[x] : 0);
+        encoded[1]++;
+        from = end;
+    }
+    if (!encoded[1]) return;
+
+    if (!packets->count || packets->size[packets->count - 1] + size > CHIP8_STREAM_MAX_PACKET){
+        packets->size[packets->count++] = CHIP8_STREAM_HEADER_SIZE; // header goes in once the update is done
+    }
+    memcpy(packets->data[packets->count - 1] + packets->size[packets->count - 1], encoded, size);
+    packets->size[packets->count - 1] += size;
+}
+
+// Fill in the headers of an update's packets: deltas are numbered 1 per packet, a keyframe's parts all carry
+//  the last delta's number, the first flagged as such and each saying how many are still to come
+static void finish_packets(stream_export_t *stream, stream_packets_t *packets, const chip8_stream_type_t type,
+                           const uint32_t frame){
+    for (uint32_t i = 0; i < packets->count; i++){
+        uint8_t *header = packets->data[i];
+        put_le32(header, CHIP8_STREAM_MAGIC);
+        header[4] = CHIP8_STREAM_VERSION;
+        header[5] = type;
+        header[6] = (stream->hires ? CHIP8_STREAM_HIRES : 0) |
+                    (type == CHIP8_STREAM_KEYFRAME && i == 0 ? CHIP8_STREAM_FIRST_PART : 0);
+        header[7] = type == CHIP8_STREAM_KEYFRAME ? packets->count - 1 - i : 0;
+        put_le32(header + 8, type == CHIP8_STREAM_DELTA ? ++stream->sequence : stream->sequence);
+        put_le32(header + 12, frame);
+    }
+}
+
+static void send_packets(stream_export_t *stream, const stream_packets_t *packets, const stream_viewer_t *viewer){
+    const struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = viewer->port,
+        .sin_addr.s_addr = viewer->address,
+    };
+    for (uint32_t i = 0; i < packets->count; i++){
+        // a full socket buffer or an unreachable viewer just loses the packet, it'll ask for a keyframe
+        const ssize_t sent = sendto(stream->socket, packets->data[i], packets->size[i], 0,
+                                    (const struct sockaddr *)&address, sizeof address);
+        if (sent > 0) stream->bytes += sent;
+    }
+}
+
+// Take viewers' hellos, then send them whatever chip8->dirty_rows says changed since the last call, if anything.
+//  Call once per frame before clearing dirty_rows
+void publish_stream(stream_export_t *stream, const chip8_t *chip8){
+    take_hellos(stream, monotonic_ms());
+
+    const uint32_t height = display_height(chip8);
+    const uint32_t width = display_width(chip8) / 8;
+    uint64_t dirty_rows = chip8->hires ? chip8->dirty_rows : chip8->dirty_rows & ((1ull << CHIP8_HEIGHT) - 1);
+
+    // new resolution: viewers start again from blank, so a packet goes out even if it has no rows
+    const bool resized = chip8->hires != stream->hires;
+    if (resized){
+        memset(stream->sent, 0, sizeof stream->sent);
+        stream->hires = chip8->hires;
+        dirty_rows = chip8->hires ? DIRTY_ALL_ROWS : (1ull << CHIP8_HEIGHT) - 1;
+    }
+
+    // the delta is kept up to date with nobody watching too, it's what a keyframe is made from.
+    //  Dirty rows are only rows that may have changed, the ones that didn't cost nothing
+    static stream_packets_t packets; // 5KB, kept off the emulation thread's stack
+    packets.count = 0;
+    for (; dirty_rows; dirty_rows &= dirty_rows - 1){
+        const uint32_t y = __builtin_ctzll(dirty_rows);
+        if (y >= height) break;
+        for (uint32_t plane = 0; plane < CHIP8_PLANES; plane++){
+            uint8_t row[CHIP8_STREAM_ROW_BYTES];
+            for (uint32_t x = 0; x < width; x++) row[x] = chip8->display[plane][y][x / 8] >> (56 - (x % 8) * 8);
+            encode_row(&packets, plane << 7 | y, row, stream->sent[plane][y], width);
+            memcpy(stream->sent[plane][y], row, width);
+        }
+    }
+    if (resized && !packets.count) packets.size[packets.count++] = CHIP8_STREAM_HEADER_SIZE;
+
+    const uint32_t frame = (uint32_t)chip8->timer_ticks;
+    if (packets.count){
+        finish_packets(stream, &packets, CHIP8_STREAM_DELTA, frame);
+        stream->updates++;
+        for (uint32_t i = 0; i < stream->viewer_count; i++){
+            if (!stream->viewers[i].wants_keyframe) send_packets(stream, &packets, &stream->viewers[i]);
+        }
+    }
+
+    // keyframes after the delta, so they already include it, made once for however many viewers want one
+    bool keyframe_made = false;
+    for (uint32_t i = 0; i < stream->viewer_count; i++){
+        if (!stream->viewers[i].wants_keyframe) continue;
+        if (!keyframe_made){
+            packets.count = 0;
+            for (uint32_t y = 0; y < height; y++){
+                for (uint32_t plane = 0; plane < CHIP8_PLANES; plane++)
+                    encode_row(&packets, plane << 7 | y, stream->sent[plane][y], NULL, width);
+            }
+            if (!packets.count) packets.size[packets.count++] = CHIP8_STREAM_HEADER_SIZE; // blank display
+            finish_packets(stream, &packets, CHIP8_STREAM_KEYFRAME, frame);
+            keyframe_made = true;
+        }
+        send_packets(stream, &packets, &stream->viewers[i]);
+        stream->viewers[i].wants_keyframe = false;
+        stream->keyframes++;
+    }
+}
+
+
+// Headless: run in real time (60 emulated frames a second, --speed scaled) streaming every frame, with keypad
+//  input from movie if there is one (NULL = none), until SIGINT/SIGTERM or count instructions have run
+bool run_stream(chip8_t *chip8, chip8_engine_t *engine, const config_t config, stream_export_t *stream,
+                chip8_movie_t *movie, const uint64_t count){
+    // Ctrl+C stops between frames, with the totals still printed
+    struct sigaction action = {.sa_handler = request_stop};
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    fprintf(stderr, "Streaming on UDP port %u, waiting for viewers\n", stream->port);
+
+    // 1 frame's worth of instructions at a time, stopping exactly at count. A movie's events land on their
+    //  cycles and the timers tick on their own schedule wherever the chunks fall
+    const uint64_t frame_cycles = (config.inst_per_second + 59) / 60;
+    const long period_ns = (long)(1e9 / 60 / (config.speed > 0 ? config.speed : 1.0f));
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    chip8->dirty_rows = DIRTY_ALL_ROWS;
+    uint64_t frames = 0;
+    while (!stop_requested && chip8->cycles < count){
+        const uint64_t left = count - chip8->cycles;
+        if (movie) run_movie(chip8, engine, config, movie, left < frame_cycles ? left : frame_cycles);
+        else run_cycles(chip8, engine, config, left < frame_cycles ? left : frame_cycles);
+        frames++;
+        publish_stream(stream, chip8);
+        chip8->dirty_rows = 0;
+
+        deadline.tv_nsec += period_ns;
+        while (deadline.tv_nsec >= 1000000000L){
+            deadline.tv_nsec -= 1000000000L;
+            deadline.tv_sec++;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR && !stop_requested);
+    }
+
+    fprintf(stderr, "Streamed %llu frames (%llu instructions): %llu updates, %llu keyframes, %llu bytes, "
+                    "up to %u viewers\n", (unsigned long long)frames, (unsigned long long)chip8->cycles,
+            (unsigned long long)stream->updates, (unsigned long long)stream->keyframes,
+            (unsigned long long)stream->bytes, stream->most_viewers);
+    return true;
+}
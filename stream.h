@@ -0,0 +1,182 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+/* Spectator streaming
+    Sends the display over UDP to any number of viewers that only watch (chip8-viewer), for a few KB/s however
+    many there are. An update only carries the rows that changed since the last one, found through
+    chip8->dirty_rows: each row is XORed with what the viewers already have and the result run length encoded,
+    so a sprite moving costs a handful of bytes and a frame that drew nothing costs nothing at all.
+
+    A viewer registers by sending hellos to the emulator's port, at least 1 every STREAM_VIEWER_TIMEOUT_MS or it
+    is forgotten. Updates are split into datagrams of at most CHIP8_STREAM_MAX_PACKET bytes (so they don't get
+    fragmented) and numbered; UDP loses packets, so a viewer that misses one stops applying updates and sets
+    CHIP8_STREAM_WANT_KEYFRAME in its next hello until a keyframe (every row, against a blank display) of its
+    own arrives. chip8_stream_apply below does all of that for C viewers.
+
+    Everything is sent as bytes, multi byte fields little endian:
+      hello (viewer to emulator, CHIP8_STREAM_HELLO_SIZE bytes): magic "C8VW", flags
+      update (emulator to viewers): header of CHIP8_STREAM_HEADER_SIZE bytes
+          0  magic "C8ST"      4  version    5  type (CHIP8_STREAM_DELTA/KEYFRAME)
+          6  flags (CHIP8_STREAM_HIRES/FIRST_PART)     7  keyframe: parts still to come after this one, delta: 0
+          8  sequence, +1 per delta packet (a keyframe repeats the last)  12  frame (60hz ticks, low 32 bits)
+        then rows to the end of the packet, each: id (plane << 7 | y), run count, runs. A run is 1 byte
+        (unchanged bytes << 4 | changed bytes - 1) followed by the changed bytes, XORed with the old ones.
+        A row is the display row as bytes, MSB = leftmost pixel, 8 bytes at 64x32 and 16 at 128x64.
+        When the resolution changes viewers start from a blank display in the new one
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "chip8.h"
+
+#define CHIP8_STREAM_MAGIC 0x54533843u          // "C8ST" in little endian
+#define CHIP8_STREAM_HELLO_MAGIC 0x57563843u    // "C8VW" in little endian
+#define CHIP8_STREAM_VERSION 1
+#define CHIP8_STREAM_PORT 8064                  // default port, for viewers not given one
+
+#define CHIP8_STREAM_HEADER_SIZE 16
+#define CHIP8_STREAM_HELLO_SIZE 5
+#define CHIP8_STREAM_MAX_PACKET 1400            // longest datagram, under the usual 1500 byte MTU
+#define CHIP8_STREAM_ROW_BYTES (CHIP8_HIRES_WIDTH / 8)
+// worst case row: id, count and changed bytes alternating with unchanged ones, 1 run byte each
+#define CHIP8_STREAM_MAX_ROW (2 + CHIP8_STREAM_ROW_BYTES * 2)
+
+#define CHIP8_STREAM_WANT_KEYFRAME 0x01         // hello flag: send me the whole display
+#define CHIP8_STREAM_HIRES 0x01                 // update flag: 128x64
+#define CHIP8_STREAM_FIRST_PART 0x02            // update flag: first packet of a keyframe, start from blank
+
+typedef enum {
+    CHIP8_STREAM_DELTA,         // rows changed since the previous update
+    CHIP8_STREAM_KEYFRAME,      // every row, for 1 viewer catching up
+} chip8_stream_type_t;
+
+#define STREAM_MAX_VIEWERS 64
+#define STREAM_VIEWER_TIMEOUT_MS 5000   // viewers that haven't said hello for this long are dropped
+#define STREAM_HELLO_MS 1000            // how often chip8-viewer says hello
+
+// A registered viewer
+typedef struct {
+    uint32_t address;           // IPv4 address and port, network byte order as recvfrom gave them
+    uint16_t port;
+    bool wants_keyframe;        // asked for one since the last it was sent
+    uint64_t last_hello_ms;     // CLOCK_MONOTONIC
+} stream_viewer_t;
+
+// Export handle, the emulator side of a stream
+typedef struct {
+    int socket;                 // -1 when not streaming
+    uint16_t port;
+    stream_viewer_t viewers[STREAM_MAX_VIEWERS];
+    uint32_t viewer_count;
+    uint8_t sent[CHIP8_PLANES][CHIP8_HIRES_HEIGHT][CHIP8_STREAM_ROW_BYTES]; // the display as viewers have it
+    bool hires;                 // resolution of sent
+    uint32_t sequence;          // last delta sent
+    uint64_t updates;           // deltas sent (to however many viewers)
+    uint64_t keyframes;         // keyframes sent
+    uint64_t bytes;             // bytes sent, all viewers together
+    uint32_t most_viewers;      // most viewers watching at once
+} stream_export_t;
+
+// Listen for viewers on UDP port (all interfaces), false on errors
+bool init_stream(stream_export_t *stream, const uint16_t port);
+
+// Close the socket, viewers just stop getting updates
+void free_stream(stream_export_t *stream);
+
+// Take viewers' hellos, then send them whatever chip8->dirty_rows says changed since the last call, if anything.
+//  Call once per frame before clearing dirty_rows
+void publish_stream(stream_export_t *stream, const chip8_t *chip8);
+
+// Headless: run in real time (60 emulated frames a second, --speed scaled) streaming every frame, with keypad
+//  input from movie if there is one (NULL = none), until SIGINT/SIGTERM or count instructions have run
+bool run_stream(chip8_t *chip8, chip8_engine_t *engine, const config_t config, stream_export_t *stream,
+                chip8_movie_t *movie, const uint64_t count);
+
+
+// Reader side, for C viewers
+
+// A viewer's copy of the display
+typedef struct {
+    uint8_t rows[CHIP8_PLANES][CHIP8_HIRES_HEIGHT][CHIP8_STREAM_ROW_BYTES]; // same layout as the packets' rows
+    bool hires;                 // 128x64, otherwise 64x32 in the top left of rows
+    bool synced;                // a keyframe has been applied and no update missed since, rows are current
+    uint32_t sequence;          // last update applied
+    uint32_t frame;             // frame of the last update applied
+    uint8_t keyframe_parts;     // parts of a keyframe still to come, it's only synced once they're all in
+} chip8_stream_view_t;
+
+static inline uint32_t chip8_stream_le32(const uint8_t *bytes){
+    return bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+// Pixel (x, y) of a view, bit 0 = plane 0 and bit 1 = plane 1 like get_pixel
+static inline uint8_t chip8_stream_pixel(const chip8_stream_view_t *view, const uint32_t x, const uint32_t y){
+    const uint32_t shift = 7 - (x & 7);
+    return ((view->rows[0][y][x / 8] >> shift) & 1) | (((view->rows[1][y][x / 8] >> shift) & 1) << 1);
+}
+
+// Apply 1 received packet to view. False if view can't use it: not an update, a delta while not synced or
+//  after a missed one, or a keyframe part out of turn (view->synced is then false, ask for a keyframe)
+static inline bool chip8_stream_apply(chip8_stream_view_t *view, const uint8_t *packet, const size_t size){
+    if (size < CHIP8_STREAM_HEADER_SIZE || chip8_stream_le32(packet) != CHIP8_STREAM_MAGIC ||
+        packet[4] != CHIP8_STREAM_VERSION) return false;
+
+    const uint8_t type = packet[5];
+    const bool hires = packet[6] & CHIP8_STREAM_HIRES;
+    const uint32_t sequence = chip8_stream_le32(packet + 8);
+    if (type == CHIP8_STREAM_KEYFRAME && (packet[6] & CHIP8_STREAM_FIRST_PART)){
+        memset(view->rows, 0, sizeof view->rows);
+    }else if (type == CHIP8_STREAM_KEYFRAME && view->keyframe_parts && packet[7] + 1 == view->keyframe_parts &&
+              sequence == view->sequence && hires == view->hires){
+        // next part, its rows are still blank
+    }else if (type == CHIP8_STREAM_DELTA && view->synced && sequence == view->sequence + 1){
+        if (hires != view->hires) memset(view->rows, 0, sizeof view->rows);
+    }else{
+        if (type == CHIP8_STREAM_DELTA || type == CHIP8_STREAM_KEYFRAME){
+            view->synced = false;
+            view->keyframe_parts = 0;
+        }
+        return false;
+    }
+
+    // rows are checked as they're applied, a bad one leaves the view half updated so it has to resync
+    const uint32_t height = hires ? CHIP8_HIRES_HEIGHT : CHIP8_HEIGHT;
+    const uint32_t width = hires ? CHIP8_STREAM_ROW_BYTES : CHIP8_WIDTH / 8;
+    view->synced = false;
+    view->keyframe_parts = 0;
+    for (size_t at = CHIP8_STREAM_HEADER_SIZE; at < size;){
+        if (size - at < 2) return false;
+        const uint8_t id = packet[at++];
+        uint32_t runs = packet[at++];
+        if ((id & 0x7F) >= height) return false;
+
+        uint8_t *row = view->rows[id >> 7][id & 0x7F];
+        for (uint32_t x = 0; runs; runs--){
+            if (at == size) return false;
+            const uint32_t skip = packet[at] >> 4, changed = (packet[at] & 0x0F) + 1;
+            at++;
+            x += skip;
+            if (x + changed > width || size - at < changed) return false;
+            for (uint32_t i = 0; i < changed; i++) row[x++] ^= packet[at++];
+        }
+    }
+
+    view->hires = hires;
+    view->keyframe_parts = type == CHIP8_STREAM_KEYFRAME ? packet[7] : 0;
+    view->synced = !view->keyframe_parts;
+    view->sequence = sequence;
+    view->frame = chip8_stream_le32(packet + 12);
+    return true;
+}
+
+// Hello to the emulator (CHIP8_STREAM_HELLO_SIZE bytes), asking for a keyframe if view isn't synced
+static inline void chip8_stream_hello(const chip8_stream_view_t *view, uint8_t *hello){
+    const uint32_t magic = CHIP8_STREAM_HELLO_MAGIC;
+    for (uint32_t i = 0; i < 4; i++) hello[i] = magic >> (i * 8);
+    hello[4] = view->synced ? 0 : CHIP8_STREAM_WANT_KEYFRAME;
+}
+
+#endif
@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* CHIP8 trace decoder
+    Pretty prints a trace saved by a DEBUG build (F12 in the SDL frontend, or <rom_name>.trace after a
+    chip8-headless run): 1 line per instruction describing what it did with the values it saw, the same
+    descriptions DEBUG builds used to printf while running, followed by the registers it changed.
+*/
+
+#include "chip8.h"
+
+
+// Describe the instruction about to run, with the register values it ran with
+static void print_debug_info(const chip8_t *chip8){
+    printf("Address: 0x%04X, Opcode: 0x%04x Desc: ",chip8->PC-2, chip8->inst.opcode);
+    switch ((chip8->inst.opcode >> 12) & 0x0F){ // get top 4 MSBs
+        case 0x00:
+            if ( chip8->inst.NN == 0xE0){
+                //0x00E0: clear screen
+                printf("Clear screen\n");
+            } else if (chip8->inst.NN == 0xEE){
+                // 0x0EEE: return from subroutine
+                // Set PC to  last address on subroutine stack ("pop" it off the stack )
+                //  so next opcode is retrieved from that address
+                printf("Return from subroutine to address 0x%04X\n", *(chip8->stack_ptr-1));
+            }else{
+                printf("Unimplemented opcode\n");
+            }
+            break;
+        case 0x01:
+            // 0x1NNN: Jumps to address NNN
+            printf("Jump to address NNN (0x%04X)\n", chip8->inst.NNN);
+            break;
+        case 0x02:
+            // 0x2NNN: Call subroutine at NNN
+            // store current address to return to on subroutine stack ("push" it on the stack)
+            //   and set PC to subroutine address so next opcode is gotten from there
+            printf("Call subroutine at NNN (0x%04X)\n", chip8->inst.NNN);
+            break;
+        case 0x03:
+            // 0x3XNN: Skips next instruction if VX equals NN
+            printf("Check if V%X (0x%02X) == NN (0x%02X), skip next instruction if true\n",
+                chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.NN);
+            break;
+        case 0x04:
+            // 0x4XNN: Skips next instruction if VX does not equal NN
+            printf("Check if V%X (0x%02X) == NN (0x%02X), skip next instruction if false\n",
+                chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.NN);
+            break;
+        case 0x05:
+            // 0x5XY0: Skips next instruction if VX equals VY
+            printf("Check if V%X (0x%02X) == V%X (0x%02X), skip next instruction if true\n",
+                chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.Y, chip8->V[chip8->inst.Y]);
+            break;
+        case 0x06:
+            // 0x06NN: Set register VX to NN
+            printf("Set register V%X = NN (0x%2X)\n",
+            chip8->inst.X, chip8->inst.NN);
+            break;
+        case 0x07:
+            // 0x07XNN: Set register VX += NN
+            printf("Set register V%X (0x%02X) += NN (%0x2X). Result 0x%02XN \n",
+            chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.NN,
+            chip8->V[chip8->inst.X] +chip8->inst.NN );
+            break;
+        case 0x08:
+            switch(chip8->inst.N){
+                case 0:
+                    // 0x8XY0: set register VX = VY 
+                    printf("Set register V%0X = V%0X (0x%02X)\n",
+                        chip8->inst.X, chip8->inst.Y, chip8->V[chip8->inst.Y]);
+                    break;
+                case 1:
+                    // 0x8XY1: set register VX to VX ORd with VY
+                    printf("Set register V%0X (0x%02X) |= V%0X (0x%02X); Result: 0x%02X\n",
+                        chip8->inst.X, chip8->V[chip8->inst.X],
+                         chip8->inst.Y, chip8->V[chip8->inst.Y],
+                         chip8->V[chip8->inst.X] | chip8->V[chip8->inst.Y]);
+                    break;
+                case 2:
+                    // 0x8XY2: set register VX to VX ANDd with VY
+                    printf("Set register V%0X (0x%02X) &= V%0X (0x%02X); Result: 0x%02X\n",
+                        chip8->inst.X, chip8->V[chip8->inst.X],
+                         chip8->inst.Y, chip8->V[chip8->inst.Y],
+                         chip8->V[chip8->inst.X] & chip8->V[chip8->inst.Y]);
+                    break;
+                case 3:
+                    // 0x8XY3: set register VX to VX XORd with VY
+                    printf("Set register V%0X (0x%02X) ^= V%0X (0x%02X); Result: 0x%02X\n",
+                        chip8->inst.X, chip8->V[chip8->inst.X],
+                         chip8->inst.Y, chip8->V[chip8->inst.Y],
+                         chip8->V[chip8->inst.X] ^ chip8->V[chip8->inst.Y]);
+                    break;
+                case 4:
+                    // 0x8XY4: set register VX to VX + VY, set VF to 1 if carry 
+                    printf("Set register V%0X (0x%02X) += V%0X (0x%02X), VF = 1 if carry; Result: 0x%02X, VF = %X\n",
+                        chip8->inst.X, chip8->V[chip8->inst.X],
+                         chip8->inst.Y, chip8->V[chip8->inst.Y],
+                         chip8->V[chip8->inst.X] + chip8->V[chip8->inst.Y], 
+                         ((uint16_t) chip8->V[chip8->inst.X] +  chip8->V[chip8->inst.Y] > 255)); 
+                    break;
+                case 5:
+                    // 0x8XY5: set register VX to VX - VY, set VF to 1 if there is not a borrow (result is +ve/0)
+                    printf("Set register V%0X (0x%02X) -= V%0X (0x%02X), VF = 1 if no borrow; Result: 0x%02X, VF = %X\n",
+                        chip8->inst.X, chip8->V[chip8->inst.X],
+                         chip8->inst.Y, chip8->V[chip8->inst.Y],
+                         chip8->V[chip8->inst.X] - chip8->V[chip8->inst.Y], 
+                         ( chip8->V[chip8->inst.X] >=  chip8->V[chip8->inst.Y])); 
+                    break;
+                case 6:
+                    // 0x8XY6: right shift VX by 1, store LSB of VX before shift to VF
+                    printf("Set register V%0X (0x%02X) >>= V%0X (0x%02X), VF = shifted off bit (%X); Result: 0x%02X\n",
+                        chip8->inst.X, chip8->V[chip8->inst.X],
+                         chip8->inst.Y, chip8->V[chip8->inst.Y],
+                         (chip8->V[chip8->inst.X] >> 1), 
+                         (chip8->V[chip8->inst.X] & 1)); 
+                    break;
+                case 7:
+                    // 0x8XY7: set register VX to VY - VX, set VF to 1 if there is not a borrow (result is +ve/0)
+                    printf("Set register V%0X (0x%02X) = V%0X (0x%02X) - V%0X (0x%02X), VF = 1 if no borrow; Result: 0x%02X, VF = %X\n",
+                        chip8->inst.X, chip8->V[chip8->inst.X],
+                         chip8->inst.Y, chip8->V[chip8->inst.Y],
+                         chip8->inst.X, chip8->V[chip8->inst.X],
+                         chip8->V[chip8->inst.Y] - chip8->V[chip8->inst.X], 
+                         ( chip8->V[chip8->inst.X] <=  chip8->V[chip8->inst.Y]));  
+                    break;
+                case 0xE:
+                    // 0x8XYE: left shift VX by 1, store LSB of VX before shift to VF
+                    printf("Set register V%0X (0x%02X) <<= 1, VF = shifted off bit (%X); Result: 0x%02X\n",
+                        chip8->inst.X, chip8->V[chip8->inst.X],
+                         ((chip8->V[chip8->inst.X] & 0x80) >> 7),
+                         (chip8->V[chip8->inst.X] << 1)); 
+                    break;
+                default:
+                    // unimplemented opcode
+                    break;
+            }
+            break;
+        case 0x09:
+            // 0x9XY0: Skips the next instruction if VX != VY
+            printf("Check if V%0X (0x%02X) != V%0X (0x%02X), skip next instruction if true\n",
+                chip8->inst.X, chip8->V[chip8->inst.X],
+                 chip8->inst.Y, chip8->V[chip8->inst.Y]);
+            break;
+        case 0x0A:
+            // 0x0ANNN: Set index register I to NNN
+            printf("Set I to NNN (0x%04X)\n", chip8->inst.NNN);
+            break;
+        case 0x0B:
+            // 0xBNNN: Jumps to the address NNN plux V0
+            printf("Set PC to V0 (0x%02X) + NNN (0x%04X); Result = 0x%04X\n",
+                chip8->V[0], chip8->inst.NNN, chip8->V[0] + chip8->inst.NNN);
+            break;
+        case 0x0C:
+            // 0xCXNN: Sets register VX = random byte & NN (bitwise AND)
+            printf("Set V%X = random byte & NN (0x%02X)\n", chip8->inst.X, chip8->inst.NN);
+            break;
+        case 0x0D:
+            // 0xDXYN: Draw N height sprite at coordinates X,Y; read from mem location I;
+            // screen pixels are xor'd with sprite bits 
+            // VF (carry flag) is set if any screen pixels are set off; useful for 
+            // collision detections and other stuff
+            printf("Draw N (%u) height sprite at coords V%X (0x%02X), V%X (0x%02X)"
+             "from memory location I (%04X). Set VF = 1 if any pixels are turned off\n",
+             chip8->inst.N, chip8->inst.X, chip8->V[chip8->inst.X], chip8->inst.Y, chip8->V[chip8->inst.Y], chip8->I );
+            break;
+        case 0xE:
+            if (chip8->inst.NN == 0x9E){
+                // 0xEX9E: skip next instruction if key in VX is pressed 
+                printf("Skip next instruction if key in V%X (0x%02X) is pressed; Keypad value %d\n", 
+                    chip8->inst.X, chip8->V[chip8->inst.X], chip8->keypad[chip8->V[chip8->inst.X]]);
+
+            }else if(chip8->inst.NN == 0xA1){
+                // 0xEX9E: skip next instruction if key in VX is not pressed
+                printf("Skip next instruction if key in V%X (0x%02X) is not pressed; Keypad value %d\n", 
+                    chip8->inst.X, chip8->V[chip8->inst.X], chip8->keypad[chip8->V[chip8->inst.X]]);
+
+            }
+            break;
+        case 0xF:
+            switch(chip8->inst.NN){
+                case 0x0A:
+                    // 0xFX0A: VX = getkey(); Await until a keypress, and store in VX
+                    printf("Await until a key is pressed; Store key in V%X\n",
+                        chip8->inst.X);
+                    break;
+
+                case 0x1E:
+                    // 0FX1E: I+= VX; Add VX to register I. For non-Amiga CHIP8, does not affect VF 
+                    printf("I (0%04X) += V%X (0x%02X); Result (I): 0x%04X\n",
+                        chip8->I, chip8->inst.X, chip8->V[chip8->inst.X],
+                         chip8->I + chip8->V[chip8->inst.X]);
+                    break;
+                case 0x07:
+                    // 0xFX07: set VX to the value of delay timer
+                    printf("Set V%x = delay timer (0x%02X)\n",
+                        chip8->inst.X, chip8->delay_timer);
+                    break;
+
+                case 0x15:
+                    // 0xFX15: set delay timer to value of VX
+                    printf("Set Delay Timer = V%x (0x%02X) \n",
+                         chip8->inst.X, chip8->V[chip8->inst.X]);
+                    break;
+                
+                case 0x18:
+                    // 0xFX18: set VX to the value of sound timer
+                    printf("Set Sound Timer = V%x (0x%02X) \n",
+                         chip8->inst.X, chip8->V[chip8->inst.X]);
+                    break;
+                case 0x29:
+                    // 0xFX29: set register I to sprite location in memory for character in VX (0x0-0xF)
+                    printf("Set I to sprite location in memory for character in V%X (0x%2X). Result (VX*5) = (0x%2X) \n",
+                        chip8->inst.X, chip8->V[chip8->inst.X], chip8->V[chip8->inst.X] *5);
+                    break;
+                case 0x33:
+                    // 0xFX33: Store BCD (binary coded decimal) representation of VX at memory offset from I;
+                    //      I = hundred's place, I + 1 = ten's place, I + 2 = one's place
+                    printf("Store the BCD representation of V%X (0x%02X) at memory from I (0x%04X)\n",
+                        chip8->inst.X, chip8->V[chip8->inst.X], chip8->I);
+                    break;
+                case 0x55:
+                    // 0xFX55: Register dump V0-VF inclusive to memory offset from I;
+                    // SCHIP does not increment I, CHIP8 does increment I
+                    printf("Register dump V0-V%X (0x%02X) inclusive at memory offset from I (0x%04X)\n",
+                        chip8->inst.X, chip8->V[chip8->inst.X], chip8->I);
+                    break;
+                case 0x65:
+                    // 0xFX65: Register load V0-VF from memory offset from I;
+                    // SCHIP does not increment I, CHIP8 does increment I
+                    printf("Register load V0-V%X (0x%02X) from memory offset from I (0x%04X)\n",
+                        chip8->inst.X, chip8->V[chip8->inst.X], chip8->I);
+                default:
+                    break;
+            }
+            break;
+        default:
+            printf("Unimplemented opcode\n");
+            break; //unimplemented or invalid opcode
+    }
+
+}
+
+
+// Rebuild enough of a machine from a trace entry for print_debug_info
+static void load_entry(chip8_t *chip8, const chip8_trace_entry_t *entry){
+    chip8->PC = entry->PC + 2; // fetched already
+    chip8->I = entry->I;
+    memcpy(chip8->V, entry->V, sizeof chip8->V);
+    chip8->delay_timer = entry->delay_timer;
+    chip8->sound_timer = entry->sound_timer;
+    for (uint8_t i = 0; i < 16; i++) chip8->keypad[i] = (entry->keys >> i) & 1;
+    chip8->stack[0] = entry->return_address;
+    chip8->stack_ptr = &chip8->stack[1];
+
+    chip8->inst.opcode = entry->opcode;
+    chip8->inst.NNN = entry->opcode & 0x0FFF;
+    chip8->inst.NN = entry->opcode & 0x0FF;
+    chip8->inst.N = entry->opcode & 0x0F;
+    chip8->inst.X = (entry->opcode >> 8) & 0x0F;
+    chip8->inst.Y = (entry->opcode >> 4) & 0x0F;
+}
+
+// Print the registers an instruction changed, from the entry of the instruction after it
+static void print_changes(const chip8_trace_entry_t *before, const chip8_trace_entry_t *after){
+    bool any = false;
+    for (uint8_t i = 0; i < 16; i++){
+        if (before->V[i] == after->V[i]) continue;
+        printf("%sV%X = 0x%02X", any ? ", " : "           -> ", i, after->V[i]);
+        any = true;
+    }
+    if (before->I != after->I){
+        printf("%sI = 0x%04X", any ? ", " : "           -> ", after->I);
+        any = true;
+    }
+    if (any) putchar('\n');
+}
+
+
+int main(int argc, char **argv){
+    if (argc < 2){
+        fprintf(stderr, "Usage: %s <trace_file> [last n instructions]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (!file){
+        fprintf(stderr, "Trace file %s is invalid or does not exist\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    uint32_t header[2];
+    uint64_t count;
+    if (fread(header, sizeof header, 1, file) != 1 || fread(&count, sizeof count, 1, file) != 1 ||
+        header[0] != CHIP8_TRACE_MAGIC){
+        fprintf(stderr, "%s is not a CHIP8 trace\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    if (header[1] != CHIP8_TRACE_VERSION || count > CHIP8_TRACE_ENTRIES){
+        fprintf(stderr, "Unsupported trace version %u, expected %u\n", header[1], CHIP8_TRACE_VERSION);
+        exit(EXIT_FAILURE);
+    }
+
+    static chip8_trace_entry_t entries[CHIP8_TRACE_ENTRIES];
+    if (fread(entries, sizeof entries[0], count, file) != count){
+        fprintf(stderr, "Trace file %s is truncated\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    fclose(file);
+
+    // only the newest n entries
+    uint64_t first = 0;
+    if (argc > 2){
+        const uint64_t last = strtoull(argv[2], NULL, 0);
+        if (last < count) first = count - last;
+    }
+
+    static chip8_t chip8;
+    for (uint64_t i = first; i < count; i++){
+        load_entry(&chip8, &entries[i]);
+        printf("%10u  ", entries[i].sequence);
+        print_debug_info(&chip8);
+        if (i + 1 < count) print_changes(&entries[i], &entries[i + 1]);
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,166 @@
+#define _POSIX_C_SOURCE 200809L // getaddrinfo/clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+/* CHIP8 spectator viewer
+    Watches an emulator running with --stream: says hello to it, applies the row deltas it sends and shows the
+    result. No emulation, no ROM and no input, so any number of these can watch 1 game
+*/
+
+#include "SDL.h"
+
+#include "chip8.h"
+#include "stream.h"
+
+#define VIEWER_POLL_MS 10       // longest wait for a packet before looking at window events again
+#define VIEWER_RESYNC_MS 100    // most often to ask for a keyframe again while one doesn't arrive
+
+
+static uint64_t monotonic_ms(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// UDP socket connected to the emulator at host:port, -1 on errors
+static int connect_stream(const char *host, const char *port){
+    const struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_DGRAM};
+    struct addrinfo *addresses;
+    const int error = getaddrinfo(host, port, &hints, &addresses);
+    if (error != 0){
+        fprintf(stderr, "Could not find %s: %s\n", host, gai_strerror(error));
+        return -1;
+    }
+
+    // connected, so only the emulator's packets come in and send/recv need no address
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0 || connect(fd, addresses->ai_addr, addresses->ai_addrlen) != 0){
+        fprintf(stderr, "Could not connect to %s:%s\n", host, port);
+        if (fd >= 0) close(fd);
+        freeaddrinfo(addresses);
+        return -1;
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+// Draw the view into the frame texture and present it
+static void show_view(SDL_Renderer *renderer, SDL_Texture *frame, const config_t config,
+                      const chip8_stream_view_t *view){
+    const uint32_t width = view->hires ? CHIP8_HIRES_WIDTH : CHIP8_WIDTH;
+    const uint32_t height = view->hires ? CHIP8_HIRES_HEIGHT : CHIP8_HEIGHT;
+    const uint32_t palette[4] = {config.bg_color, config.fg_color, config.fg2_color, config.blend_color};
+    const SDL_Rect source = {.x = 0, .y = 0, .w = width, .h = height};
+
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(frame, &source, &pixels, &pitch) != 0){
+        SDL_Log("Could not lock SDL frame texture %s\n", SDL_GetError());
+        return;
+    }
+    for (uint32_t y = 0; y < height; y++){
+        uint32_t *row = (uint32_t *)((uint8_t *)pixels + y * pitch);
+        for (uint32_t x = 0; x < width; x++) row[x] = palette[chip8_stream_pixel(view, x, y)];
+    }
+    SDL_UnlockTexture(frame);
+
+    SDL_RenderCopy(renderer, frame, &source, NULL);
+    SDL_RenderPresent(renderer);
+}
+
+
+int main(int argc, char **argv){
+    if (argc < 2 || argv[1][0] == '-'){
+        fprintf(stderr, "Usage: %s <host> [port] [--scale n] [--vsync]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    config_t config = {0};
+    if (!set_config_from_args(&config, argc, argv)) {exit(EXIT_FAILURE);}
+
+    const char *host = argv[1];
+    char port[16];
+    if (argc > 2 && argv[2][0] != '-') snprintf(port, sizeof port, "%s", argv[2]);
+    else snprintf(port, sizeof port, "%u", CHIP8_STREAM_PORT);
+
+    const int fd = connect_stream(host, port);
+    if (fd < 0) {exit(EXIT_FAILURE);}
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0){
+        SDL_Log("Could not initialise SDL video! %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    char title[256];
+    snprintf(title, sizeof title, "Chip 8 Viewer - %s:%s", host, port);
+    SDL_Window *window = SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                          config.window_width * config.scale_factor,
+                                          config.window_height * config.scale_factor, 0);
+    SDL_Renderer *renderer = window ? SDL_CreateRenderer(window, -1,
+        SDL_RENDERER_ACCELERATED | (config.vsync ? SDL_RENDERER_PRESENTVSYNC : 0)) : NULL;
+    SDL_Texture *frame = renderer ? SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+        SDL_TEXTUREACCESS_STREAMING, CHIP8_HIRES_WIDTH, CHIP8_HIRES_HEIGHT) : NULL;
+    if (!frame){
+        SDL_Log("Could not create SDL window %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+
+    static chip8_stream_view_t view;
+    show_view(renderer, frame, config, &view);
+
+    uint64_t last_hello = 0;
+    uint64_t updates = 0, bytes = 0, resyncs = 0;
+    bool running = true;
+    while (running){
+        SDL_Event event;
+        while (SDL_PollEvent(&event)){
+            if (event.type == SDL_QUIT || (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE))
+                running = false;
+            if (event.type == SDL_WINDOWEVENT) show_view(renderer, frame, config, &view); // exposed/resized
+        }
+
+        // hello to stay registered, more often while waiting for a keyframe
+        const uint64_t now = monotonic_ms();
+        if (now - last_hello >= (view.synced ? STREAM_HELLO_MS : VIEWER_RESYNC_MS)){
+            uint8_t hello[CHIP8_STREAM_HELLO_SIZE];
+            chip8_stream_hello(&view, hello);
+            send(fd, hello, sizeof hello, 0); // nobody listening yet is fine, it's said again later
+            last_hello = now;
+            if (!view.synced) resyncs++;
+        }
+
+        // everything that arrived, shown once
+        struct pollfd wait = {.fd = fd, .events = POLLIN};
+        if (poll(&wait, 1, VIEWER_POLL_MS) <= 0) continue;
+        bool changed = false;
+        uint8_t packet[CHIP8_STREAM_MAX_PACKET];
+        ssize_t size;
+        while ((size = recv(fd, packet, sizeof packet, MSG_DONTWAIT)) >= 0){
+            bytes += size;
+            // a missed update leaves view unsynced, the next hello (within VIEWER_RESYNC_MS) asks for a keyframe
+            if (chip8_stream_apply(&view, packet, size)){
+                changed |= view.synced;
+                updates++;
+            }
+        }
+        if (changed) show_view(renderer, frame, config, &view);
+    }
+
+    fprintf(stderr, "Received %llu updates (%llu bytes), %llu keyframe requests\n", (unsigned long long)updates,
+            (unsigned long long)bytes, (unsigned long long)resyncs);
+
+    close(fd);
+    SDL_DestroyTexture(frame);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    exit(EXIT_SUCCESS);
+}